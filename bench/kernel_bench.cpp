@@ -0,0 +1,123 @@
+// Throughput of the sort / merge kernels for every instruction set this
+// machine supports, in million elements per second.
+//   sort:  n random ints sorted in place; the radix sort also for int64 and
+//          float keys (builds with -DSIM_KEY_TYPE=int64|float)
+//   merge: the n smallest of two sorted runs of n (the compare-split of one rank)
+// Usage: kernel_bench [max_elements]   (default 16M, sizes 1K, 4K, ... up to it)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "sort_kernels.hpp"
+
+using SortKernels::Isa;
+
+namespace
+{
+    // repeat fn until at least min_seconds have passed; returns seconds per call
+    template <class Fn>
+    double timeIt(Fn fn, double min_seconds = 0.2)
+    {
+        using Clock = std::chrono::steady_clock;
+        int calls = 0;
+        auto start = Clock::now();
+        double elapsed = 0.0;
+        do
+        {
+            fn();
+            ++calls;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < min_seconds);
+        return elapsed / calls;
+    }
+
+    void printRate(std::size_t n, double seconds, int width = 12)
+    {
+        std::cout << std::setw(width) << std::fixed << std::setprecision(1) << n / seconds / 1e6;
+    }
+
+    // radix sort of n random keys of type T; false if it disagrees with std::sort
+    template <class T, class Gen>
+    bool radixRate(std::size_t n, Gen &gen)
+    {
+        std::vector<T> input(n), data(n), scratch(n), expect;
+        std::uniform_real_distribution<double> dis(-1e9, 1e9);
+        for (T &value : input)
+            value = std::is_integral<T>::value ? static_cast<T>(static_cast<std::uint64_t>(gen()) << 32 | gen()) : static_cast<T>(dis(gen));
+        expect = input;
+        std::sort(expect.begin(), expect.end());
+        data = input;
+        SortKernels::sort(Isa::AUTO, data.data(), scratch.data(), n);
+        if (data != expect)
+            return false;
+        printRate(n, timeIt([&] { data = input; SortKernels::sort(Isa::AUTO, data.data(), scratch.data(), n); }));
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t max_elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (16u << 20);
+
+    std::vector<Isa> isas;
+    for (Isa isa : {Isa::SCALAR, Isa::SSE41, Isa::AVX2, Isa::AVX512})
+        if (SortKernels::isSupported(isa))
+            isas.push_back(isa);
+
+    std::cout << "Detected: " << SortKernels::isaName(SortKernels::detectIsa()) << "\n\n";
+    std::cout << std::setw(10) << "elements" << std::setw(12) << "std::sort" << std::setw(12) << "radix"
+              << std::setw(12) << "radix i64" << std::setw(12) << "radix f32";
+    for (Isa isa : isas)
+        std::cout << std::setw(14) << (std::string("merge ") + SortKernels::isaName(isa));
+    std::cout << "   (M elements/s)" << std::endl;
+
+    std::mt19937 gen(12345);
+    for (std::size_t n = 1024; n <= max_elements; n *= 4)
+    {
+        std::vector<int> input(n), data(n), scratch(n);
+        for (int &value : input)
+            value = static_cast<int>(gen());
+
+        std::cout << std::setw(10) << n;
+        printRate(n, timeIt([&] { data = input; SortKernels::sort(Isa::SCALAR, data.data(), scratch.data(), n); }));
+        printRate(n, timeIt([&] { data = input; SortKernels::sort(Isa::AUTO, data.data(), scratch.data(), n); }));
+        if (!radixRate<std::int64_t>(n, gen) || !radixRate<float>(n, gen))
+        {
+            std::cerr << "\nradix sort of int64 / float keys gives a wrong result for n = " << n << std::endl;
+            return 1;
+        }
+
+        // two sorted runs: the sorted input and a sorted shuffle of fresh values
+        std::vector<int> a = input, b(n), out(n), expect_low(n), expect_high(n);
+        for (int &value : b)
+            value = static_cast<int>(gen());
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        SortKernels::mergeLow(Isa::SCALAR, a.data(), b.data(), expect_low.data(), n);
+        SortKernels::mergeHigh(Isa::SCALAR, a.data(), b.data(), expect_high.data(), n);
+
+        for (Isa isa : isas)
+        {
+            SortKernels::mergeLow(isa, a.data(), b.data(), out.data(), n);
+            bool ok = out == expect_low;
+            SortKernels::mergeHigh(isa, a.data(), b.data(), out.data(), n);
+            ok = ok && out == expect_high;
+            if (!ok)
+            {
+                std::cerr << "\nmerge " << SortKernels::isaName(isa) << " gives a wrong result for n = " << n << std::endl;
+                return 1;
+            }
+            printRate(n, timeIt([&] { SortKernels::mergeLow(isa, a.data(), b.data(), out.data(), n); }), 14);
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,438 @@
+// Whole-simulator benchmark: sorts swept over processor counts, elements per
+// processor, input distributions and simulator options, with warm-up runs and
+// repetitions; the input comes from the simulator's generator (--dist, --seed).
+// Only run() is timed, with console output and the trace off.
+// Per configuration: wall time (median, min, max), events per second, peak
+// RSS, event queue high-water mark and simulated time.
+// Usage: sim_bench [--procs=LIST] [--elements=LIST] [--dist=LIST] [--warmup=N]
+//                  [--reps=N] [--seed=S] [--csv=FILE] [--json=FILE]
+//                  [--baseline=FILE] [--tolerance=PCT] [simulator options]
+// A simulator option with a comma-separated value list (--engine=sequential,timewarp)
+// is swept as well. --baseline compares against the --csv file of an earlier run
+// and exits with 1 if a configuration got more than --tolerance percent slower.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "event_simulator.hpp"
+#include "processor.hpp"
+#include "sim_config.hpp"
+
+namespace
+{
+    // Linux: start a new peak of the resident set; elsewhere the peak is the process's so far
+    void resetPeakRss()
+    {
+#ifdef __linux__
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5";
+#endif
+    }
+
+    // peak resident set in KiB, 0 if unknown
+    std::size_t peakRssKib()
+    {
+#ifdef __linux__
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.compare(0, 6, "VmHWM:") == 0)
+                return std::strtoull(line.c_str() + 6, nullptr, 10);
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            return static_cast<std::size_t>(usage.ru_maxrss);
+#endif
+        return 0;
+    }
+
+    std::vector<std::string> splitList(const std::string &list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            items.push_back(item);
+        return items;
+    }
+
+    int parseCount(const std::string &name, const std::string &value, long min_value)
+    {
+        char *end = nullptr;
+        long count = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || count < min_value || count > (1L << 30))
+            throw std::invalid_argument("--" + name + " needs integers >= " + std::to_string(min_value));
+        return static_cast<int>(count);
+    }
+
+    std::vector<int> parseCounts(const std::string &name, const std::string &list)
+    {
+        std::vector<int> counts;
+        for (const std::string &item : splitList(list))
+            counts.push_back(parseCount(name, item, 1));
+        if (counts.empty())
+            throw std::invalid_argument("--" + name + " needs a list of positive integers");
+        return counts;
+    }
+
+    // one configuration of the sweep
+    struct Point
+    {
+        int procs;
+        int elements;
+        WorkloadConfig distribution; // --dist item, seeded by --seed
+        std::string options; // simulator options, space separated
+        SimConfig config;
+    };
+
+    struct Result
+    {
+        Point point;
+        int repetitions = 0;
+        double wall_median = 0.0; // seconds
+        double wall_min = 0.0;
+        double wall_max = 0.0;
+        std::size_t events = 0;
+        std::size_t peak_rss_kib = 0;
+        std::size_t queue_high_water = 0;
+        double sim_time = 0.0;
+        bool sorted = false;
+
+        double eventsPerSecond() const { return wall_median > 0.0 ? events / wall_median : 0.0; }
+        // matches the same configuration in a baseline file
+        std::string key() const
+        {
+            return std::to_string(point.procs) + "," + std::to_string(point.elements) + "," +
+                   workloadName(point.distribution) + "," + point.options;
+        }
+    };
+
+    Result measure(EventSimulator &simulator, const Point &point, int warmup, int repetitions, unsigned seed)
+    {
+        // the simulator's own generator draws the input once, every run sorts a copy
+        SimConfig config = point.config;
+        config.workload = point.distribution;
+        config.workload.seed = seed;
+        config.workload.seeded = true;
+        simulator.init(point.procs, point.elements, config);
+        simulator.initializeData();
+        std::vector<std::vector<Key>> input;
+        std::vector<Key> expected;
+        for (const Processor &processor : simulator.getProcessors())
+        {
+            input.emplace_back(processor.getData().begin(), processor.getData().end());
+            expected.insert(expected.end(), processor.getData().begin(), processor.getData().end());
+        }
+        std::sort(expected.begin(), expected.end());
+
+        Result result;
+        result.point = point;
+        result.repetitions = repetitions;
+        result.sorted = true;
+        std::vector<double> walls;
+        for (int run = 0; run < warmup + repetitions; ++run)
+        {
+            simulator.init(point.procs, point.elements, point.config);
+            simulator.loadData(input);
+            resetPeakRss();
+
+            auto start = std::chrono::steady_clock::now();
+            simulator.run();
+            auto end = std::chrono::steady_clock::now();
+            if (run < warmup)
+                continue;
+
+            walls.push_back(std::chrono::duration<double>(end - start).count());
+            const EngineStats &engine = simulator.getEngineStats();
+            result.events = engine.events_processed;
+            result.queue_high_water = std::max(result.queue_high_water, engine.queue_high_water);
+            result.peak_rss_kib = std::max(result.peak_rss_kib, peakRssKib());
+            result.sim_time = simulator.getCurrentTime();
+
+            std::vector<Key> sorted;
+            for (const Processor &processor : simulator.getProcessors())
+                sorted.insert(sorted.end(), processor.getData().begin(), processor.getData().end());
+            result.sorted = result.sorted && sorted == expected;
+        }
+        std::sort(walls.begin(), walls.end());
+        std::size_t middle = walls.size() / 2;
+        result.wall_median = walls.size() % 2 ? walls[middle] : (walls[middle - 1] + walls[middle]) / 2;
+        result.wall_min = walls.front();
+        result.wall_max = walls.back();
+        return result;
+    }
+
+    void writeCsv(std::ostream &out, const std::vector<Result> &results)
+    {
+        out << "procs,elements,distribution,options,repetitions,wall_median_s,wall_min_s,wall_max_s,events,"
+               "events_per_s,peak_rss_kib,queue_high_water,sim_time,sorted\n";
+        out << std::setprecision(9);
+        for (const Result &r : results)
+            out << r.key() << "," << r.repetitions << "," << r.wall_median << "," << r.wall_min << "," << r.wall_max
+                << "," << r.events << "," << r.eventsPerSecond() << "," << r.peak_rss_kib << ","
+                << r.queue_high_water << "," << r.sim_time << "," << (r.sorted ? "yes" : "no") << "\n";
+    }
+
+    void writeJson(std::ostream &out, const std::vector<Result> &results, int warmup, unsigned seed)
+    {
+        out << std::setprecision(9);
+        out << "{\n  \"warmup\": " << warmup << ",\n  \"seed\": " << seed << ",\n  \"runs\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            out << (i ? "," : "") << "\n    {\"procs\": " << r.point.procs << ", \"elements\": " << r.point.elements
+                << ", \"distribution\": \"" << workloadName(r.point.distribution) << "\", \"options\": \""
+                << r.point.options << "\", \"repetitions\": " << r.repetitions
+                << ", \"wall_median_s\": " << r.wall_median << ", \"wall_min_s\": " << r.wall_min
+                << ", \"wall_max_s\": " << r.wall_max << ", \"events\": " << r.events
+                << ", \"events_per_s\": " << r.eventsPerSecond() << ", \"peak_rss_kib\": " << r.peak_rss_kib
+                << ", \"queue_high_water\": " << r.queue_high_water << ", \"sim_time\": " << r.sim_time
+                << ", \"sorted\": " << (r.sorted ? "true" : "false") << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // median wall time of each configuration in a --csv file, by key
+    std::map<std::string, double> readBaseline(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("Cannot open baseline " + path);
+        std::string line;
+        std::getline(in, line);
+        std::vector<std::string> header = splitList(line);
+        auto column = std::find(header.begin(), header.end(), "wall_median_s");
+        if (header.size() < 5 || column == header.end())
+            throw std::runtime_error(path + " is not a sim_bench CSV file");
+        std::size_t wall = column - header.begin();
+
+        std::map<std::string, double> baseline;
+        while (std::getline(in, line))
+        {
+            std::vector<std::string> fields = splitList(line);
+            if (fields.size() != header.size())
+                continue;
+            baseline[fields[0] + "," + fields[1] + "," + fields[2] + "," + fields[3]] = std::atof(fields[wall].c_str());
+        }
+        return baseline;
+    }
+
+    // prints the change of every configuration; returns the number of regressions
+    int compareBaseline(const std::vector<Result> &results, const std::map<std::string, double> &baseline,
+                        double tolerance)
+    {
+        std::cout << "\nAgainst the baseline (tolerance " << tolerance << "%):" << std::endl;
+        int regressions = 0;
+        for (const Result &r : results)
+        {
+            std::cout << "  " << std::left << std::setw(60) << r.key() << std::right;
+            auto found = baseline.find(r.key());
+            if (found == baseline.end() || found->second <= 0.0)
+            {
+                std::cout << "  not in baseline" << std::endl;
+                continue;
+            }
+            double change = (r.wall_median / found->second - 1.0) * 100.0;
+            bool regressed = change > tolerance;
+            regressions += regressed;
+            std::cout << std::showpos << std::fixed << std::setprecision(1) << std::setw(9) << change << "%"
+                      << std::noshowpos << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+        return regressions;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> procs = {64, 256, 1024};
+    std::vector<int> elements = {100, 1000};
+    std::vector<WorkloadConfig> distributions = {WorkloadConfig()};
+    int warmup = 1;
+    int repetitions = 5;
+    unsigned seed = 12345;
+    std::string csv_file, json_file, baseline_file;
+    double tolerance = 10.0;
+
+    // simulator options, each with the values it is swept over
+    std::vector<std::pair<std::string, std::vector<std::string>>> options;
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            std::size_t eq = arg.find('=');
+            std::string name = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+            if (name == "--procs")
+                procs = parseCounts("procs", value);
+            else if (name == "--elements")
+                elements = parseCounts("elements", value);
+            else if (name == "--dist")
+            {
+                distributions.clear();
+                for (const std::string &item : splitList(value))
+                    distributions.push_back(parseWorkload(item));
+                if (distributions.empty())
+                    throw std::invalid_argument("--dist needs at least one distribution");
+            }
+            else if (name == "--warmup")
+                warmup = parseCount("warmup", value, 0);
+            else if (name == "--reps")
+                repetitions = parseCount("reps", value, 1);
+            else if (name == "--seed")
+                seed = static_cast<unsigned>(parseCount("seed", value, 0));
+            else if (name == "--csv")
+                csv_file = value;
+            else if (name == "--json")
+                json_file = value;
+            else if (name == "--baseline")
+                baseline_file = value;
+            else if (name == "--tolerance")
+            {
+                char *end = nullptr;
+                tolerance = std::strtod(value.c_str(), &end);
+                if (value.empty() || *end != '\0' || tolerance < 0)
+                    throw std::invalid_argument("--tolerance needs a non-negative percentage");
+            }
+            else if (name == "--compare" || name == "--collective")
+                throw std::invalid_argument("sim_bench measures single sorts, " + name + " is not supported");
+            else
+            {
+                // every value must parse; a comma-separated list is swept
+                std::vector<std::string> values;
+                for (const std::string &item : eq == std::string::npos ? std::vector<std::string>{""} : splitList(value))
+                {
+                    std::string option = eq == std::string::npos ? name : name + "=" + item;
+                    SimConfig scratch;
+                    if (!parseSimOption(option, scratch))
+                        throw std::invalid_argument("Unknown option " + arg);
+                    values.push_back(option);
+                }
+                options.emplace_back(name, values);
+            }
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Usage: " << argv[0]
+                  << " [--procs=LIST] [--elements=LIST] [--dist=LIST] [--warmup=N] [--reps=N] [--seed=S]\n"
+                     "       [--csv=FILE] [--json=FILE] [--baseline=FILE] [--tolerance=PCT] [simulator options]\n"
+                  << "Simulator options (a comma-separated value list is swept):\n"
+                  << simOptionsUsage();
+        return 1;
+    }
+
+    // every combination of the simulator options' values
+    std::vector<std::vector<std::string>> combinations = {{}};
+    for (const auto &option : options)
+    {
+        std::vector<std::vector<std::string>> extended;
+        for (const auto &combination : combinations)
+            for (const std::string &value : option.second)
+            {
+                extended.push_back(combination);
+                extended.back().push_back(value);
+            }
+        combinations = std::move(extended);
+    }
+
+    std::vector<Point> points;
+    for (int p : procs)
+        for (int n : elements)
+            for (const WorkloadConfig &distribution : distributions)
+                for (const auto &combination : combinations)
+                {
+                    Point point{p, n, distribution, "", SimConfig()};
+                    point.config.verbose = false;
+                    point.config.trace_file.clear();
+                    for (const std::string &option : combination)
+                    {
+                        parseSimOption(option, point.config);
+                        point.options += (point.options.empty() ? "" : " ") + option;
+                    }
+                    points.push_back(point);
+                }
+
+    std::size_t width = 8; // of the options column
+    for (const Point &point : points)
+        width = std::max(width, point.options.size() + 2);
+
+    std::cout << "sim_bench: " << points.size() << " configurations, " << warmup << " warm-up and " << repetitions
+              << " timed runs each, seed " << seed << "\n\n";
+    std::cout << std::setw(7) << "procs" << std::setw(10) << "elements" << std::setw(18) << "distribution" << "  "
+              << std::left << std::setw(width) << "options" << std::right << std::setw(12) << "wall ms" << std::setw(14)
+              << "events/s" << std::setw(12) << "peak RSS" << std::setw(11) << "queue max" << std::setw(14)
+              << "sim time" << std::setw(8) << "sorted" << std::endl;
+
+    EventSimulator simulator; // reused by every configuration
+    std::vector<Result> results;
+    bool all_sorted = true;
+    for (const Point &point : points)
+    {
+        Result result;
+        try
+        {
+            result = measure(simulator, point, warmup, repetitions, seed);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Error: " << point.procs << " x " << point.elements << " " << point.options << ": "
+                      << e.what() << std::endl;
+            return 1;
+        }
+        all_sorted = all_sorted && result.sorted;
+        std::cout << std::setw(7) << point.procs << std::setw(10) << point.elements << std::setw(18)
+                  << workloadName(point.distribution) << "  " << std::left << std::setw(width)
+                  << (point.options.empty() ? "-" : point.options) << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << result.wall_median * 1e3 << std::setprecision(0) << std::setw(14)
+                  << result.eventsPerSecond() << std::setw(8) << result.peak_rss_kib / 1024 << " MiB"
+                  << std::setw(11) << result.queue_high_water << std::setprecision(1) << std::setw(14)
+                  << result.sim_time << std::setw(8) << (result.sorted ? "yes" : "NO") << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+        results.push_back(std::move(result));
+    }
+
+    if (!csv_file.empty())
+    {
+        std::ofstream out(csv_file);
+        writeCsv(out, results);
+        std::cout << "\nCSV written to " << csv_file << std::endl;
+    }
+    if (!json_file.empty())
+    {
+        std::ofstream out(json_file);
+        writeJson(out, results, warmup, seed);
+        std::cout << (csv_file.empty() ? "\n" : "") << "JSON written to " << json_file << std::endl;
+    }
+
+    int regressions = 0;
+    if (!baseline_file.empty())
+    {
+        try
+        {
+            regressions = compareBaseline(results, readBaseline(baseline_file), tolerance);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << std::endl;
+    }
+    if (!all_sorted)
+        std::cerr << "Some configurations did not sort correctly" << std::endl;
+    return all_sorted && regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+// Reusable thread barrier (C++17 has no std::barrier)
+class Barrier
+{
+public:
+    explicit Barrier(std::size_t parties) : parties_(parties) {}
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::size_t generation = generation_;
+        if (++waiting_ == parties_)
+        {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+            return;
+        }
+        cv_.wait(lock, [&] { return generation != generation_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::size_t parties_;
+    std::size_t waiting_ = 0;
+    std::size_t generation_ = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "event_simulator.hpp"
+#include "sim_config.hpp"
+
+// One simulation of a batch
+struct BatchJob
+{
+    int num_processes = 0;
+    int elements_per_processor = 0;
+    SimConfig config;
+    std::string options; // as written in the batch file, for reports
+};
+
+struct BatchResult
+{
+    bool completed = false; // false: init() or run() threw `error`
+    std::string error;
+    bool correct = false;   // sorted, or every rank holds the collective's result
+    double sim_time = 0.0;  // simulated time units
+    std::size_t events = 0;
+    MessageCount traffic;
+    double wall = 0.0;      // seconds spent in run()
+};
+
+/** Runs independent simulations side by side in one process.
+ * A fixed pool of worker threads takes the jobs in order; each worker owns
+ * one EventSimulator and reuses it from job to job: its processor arena is
+ * only reallocated when a job needs a larger one (or mapped an input file),
+ * its event queue is emptied rather than rebuilt while the queue type stays
+ * the same, and its payload slabs are kept. Jobs on the parallel engines start threads of their own:
+ * give them --threads=1 or use fewer workers.
+ */
+class BatchRunner
+{
+public:
+    // workers: 0 = hardware concurrency
+    explicit BatchRunner(int workers = 0);
+
+    // results in the order of the jobs
+    std::vector<BatchResult> run(const std::vector<BatchJob> &jobs);
+    int workers() const { return static_cast<int>(simulators_.size()); }
+
+private:
+    static BatchResult runJob(EventSimulator &simulator, const BatchJob &job);
+
+    std::vector<std::unique_ptr<EventSimulator>> simulators_; // one per worker, kept between runs
+};
+
+// Jobs of a batch file, one per line: "<processors> <elements> [--option=value ...]",
+// the options on top of `defaults`; '#' starts a comment. Throws
+// std::runtime_error if the file cannot be read and std::invalid_argument
+// for a malformed line or one writing an --output, --trace or --timeline
+// file another line (or option) writes too.
+std::vector<BatchJob> readBatchFile(const std::string &path, const SimConfig &defaults);
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "event_types.hpp"
+#include "payload_pool.hpp"
+
+/** Simulated MPI collectives.
+ * A collective is a Schedule: for every rank a sequence of rounds, each a set
+ * of sends and receives of "slots" (the blocks or segments the algorithm moves
+ * around). The simulator runs the rounds as COLLECTIVE events: a rank posts a
+ * round's sends when it enters the round and enters the next one once every
+ * receive of the round has arrived. Rounds are computed on demand from the
+ * algorithm's closed form, so a schedule takes no memory per rank.
+ *
+ * Every rank holds a list of blocks (Processor::collectiveBuffer()):
+ *   BCAST      root: {data}                   -> every rank: {data}
+ *   SCATTER    root: P blocks, block t for t  -> rank t: {block t}
+ *   GATHER     rank t: {block}                -> root: P blocks, block t from t
+ *   ALLREDUCE  rank t: {vector}, equal sizes  -> every rank: {elementwise reduction}
+ *   ALLTOALL   rank t: P blocks, block j for j -> rank t: P blocks, block j from j
+ * Block sizes may differ (scatterv, gatherv, alltoallv): messages carry them.
+ *
+ * A schedule may run independently in groups of ranks, like collectives over
+ * the communicators of MPI_Comm_split: group_size ranks group_stride apart
+ * (rank r has group rank (r / stride) % size). Roots, block indices and
+ * peers are then group ranks.
+ */
+namespace Collectives
+{
+    enum class Op
+    {
+        BCAST,
+        SCATTER,
+        GATHER,
+        ALLREDUCE,
+        ALLTOALL,
+    };
+
+    enum class Algorithm
+    {
+        AUTO,               // the default of the operation, see defaultAlgorithm()
+        LINEAR,             // root talks to every rank directly / alltoall: all messages in one round
+        BINOMIAL,           // binomial tree, ceil(log2 P) rounds (allreduce: reduce, then bcast)
+        RECURSIVE_DOUBLING, // pairwise exchanges at doubling distance (bcast: scatter + allgather)
+        RING,               // P-1 neighbor steps (bcast: scatter + ring allgather,
+                            // allreduce: reduce-scatter + allgather, alltoall: pairwise shifts)
+        BRUCK,              // alltoall in ceil(log2 P) rounds, blocks forwarded bit by bit
+    };
+
+    enum class ReduceOp
+    {
+        SUM,
+        MIN,
+        MAX,
+    };
+
+    // one message of a round: the slots sent to / received from `peer`, in order
+    struct Transfer
+    {
+        int peer;
+        std::vector<int> slots;
+    };
+
+    struct Round
+    {
+        std::vector<Transfer> sends; // leave one after another when the round starts
+        std::vector<Transfer> recvs; // the round ends when all of them have arrived
+        bool reduce = false;         // received slots are combined into the local ones instead of replacing them
+    };
+
+    // Totals of one collective run
+    struct Stats
+    {
+        SimTick start = 0;
+        SimTick finish = 0;        // the last rank done
+        int rounds = 0;
+        std::size_t messages = 0;
+        std::size_t elements = 0;  // data moved, summed over messages
+        std::size_t element_bytes = sizeof(Key); // per element on the wire (--record-bytes)
+
+        SimTick duration() const { return finish - start; }
+        std::size_t bytes() const { return elements * element_bytes; }
+    };
+
+    class Schedule
+    {
+    public:
+        // group_size 0 = one group of all ranks; throws std::runtime_error if
+        // `algorithm` does not implement `op`, root is not a group rank or the
+        // groups do not tile the ranks
+        Schedule(Op op, Algorithm algorithm, int num_ranks, int root = 0, ReduceOp reduce = ReduceOp::SUM,
+                 int group_size = 0, int group_stride = 1);
+
+        Op op() const { return op_; }
+        Algorithm algorithm() const { return algorithm_; }
+        int ranks() const { return total_ranks_; }
+        int groupSize() const { return num_ranks_; }
+        int root() const { return root_; }
+        ReduceOp reduceOp() const { return reduce_; }
+
+        int rounds() const { return rounds_; }
+        int slots() const;      // slots per rank
+        bool segmented() const; // the single input / result block is cut into segments
+        bool rotates() const;   // placing input and result moves every block (Bruck)
+
+        Round round(int rank, int k) const;
+        std::vector<int> inputSlots(int rank) const;  // slot of each input block (segment)
+        std::vector<int> outputSlots(int rank) const; // slot of each result block (segment)
+
+    private:
+        int groupRank(int rank) const { return (rank / stride_) % num_ranks_; }
+        Round groupRound(int rank, int k) const; // rank and peers are group ranks
+
+        int relative(int rank) const { return (rank - root_ + num_ranks_) % num_ranks_; }
+        int absolute(int v) const { return (v % num_ranks_ + num_ranks_ + root_) % num_ranks_; }
+        int slotOf(int v) const; // slot of relative rank v's block
+        std::vector<int> slotRange(int first, int last) const; // slots of relative ranks [first, last)
+
+        void scatterRound(Round &round, int v, int k, bool whole) const;
+        void gatherRound(Round &round, int v, int k, bool whole) const;
+        void ringAllgatherRound(Round &round, int v, int k) const;
+        void doublingRound(Round &round, int v, int k, bool whole) const;
+        void alltoallRound(Round &round, int rank, int k) const;
+
+        Op op_;
+        Algorithm algorithm_;
+        int total_ranks_;
+        int stride_;
+        int num_ranks_; // ranks per group, the P of the closed forms
+        int root_;
+        ReduceOp reduce_;
+        int log_;   // ceil(log2 P)
+        int pow2_;  // largest power of two <= P
+        int rounds_;
+    };
+
+    Algorithm defaultAlgorithm(Op op);
+    const char *opName(Op op);
+    const char *algorithmName(Algorithm algorithm);
+    const char *reduceOpName(ReduceOp reduce);
+
+    // into[i] = into[i] (op) from[i]; integer sums wrap around like unsigned arithmetic
+    void combine(ReduceOp reduce, Key *into, const Key *from, std::size_t count);
+
+    // message holding the listed slots: their sizes, then their data
+    Payload pack(PayloadPool &pool, const std::vector<std::vector<Key>> &slots, const std::vector<int> &which,
+                 std::size_t &elements);
+    // store (or combine) a packed message into the listed slots; returns the data elements
+    // throws std::runtime_error if the message does not match the slots
+    std::size_t unpack(const Payload &message, std::vector<std::vector<Key>> &slots, const std::vector<int> &which,
+                       bool reduce, ReduceOp op);
+
+    // result every rank should hold, computed directly from all ranks' input blocks
+    std::vector<std::vector<std::vector<Key>>> expectedResult(Op op, int root, ReduceOp reduce,
+                                                              const std::vector<std::vector<std::vector<Key>>> &input);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <exception>
+#include <limits>
+
+#include "parallel_engine.hpp"
+#include "event_queue.hpp"
+#include "barrier.hpp"
+#include "trace_format.hpp"
+
+class EventSimulator;
+
+/** Conservative parallel engine (YAWNS-style bounded time windows).
+ * Ranks are split into contiguous blocks, one per worker thread, each with
+ * its own event queue. Every window [T, T + L) starts at the earliest pending
+ * time T; L is the simulator's lookahead, so no event processed inside the
+ * window can schedule anything for another partition before the window ends.
+ * Workers process their window events independently, post cross-partition
+ * events to per-destination mailboxes, and exchange them at the barrier.
+ * Global events (START_SORT) run alone on the coordinating thread between
+ * windows. Same-time events in one partition keep their scheduling order, and
+ * since same-time events of different ranks never touch the same state the
+ * results and simulated time equal the sequential engine's.
+ */
+class ConservativeEngine : public ParallelEngine
+{
+public:
+    ConservativeEngine(EventSimulator &simulator, int threads);
+    ~ConservativeEngine() override;
+
+    void run(TraceWriter *trace) override;
+    void schedule(Event event) override;
+
+private:
+    static constexpr SimTick NO_EVENT = std::numeric_limits<SimTick>::max();
+
+    struct Partition
+    {
+        std::unique_ptr<EventQueue> queue;
+        std::vector<std::vector<Event>> outbox; // indexed by destination partition
+        std::vector<TraceRecord> trace;         // events of the current window
+        std::uint64_t next_sequence = 0;
+        SimTick next_time = NO_EVENT; // earliest pending event after delivery
+        SimTick last_time = 0;
+        std::size_t processed = 0;
+        std::size_t remote = 0;
+        MessageCount traffic;
+        std::exception_ptr error;
+    };
+
+    int partitionOf(int rank) const { return static_cast<int>(static_cast<long long>(rank) * workers_ / num_ranks_); }
+    std::uint64_t makeSequence(std::uint64_t counter, int origin) const { return counter * (workers_ + 1) + origin; }
+
+    void workerLoop(int index);
+    void processWindow(Partition &partition);
+    void deliver(int index);
+    void stopWorkers();
+
+    EventSimulator &sim_;
+    int workers_;
+    int num_ranks_;
+    std::vector<Partition> partitions_;
+    std::unique_ptr<EventQueue> global_queue_;
+    std::uint64_t global_sequence_ = 0;
+    bool tracing_ = false;
+
+    SimTick window_end_ = 0;
+    bool done_ = false;
+    Barrier start_barrier_; // coordinator + workers: window begins
+    Barrier worker_barrier_; // workers: processing done, mailboxes complete
+    Barrier end_barrier_;   // coordinator + workers: mailboxes delivered
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <functional>
+
+#include "event_types.hpp"
+
+enum class QueueType {
+    CALENDAR,    // calendar queue, O(1) amortized push/pop (default)
+    BINARY_HEAP, // binary heap, O(log n) push/pop (kept for A/B benchmarking)
+};
+
+// Pending event set of the simulator, ordered by (time, sequence)
+class EventQueue
+{
+public:
+    virtual ~EventQueue() = default;
+
+    virtual void push(Event event) = 0;
+    virtual Event pop() = 0; // remove and return the earliest event
+    virtual const Event &top() = 0;
+    virtual bool empty() const = 0;
+    virtual std::size_t size() const = 0;
+    virtual void clear() = 0;
+    virtual const char *name() const = 0;
+    // every pending event, in no particular order (checkpoints)
+    virtual void forEach(const std::function<void(const Event &)> &visit) const = 0;
+
+    // largest number of pending events seen since construction / clear()
+    std::size_t highWaterMark() const { return high_water_mark_; }
+
+protected:
+    void notePush(std::size_t size)
+    {
+        if (size > high_water_mark_)
+            high_water_mark_ = size;
+    }
+    std::size_t high_water_mark_ = 0;
+};
+
+class BinaryHeapQueue : public EventQueue
+{
+public:
+    void push(Event event) override;
+    Event pop() override;
+    const Event &top() override { return heap_.front(); }
+    bool empty() const override { return heap_.empty(); }
+    std::size_t size() const override { return heap_.size(); }
+    void clear() override;
+    const char *name() const override { return "binary-heap"; }
+    void forEach(const std::function<void(const Event &)> &visit) const override;
+
+private:
+    std::vector<Event> heap_;
+};
+
+/** Calendar queue (R. Brown, 1988):
+ * events are hashed by time into an array of buckets ("days") of fixed width,
+ * the array covering one "year". Dequeue scans forward from the current day, so
+ * with a well chosen width both push and pop are O(1) amortized. The bucket
+ * count doubles / halves with the queue size and the width is re-estimated from
+ * the spacing of the earliest pending events at every resize.
+ * Each bucket keeps one FIFO group per distinct time: sequence numbers grow with
+ * scheduling order, so a burst of events at the same tick (a whole phase) costs
+ * O(1) per event instead of a sorted-list insertion.
+ */
+class CalendarQueue : public EventQueue
+{
+public:
+    CalendarQueue();
+
+    void push(Event event) override;
+    Event pop() override;
+    const Event &top() override;
+    bool empty() const override { return size_ == 0; }
+    std::size_t size() const override { return size_; }
+    void clear() override;
+    const char *name() const override { return "calendar"; }
+    void forEach(const std::function<void(const Event &)> &visit) const override;
+
+private:
+    static constexpr std::size_t MIN_BUCKETS = 16;
+
+    // events sharing one time, in sequence order; popped from `head`
+    struct TickGroup
+    {
+        SimTick time;
+        std::size_t head;
+        std::vector<Event> events;
+    };
+    using Bucket = std::vector<TickGroup>; // sorted by time
+
+    std::size_t bucketOf(SimTick time) const { return static_cast<std::size_t>(time / width_) & (buckets_.size() - 1); }
+    std::size_t findCurrentBucket();
+    void insert(Event event);
+    Event take(); // pop without shrinking
+    void resize(std::size_t bucket_count);
+    SimTick estimateWidth(const std::vector<Event> &events) const;
+
+    std::vector<Bucket> buckets_;
+    SimTick width_;         // width of one bucket in ticks
+    SimTick current_day_;   // time / width_ of the bucket being scanned
+    std::size_t size_;
+};
+
+std::unique_ptr<EventQueue> makeEventQueue(QueueType type);
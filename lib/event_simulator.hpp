@@ -3,6 +3,7 @@
 #include <queue>
 #include <deque>
 #include <functional>
+#include <optional>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -12,68 +13,259 @@
 #include <random>
 
 #include "event_types.hpp"
+#include "event_queue.hpp"
+#include "sim_config.hpp"
+#include "payload_pool.hpp"
 #include "my_mpi.hpp"
-#include "utils.hpp"
+#include "sort_algorithm.hpp"
+#include "thread_backend.hpp"
+#include "timeline.hpp"
+#include "instrumentation.hpp"
+
+class TraceWriter;
 
 
 // Forward declaration
 class Processor;
+class ParallelEngine;
 
-class EventSimulator
+// Counters of one run(), filled in by whichever engine ran it
+struct EngineStats
 {
-public:
-    static EventSimulator &getInstance()
+    std::size_t events_processed = 0;
+    std::size_t queue_high_water = 0; // parallel engines: summed over partitions
+    std::size_t windows = 0;          // conservative engine: synchronization windows
+    std::size_t remote_events = 0;    // events sent to another partition's mailbox
+    int phases_executed = 0;          // compare-split phases run, fewer with early termination
+    MessageCount traffic;             // committed events only
+
+    // optimistic (Time Warp) engine
+    std::size_t events_executed = 0;  // including executions later rolled back
+    std::size_t rollbacks = 0;
+    std::size_t rolled_back_events = 0;
+    std::size_t anti_messages = 0;
+    std::size_t gvt_rounds = 0;
+    std::size_t peak_saved_state_bytes = 0; // summed over partitions
+
+    // committed / executed events, 1 for engines that never roll back
+    double efficiency() const
     {
-        static EventSimulator instance;
-        return instance;
+        return events_executed == 0 ? 1.0 : static_cast<double>(events_processed) / events_executed;
     }
+};
+
+// --engine=threads: a compare-split phase in the discrete-event run, from its
+// first SEND to its last compare-split
+struct SimulatedPhase
+{
+    SimTick start = -1;
+    SimTick finish = 0;
+
+    SimTick span() const { return start < 0 ? 0 : finish - start; }
+};
+
+/** One simulation: its processors, event queue, MPI layer and payload pool.
+ * Instances are independent, so one process can run many simulations at
+ * once (BatchRunner); an instance can be init()ed and run() again and keeps
+ * its allocations from earlier runs.
+ */
+class EventSimulator
+{
+public:
+    EventSimulator() : current_time_(0), sort_start_time_(0), next_sequence_(0), num_processes_(0), elements_per_processor_(0) {}
+    ~EventSimulator() = default;
+    EventSimulator(const EventSimulator &) = delete;
+    EventSimulator &operator=(const EventSimulator &) = delete;
 
     // Initialize the simulator with number of processes and elements per processor
-    void init(int num_processes, int elements_per_processor);
+    void init(int num_processes, int elements_per_processor, const SimConfig &config = SimConfig());
 
-    // Initialize processors with random data
+    // Processors take the keys of the configured workload (--dist), drawn from
+    // getDataSeed(); ranks are generated on up to --threads threads
     void initializeData();
+    // --seed, or the seed drawn by init() if none was given
+    std::uint64_t getDataSeed() const { return data_seed_; }
 
-    void initializeData1();
+    // Processors take their part of `data` (indexed by rank), e.g. to rerun one input
+    void loadData(const std::vector<std::vector<Key>> &data);
+    // Processors take consecutive slices of a binary file of native keys, rank 0
+    // first; the file is mapped, and plane 0 of the processor store maps it
+    // directly where the slices line up (ProcessorStore::mapInput). Throws
+    // std::runtime_error if it holds fewer than P x N keys.
+    void loadDataFile(const std::string &path);
+    // The ranks' data, rank by rank, to a binary file of native keys, written to
+    // PATH.tmp and renamed over PATH (which may be the input); throws std::runtime_error
+    void writeDataFile(const std::string &path) const;
+    // every rank's data ascending and no rank's first element below the previous rank's last
+    bool sortedAcrossRanks() const;
 
 
     // run events in the simulator in order
     void run();
 
-    void scheduleEvent(Event event) { event_queue_.push(std::move(event)); }
-    double getCurrentTime() const { return current_time_; }
-    void setCurrentTime(double time) { current_time_ = time; }
-    std::deque<Message> &getProcessorQueue(int rank);
+    void scheduleEvent(Event event);
+    double getCurrentTime() const { return ticksToUnits(current_time_); }
+    SimTick getCurrentTick() const { return current_time_; }
+    void setCurrentTime(SimTick time) { current_time_ = time; }
     int getNumProcesses() const { return num_processes_; }
-    const std::vector<std::unique_ptr<Processor>> &getProcessors() const { return processors_; }
+    const std::vector<Processor> &getProcessors() const { return processors_; }
+    const ProcessorStore &getProcessorStore() const { return processor_store_; }
+
+    const SimConfig &getConfig() const { return config_; }
+    std::size_t elementBytes() const { return config_.network.elementBytes(); } // per element on the wire
+    const EventQueue &getEventQueue() const { return *event_queue_; }
+    const EngineStats &getEngineStats() const { return stats_; }
+    const SortAlgorithm &getSortAlgorithm() const { return *sort_algorithm_; }
+    MyMPI &getMPI() { return mpi_; }
+    const MyMPI &getMPI() const { return mpi_; }
+    SortKernels::Isa getKernels() const { return kernels_; } // resolved from the config
+    PayloadPool &getPayloadPool() { return payload_pool_; }
+    const PayloadPool &getPayloadPool() const { return payload_pool_; }
+    // --engine=threads: the discrete-event prediction and the real threads' timings, by phase
+    const std::vector<SimulatedPhase> &getSimulatedPhases() const { return simulated_phases_; }
+    const ThreadRunStats &getThreadStats() const { return thread_stats_; }
+    // --timeline: the profile of the last run, nullptr without one
+    const Timeline *getTimeline() const { return timeline_.get(); }
+    // cmake -DSIM_INSTRUMENT=ON: counters of the last run's sequential dispatch loop
+    const Instrumentation &getInstrumentation() const { return instrumentation_; }
+
+    // Run a collective over the processors' collective buffers (input blocks
+    // in, result blocks out) from `time` on; `done` gets the time the last rank
+    // finished. One collective at a time, sequential engine only.
+    void startCollective(const Collectives::Schedule &schedule, SimTick time,
+                         std::function<void(SimTick)> done = nullptr);
+    const Collectives::Stats &getCollectiveStats() const { return collective_stats_; }
+    // --collective: whether every rank holds the result computed directly from the inputs
+    bool collectiveResultCorrect() const;
+
+    // Checkpoints (sequential engine, compare-split sorts): the whole state
+    // between two events, event queue and in-flight messages included.
+    // restoreCheckpoint() goes after init() with the settings of the run that
+    // wrote the file, in place of the data; run() then continues from there.
+    // Both throw std::runtime_error.
+    void writeCheckpoint(const std::string &path) const;
+    void restoreCheckpoint(const std::string &path);
+    std::size_t getCheckpointsWritten() const { return checkpoints_written_; }
+    // digest of the ranks' data, independent of the elements' order; checkpoints
+    // keep the input's so a resumed run can still verify its result
+    std::uint64_t dataDigest() const;
+    std::uint64_t getInputDigest() const { return input_digest_; }
 
-    std::string toStringEvent(const Event& event, double current_time) const;
-  
+    Processor* findProcessor(int rank); // Find processor by rank, O(1)
 
-    
-    Processor* findProcessor(int rank); // Find processor by rank
+    // Rank whose state an event touches, or GLOBAL_EVENT for events that see
+    // every processor; the parallel engines partition events by it
+    static constexpr int GLOBAL_EVENT = -1;
+    static int ownerRank(const Event &event);
+    // Whether handling the event rewrites its owner's local data (as opposed
+    // to only reading it or replacing the received buffer)
+    static bool rewritesLocalData(const Event &event);
+
+    // Smallest delay between an event and any event it schedules for another
+    // rank, the lookahead of the conservative engine
+    SimTick lookahead() const;
 
 private:
-    EventSimulator() : current_time_(0.0), num_processes_(0), elements_per_processor_(0) {}
-    ~EventSimulator() = default;
-    EventSimulator(const EventSimulator &) = delete;
-    EventSimulator &operator=(const EventSimulator &) = delete;
+    friend class ConservativeEngine;
+    friend class TimeWarpEngine;
+
+    void runSequential(TraceWriter *trace);
+    // --engine=threads: the sequential run as the prediction, then the sort for real
+    void runThreads(TraceWriter *trace);
+    // What the simulator knows about an event type: its handler, the rank it
+    // belongs to and whether it rewrites that rank's data. eventKind() looks
+    // the type up in a table built at compile time, indexed by EventType.
+    enum class EventOwner { SOURCE, DEST, GLOBAL };
+    struct EventKind
+    {
+        EventType type;
+        void (EventSimulator::*handler)(const Event &event);
+        EventOwner owner;
+        bool rewrites_local;
+    };
+    static const EventKind &eventKind(EventType type);
+    void dispatchEvent(const Event &event); // run the handler of the event's type
+    // float allreduce sums: every rank's result within rounding of `expected`
+    bool floatSumsClose(const std::vector<Key> &expected) const;
+    // the settings a checkpoint only resumes under, as text
+    std::string checkpointSettings() const;
 
     void processSendEvent(const Event &event);
     void processRecvEvent(const Event &event);
     void processStartSortEvent(const Event &event);
     void processCompareSplitEvent(const Event &event);
+    void processAllreduceEvent(const Event &event);
+    void processCollectiveEvent(const Event &event);
+    void processSortStepEvent(const Event &event);
+
+    // schedule processor's SEND and COMPARE_SPLIT of `phase`, not before `ready`;
+    // false if it has no neighbor then
+    bool schedulePhase(Processor &p, int phase, SimTick ready = 0);
+    // schedule the first phase >= `phase` the processor takes part in
+    void scheduleNextPhase(Processor &p, int phase, SimTick ready = 0);
+    // early termination: schedule phases first_phase and first_phase + 1 of
+    // every processor and the allreduce that follows them
+    void schedulePhasePair(int first_phase);
+
+    // --collective: the configured operation, and the ranks' data cut into its input blocks
+    Collectives::Schedule configuredCollective() const;
+    void initializeCollectiveInput();
+    // post the rank's rounds until one waits for a message, finish after the last
+    void advanceCollective(int rank);
+    void deliverCollective(int rank, const Event &event);
+    void finishCollective(int rank);
+
+    // a rank's progress through the running collective
+    struct CollectiveProgress
+    {
+        int round = 0;
+        std::vector<Collectives::Transfer> expected; // receives of the current round, by peer
+        std::size_t awaiting = 0;
+        bool reduce = false;
+        SimTick clock = 0;     // the rank is busy until then
+        SimTick send_free = 0; // its outgoing link has sent the last message
+        SimTick recv_free = 0; // its incoming link has taken in the last message
+        std::vector<Event> early; // messages of later rounds, held until the rank gets there
+    };
 
 
 
-    MyMPI* mpi;
+    SimConfig config_;
+    SortKernels::Isa kernels_ = SortKernels::Isa::SCALAR;
+    PayloadPool payload_pool_; // declared first: outlives every payload handle
+    MyMPI mpi_;
+    std::unique_ptr<EventQueue> event_queue_;
+    QueueType event_queue_type_ = QueueType::CALENDAR; // of event_queue_, kept across init() while it matches
+    ProcessorStore processor_store_; // data of every rank, declared before the processors viewing it
+    std::vector<Processor> processors_; // Own processors, indexed by rank
+    ParallelEngine *parallel_engine_ = nullptr; // set while a parallel engine runs
+    EngineStats stats_;
+    std::unique_ptr<SortAlgorithm> sort_algorithm_; // set by init
+    bool verbose_ = true; // per-event console output
+    bool record_phases_ = false; // fill simulated_phases_ (sequential handlers only)
+    std::vector<SimulatedPhase> simulated_phases_;
+    ThreadRunStats thread_stats_;
+    std::unique_ptr<Timeline> timeline_; // --timeline, fed by the compare-split handlers
+    Instrumentation instrumentation_;    // empty unless built with SIM_INSTRUMENT
+    bool resumed_ = false; // restored from a checkpoint, run() continues instead of starting
+    std::size_t checkpoints_written_ = 0;
+    std::uint64_t input_digest_ = 0; // dataDigest() of the input, taken when checkpointing
 
-    std::priority_queue<Event, std::vector<Event>, EventComparator> event_queue_;
-    std::vector<std::unique_ptr<Processor>> processors_; // Own processors
+    std::optional<Collectives::Schedule> collective_; // the running (or last) collective
+    std::vector<CollectiveProgress> collective_progress_; // indexed by rank
+    int collective_running_ = 0; // ranks not finished yet
+    std::function<void(SimTick)> collective_done_;
+    Collectives::Stats collective_stats_;
+    std::vector<std::vector<std::vector<Key>>> collective_input_; // --collective inputs, for verification
+    std::uint64_t data_seed_ = 0; // of initializeData() and the v collectives' block sizes
 
-     std::string event_log_;
 
-    double current_time_;
+    SimTick current_time_;
+    SimTick sort_start_time_; // time START_SORT was processed, phases are offset from it
+    SimTick phase_offset_ = 0; // time spent in allreduces so far, delays later phases
+    SimTick split_delay_ = 0;  // from a phase's SEND to its COMPARE_SPLIT, covers the message transfer
+    SimTick phase_delay_ = 0;  // between the SENDs of consecutive phases
+    std::uint64_t next_sequence_; // tie-breaker for events scheduled at the same tick
     int num_processes_;
     int elements_per_processor_;
 };
\ No newline at end of file
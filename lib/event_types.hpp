@@ -1,62 +1,145 @@
 #pragma once
 
+#include <cstdint>
+#include <stdexcept>
+#include <string>
 #include <vector>
-#include "utils.hpp"
+#include "key_type.hpp"
+#include "payload_pool.hpp"
 
 const int RANDOM_INIT_PROCESSOR_RANK = -7;
-// Timing constants for discrete event simulation
+
+// Simulated time is kept in fixed-point integer ticks so that comparisons are
+// exact and cheap; TICKS_PER_UNIT ticks make up one simulated time unit.
+using SimTick = std::int64_t;
+constexpr SimTick TICKS_PER_UNIT = 1000;
+
+constexpr SimTick toTicks(double units)
+{
+    return static_cast<SimTick>(units * TICKS_PER_UNIT + (units < 0 ? -0.5 : 0.5));
+}
+
+constexpr double ticksToUnits(SimTick ticks)
+{
+    return static_cast<double>(ticks) / TICKS_PER_UNIT;
+}
+
+// Timing constants for discrete event simulation (in ticks)
 namespace SimTime {
-    constexpr double LOCAL_SORT_TIME = 2.0;    // time for local sorting (NOT USED)
-    constexpr double SEND_TIME = 1.0;          // time for sending a message
-    constexpr double RECV_TIME = 1.0;          // time for receiving a message
-    constexpr double START_SORT_TIME = 2.5;         // time for start sorting message
-    constexpr double PHASE_DELAY = 50.0;        // time for delay between phases (NOT USED)
-    constexpr double COMPARE_SPLIT_TIME = 4.0;    // time for compare split event
-    constexpr double SORT_TIME = 500.;      // time for sort operation so that always handled at the end of message passing
+    constexpr SimTick LOCAL_SORT_TIME = toTicks(2.0);    // time for local sorting (sort steps of sample sort and hyperquicksort)
+    constexpr SimTick SEND_TIME = toTicks(1.0);          // time for sending a message
+    constexpr SimTick RECV_TIME = toTicks(1.0);          // time for receiving a message
+    constexpr SimTick START_SORT_TIME = toTicks(2.5);    // time for start sorting message
+    constexpr SimTick PHASE_DELAY = toTicks(50.0);       // time for delay between phases
+    constexpr SimTick COMPARE_SPLIT_TIME = toTicks(4.0); // time for compare split event
+    constexpr SimTick SORT_TIME = toTicks(500.);         // time for sort operation so that always handled at the end of message passing
+    constexpr SimTick LOCAL_ELEMENT_TIME = toTicks(0.001);    // collectives: reducing or rotating one element locally
 
 }
 
+// Kinds of events. The simulator handles each through its entry in a table
+// indexed by this enum (EventSimulator::eventKind), so a new kind adds an
+// enumerator before EVENT_TYPE_COUNT, a name below and a table entry
 enum class EventType {
     SEND,
     RECV,
     START_SORT,      // start sorting
-    COMPARE_SPLIT,  // start compare split
+    COMPARE_SPLIT,  // compare-split with the partner (dest) in phase `tag`
+    ALLREDUCE,      // convergence check after a phase pair (early termination)
+    COLLECTIVE,     // message of a collective operation arriving at its destination
+    SORT_STEP,      // local step of a collective-based sort (tag: the algorithm's step)
 };
 
-struct Message {
-    int source;
-    std::vector<int> data;
-    int tag;
-};
+constexpr int EVENT_TYPE_COUNT = static_cast<int>(EventType::SORT_STEP) + 1;
+
+namespace detail {
+    constexpr const char *EVENT_TYPE_NAMES[] = {
+        "SEND", "RECV", "START_SORT", "COMPARE_SPLIT", "ALLREDUCE", "COLLECTIVE", "SORT_STEP",
+    };
+    static_assert(sizeof(EVENT_TYPE_NAMES) / sizeof(EVENT_TYPE_NAMES[0]) == EVENT_TYPE_COUNT,
+                  "every event type needs a name");
+}
+
+constexpr const char *eventTypeName(EventType type)
+{
+    int index = static_cast<int>(type);
+    return index >= 0 && index < EVENT_TYPE_COUNT ? detail::EVENT_TYPE_NAMES[index] : "UNKNOWN_TYPE";
+}
 
+/** A scheduled event, packed into 32 bytes: the time, then the sequence, tag,
+ * ranks and type in bit fields, then the payload handle, which is null for
+ * the events that carry no data. Ranks and tags are 24-bit signed values,
+ * sequences 40-bit; EventSimulator::init() keeps the processor count within
+ * MAX_RANK.
+ */
 class Event {
 public:
-    Event(double time, EventType type, int source_rank, int dest_rank, 
-          std::vector<int> data = std::vector<int>(), int tag = 0)
-        : time_(time), type_(type), source_rank_(source_rank), 
-          dest_rank_(dest_rank), data_(std::move(data)), tag_(tag) {}
+    static constexpr int MAX_RANK = (1 << 23) - 1;
+    static constexpr std::uint64_t MAX_SEQUENCE = (std::uint64_t(1) << 40) - 1;
 
-    double getTime() const { return time_; }
-    EventType getType() const { return type_; }
-    int getSourceRank() const { return source_rank_; }
-    int getDestRank() const { return dest_rank_; }
-    const std::vector<int>& getData() const { return data_; }
-    int getTag() const { return tag_; }
+    Event(SimTick time, EventType type, int source_rank, int dest_rank,
+          Payload data = Payload(), int tag = 0)
+        : time_(time), sequence_(0), tag_(tag), source_rank_(source_rank),
+          dest_rank_(dest_rank), type_(static_cast<std::uint64_t>(type)), data_(std::move(data)) {}
 
+    SimTick getTime() const { return time_; }
+    std::uint64_t getSequence() const { return sequence_; }
+    void setSequence(std::uint64_t sequence) {
+        if (sequence > MAX_SEQUENCE)
+            throw std::runtime_error("Event sequence " + std::to_string(sequence) + " does not fit an event record");
+        sequence_ = sequence;
+    }
+    EventType getType() const { return static_cast<EventType>(type_); }
+    int getSourceRank() const { return static_cast<int>(source_rank_); }
+    int getDestRank() const { return static_cast<int>(dest_rank_); }
+    const Payload& getData() const { return data_; }
+    int getTag() const { return static_cast<int>(tag_); }
+
+    // Strict (time, sequence) ordering; equal times run in scheduling order
+    bool before(const Event& other) const {
+        return time_ < other.time_ ||
+               (time_ == other.time_ && sequence_ < other.sequence_);
+    }
 
 private:
-    double time_;  // Discrete simulation time
-    EventType type_;
-    int source_rank_;
-    int dest_rank_;
-    std::vector<int> data_;
-    int tag_;
-    
+    SimTick time_;  // Discrete simulation time
+    std::uint64_t sequence_ : 40; // tie-breaker, assigned when scheduled
+    std::int64_t tag_ : 24;
+    std::int64_t source_rank_ : 24;
+    std::int64_t dest_rank_ : 24;
+    std::uint64_t type_ : 8;
+    Payload data_; // message payload, shared with the receiver
+
 };
 
+static_assert(sizeof(Event) == 32, "Event record grew");
+
 class EventComparator {
 public:
     bool operator()(const Event& a, const Event& b) const {
-        return a.getTime() > b.getTime();
+        return b.before(a);
     }
-};
\ No newline at end of file
+};
+
+// Data messages delivered: the RECVs of compare-split sorts and collective
+// messages, with their payload bytes (collective slot headers included) at
+// element_bytes per element, NetworkConfig::elementBytes()
+struct MessageCount
+{
+    std::size_t messages = 0;
+    std::size_t bytes = 0;
+
+    void add(const Event &event, std::size_t element_bytes)
+    {
+        if (event.getType() != EventType::RECV && event.getType() != EventType::COLLECTIVE)
+            return;
+        ++messages;
+        bytes += event.getData().size() * element_bytes;
+    }
+    MessageCount &operator+=(const MessageCount &other)
+    {
+        messages += other.messages;
+        bytes += other.bytes;
+        return *this;
+    }
+};
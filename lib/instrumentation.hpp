@@ -0,0 +1,239 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "event_types.hpp"
+
+#if defined(SIM_INSTRUMENT) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Measurements of the simulator itself, built in with
+// cmake -DSIM_INSTRUMENT=ON: events and handler latencies by event type,
+// local sort and merge kernel latencies, event queue depth over the run, and
+// payload bytes copied and buffers taken per event type. Counts are exact;
+// latencies are sampled, every SAMPLE_PERIOD-th call of each event type and
+// kernel is timed, since reading the cycle counter twice costs as much as a
+// small handler (~25 ns per read on virtual machines). Without the option
+// Instrumentation is an empty stub whose hooks compile to nothing; call sites
+// that would compute arguments guard them with `if constexpr
+// (Instrumentation::ENABLED)`. Only the sequential dispatch loop (also the
+// prediction run of --engine=threads) records: it makes its Instrumentation
+// the calling thread's active() one, which the payload pool and the processor
+// kernels report to.
+
+#if defined(SIM_INSTRUMENT)
+
+// Time stamp counter where there is one (unserialized, a few ns), else nanoseconds
+inline std::uint64_t cycleCount()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+#endif
+}
+
+/** Histogram of cycle counts with HDR-style log-linear buckets: exact below
+ * 16, above that 16 buckets per power of two, so a value is known within
+ * 1/16 of itself. Recording is a shift, a count-leading-zeros and an add.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    void record(std::uint64_t value)
+    {
+        ++counts_[bucket(value)];
+        ++count_;
+        sum_ += value;
+        if (value > max_)
+            max_ = value;
+    }
+
+    std::uint64_t count() const { return count_; }
+    double mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_; }
+    std::uint64_t max() const { return max_; }
+    // highest value of the bucket holding the p-th percentile (0 < p <= 100)
+    std::uint64_t percentile(double p) const;
+
+private:
+    static int bucket(std::uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+            return static_cast<int>(value);
+        int msb = 63 - __builtin_clzll(value);
+        return (msb - SUB_BITS + 1) * SUB_BUCKETS + static_cast<int>((value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+    static std::uint64_t bucketHigh(int bucket);
+
+    std::array<std::uint64_t, BUCKETS> counts_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+class Instrumentation
+{
+public:
+    static constexpr bool ENABLED = true;
+    static constexpr std::uint64_t SAMPLE_PERIOD = 16; // a power of two
+
+    enum class Kernel { LOCAL_SORT, MERGE };
+    static constexpr int KERNELS = 2;
+    static const char *kernelName(Kernel kernel);
+
+    struct TypeStats
+    {
+        std::uint64_t events = 0;
+        LatencyHistogram latency; // cycles per sampled handler call
+        std::uint64_t bytes_copied = 0; // into payload buffers
+        std::uint64_t buffers = 0;      // payload buffers taken
+        std::uint64_t slabs = 0;        // ... that needed a new slab from the system
+    };
+
+    struct DepthSample
+    {
+        SimTick time;
+        std::size_t depth;
+    };
+
+    // the instrumentation the pool and kernels on this thread report to, if any
+    static Instrumentation *&active()
+    {
+        thread_local Instrumentation *current = nullptr;
+        return current;
+    }
+    // makes `instrumentation` the thread's active one while it lives
+    class Scope
+    {
+    public:
+        explicit Scope(Instrumentation &instrumentation) : previous_(active()) { active() = &instrumentation; }
+        ~Scope() { active() = previous_; }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Instrumentation *previous_;
+    };
+    // counts a kernel call into the active instrumentation, and times the sampled ones
+    class KernelTimer
+    {
+    public:
+        explicit KernelTimer(Kernel kernel) : sink_(active()), kernel_(kernel), start_(0)
+        {
+            if (sink_ && (++sink_->kernel_calls_[static_cast<int>(kernel)] & (SAMPLE_PERIOD - 1)) == 0)
+                start_ = cycleCount();
+        }
+        ~KernelTimer()
+        {
+            if (start_ != 0)
+                sink_->kernels_[static_cast<int>(kernel_)].record(cycleCount() - start_);
+        }
+        KernelTimer(const KernelTimer &) = delete;
+        KernelTimer &operator=(const KernelTimer &) = delete;
+
+    private:
+        Instrumentation *sink_;
+        Kernel kernel_;
+        std::uint64_t start_;
+    };
+
+    // a new run; takes the clock reference the cycle counts are converted with
+    void reset();
+    // end of a run: the second clock reference
+    void stop();
+
+    // around each dispatched event; eventStart() returns 0 for the calls not timed
+    std::uint64_t eventStart(EventType type)
+    {
+        current_ = static_cast<int>(type);
+        return (++types_[current_].events & (SAMPLE_PERIOD - 1)) == 0 ? cycleCount() : 0;
+    }
+    void eventDone(std::uint64_t start, std::size_t queue_depth, SimTick time)
+    {
+        if (start != 0)
+            types_[current_].latency.record(cycleCount() - start);
+        current_ = EVENT_TYPE_COUNT;
+        depth_sum_ += queue_depth;
+        if (queue_depth > depth_max_)
+            depth_max_ = queue_depth;
+        if ((++events_ & (depth_stride_ - 1)) == 0)
+            sampleDepth(queue_depth, time);
+    }
+
+    // payload pool hooks
+    void copied(std::size_t bytes) { types_[current_].bytes_copied += bytes; }
+    void buffer(bool new_slab)
+    {
+        ++types_[current_].buffers;
+        types_[current_].slabs += new_slab;
+    }
+
+    // by EventType, then the work done outside any event (index EVENT_TYPE_COUNT)
+    const TypeStats &typeStats(int index) const { return types_[index]; }
+    const LatencyHistogram &kernel(Kernel kernel) const { return kernels_[static_cast<int>(kernel)]; }
+    std::uint64_t kernelCalls(Kernel kernel) const { return kernel_calls_[static_cast<int>(kernel)]; }
+    std::uint64_t events() const { return events_; }
+    double meanDepth() const { return events_ == 0 ? 0.0 : static_cast<double>(depth_sum_) / events_; }
+    std::size_t maxDepth() const { return depth_max_; }
+    const std::vector<DepthSample> &depthSamples() const { return depth_samples_; } // evenly spaced in events
+    double cyclesPerNanosecond() const;
+
+private:
+    static constexpr std::size_t MAX_DEPTH_SAMPLES = 1024;
+    void sampleDepth(std::size_t depth, SimTick time);
+
+    std::array<TypeStats, EVENT_TYPE_COUNT + 1> types_;
+    std::array<LatencyHistogram, KERNELS> kernels_;
+    std::array<std::uint64_t, KERNELS> kernel_calls_{};
+    int current_ = EVENT_TYPE_COUNT;
+    std::uint64_t events_ = 0;
+    std::uint64_t depth_sum_ = 0;
+    std::size_t depth_max_ = 0;
+    std::uint64_t depth_stride_ = 64; // events between samples, doubled when the samples fill up
+    std::vector<DepthSample> depth_samples_;
+    std::uint64_t start_cycles_ = 0, stop_cycles_ = 0;
+    std::int64_t start_ns_ = 0, stop_ns_ = 0;
+};
+
+#else
+
+// SIM_INSTRUMENT off: the hooks do nothing
+class Instrumentation
+{
+public:
+    static constexpr bool ENABLED = false;
+
+    enum class Kernel { LOCAL_SORT, MERGE };
+
+    static constexpr Instrumentation *active() { return nullptr; }
+    class Scope
+    {
+    public:
+        explicit Scope(Instrumentation &) {}
+    };
+    class KernelTimer
+    {
+    public:
+        explicit KernelTimer(Kernel) {}
+    };
+
+    void reset() {}
+    void stop() {}
+    std::uint64_t eventStart(EventType) { return 0; }
+    void eventDone(std::uint64_t, std::size_t, SimTick) {}
+    void copied(std::size_t) {}
+    void buffer(bool) {}
+};
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Element type of the simulated data, fixed at build time:
+// cmake -DSIM_KEY_TYPE=int32 (default) | int64 | float. Ranks, messages,
+// checkpoints and data files all hold Keys; sorting is ascending by value.
+// A record larger than its key is modelled by --record-bytes: the simulation
+// moves the key (standing in for the record's index) and the network is
+// charged for the whole record.
+
+// [KEY_MIN, KEY_MAX] is the range of the generated input (lib/workload.hpp):
+// 1..100000 for int32, as before; the wider types use more of their range so
+// that every byte of a key varies
+#if defined(SIM_KEY_INT64)
+using Key = std::int64_t;
+constexpr Key KEY_MIN = 1, KEY_MAX = INT64_C(1) << 60;
+constexpr const char *KEY_TYPE_NAME = "int64";
+#elif defined(SIM_KEY_FLOAT)
+using Key = float;
+constexpr Key KEY_MIN = -1.0e6f, KEY_MAX = 1.0e6f;
+constexpr const char *KEY_TYPE_NAME = "float";
+#else
+using Key = int;
+constexpr Key KEY_MIN = 1, KEY_MAX = 100000;
+constexpr const char *KEY_TYPE_NAME = "int32";
+#endif
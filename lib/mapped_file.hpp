@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/** Read-only mapping of a whole file.
+ * Pages come in from the page cache on first touch, nothing is read up
+ * front, so a file far larger than memory can be mapped and walked through.
+ */
+class MappedFile
+{
+public:
+    // throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; } // nullptr for an empty file
+    std::size_t size() const { return size_; }
+    int fd() const { return fd_; } // open while the mapping lives, for further mappings
+    const std::string &path() const { return path_; }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "event_types.hpp"
+#include "payload_pool.hpp"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+// Handle of a nonblocking send or receive, local to the rank that posted it
+using Request = int;
+constexpr Request REQUEST_NULL = -1;
+
+enum class MatchingMode {
+    HASHED, // queues longer than a few entries bucketed by (source, tag): O(1) per match (default)
+    LINEAR, // one queue each, searched front to back like a classic MPI progress engine
+};
+
+/** A rank's point-to-point message matching, with MPI semantics.
+ * irecv() posts a receive for (source, tag); either may be ANY_SOURCE /
+ * ANY_TAG. An arriving message completes the oldest posted receive it
+ * matches, or waits in the unexpected queue for the first later receive that
+ * matches it, so messages from one source with one tag never overtake each
+ * other. isend() requests complete once the message has left the sender: the
+ * message is a copy (eager protocol) and never waits for its receive.
+ *
+ * Handlers cannot block, so wait() / waitAll() take the event to resume once
+ * the requests are complete; the resumed handler collects them with test() /
+ * testAll(), which free completed requests.
+ *
+ * The engine is plain data, Time Warp saves and restores it with its rank;
+ * save() / load() write it to a checkpoint and read it back.
+ */
+class MatchingEngine
+{
+public:
+    static constexpr int ANY_SOURCE = -1;
+    static constexpr int ANY_TAG = -1;
+
+    struct Stats
+    {
+        std::size_t receives = 0;       // irecvs posted
+        std::size_t arrivals = 0;       // messages delivered
+        std::size_t unexpected = 0;     // ... that found no receive posted for them
+        std::size_t probes = 0;         // buckets or queue entries looked at while matching
+        std::size_t max_posted = 0;     // most receives posted at once
+        std::size_t max_unexpected = 0; // most unexpected messages queued at once
+
+        double probesPerLookup() const
+        {
+            return receives + arrivals == 0 ? 0.0 : static_cast<double>(probes) / (receives + arrivals);
+        }
+        Stats &operator+=(const Stats &other); // maxima of several ranks: the largest
+    };
+
+    explicit MatchingEngine(MatchingMode mode = MatchingMode::HASHED) : mode_(mode) {}
+
+    Request irecv(int source, int tag);
+    // a send leaving the sender until `done`
+    Request isend(SimTick done);
+    // a message from `source` arriving at `time`: completes the oldest matching
+    // receive or is queued as unexpected. Returns the event a wait() resumes if
+    // this completed the last request it waited for.
+    std::optional<Event> arrive(int source, int tag, Payload data, SimTick time);
+
+    // complete by `now`? Then the request is freed (set to REQUEST_NULL) and a
+    // receive hands out its message and its source / tag. REQUEST_NULL tests complete.
+    // throws std::runtime_error for a handle that is not in use
+    bool test(Request &request, SimTick now, Payload *data = nullptr, int *source = nullptr, int *tag = nullptr);
+    // all `count` complete by `now`? Then all are freed; data[i], if given,
+    // takes the message of receive i
+    bool testAll(Request *requests, std::size_t count, SimTick now, Payload *data = nullptr);
+
+    // `resume` runs at its own time, or `delay` after the last of the requests
+    // completes if that is later. Returns it, retimed, if they already have;
+    // else arrive() returns it once they do. A request can only be waited for once.
+    std::optional<Event> wait(Request request, const Event &resume, SimTick delay = 0);
+    std::optional<Event> waitAll(const Request *requests, std::size_t count, const Event &resume, SimTick delay = 0);
+
+    std::size_t posted() const { return posted_.size; }
+    std::size_t unexpected() const { return unexpected_.size; }
+    const Stats &stats() const { return stats_; }
+    MatchingMode mode() const { return mode_; }
+    std::size_t bytes() const; // memory held, roughly
+
+    // checkpoints: the whole engine, posted receives, unexpected messages and waits included
+    void save(SnapshotWriter &out) const;
+    void load(SnapshotReader &in);
+
+private:
+    // intrusive doubly linked FIFO through one of the `links` of slots in a vector
+    struct Link
+    {
+        int prev = -1;
+        int next = -1;
+    };
+    struct Fifo
+    {
+        int head = -1;
+        int tail = -1;
+        std::size_t size = 0;
+    };
+
+    // open addressing (linear probing) map from (source, tag) keys to fifos:
+    // one allocation and no node per bucket, cheap to fill, empty and copy
+    class Buckets
+    {
+    public:
+        Fifo *find(std::uint64_t key);
+        Fifo &operator[](std::uint64_t key); // an empty fifo if the key is new
+        void erase(std::uint64_t key);
+        std::size_t bytes() const { return entries_.capacity() * sizeof(Entry); }
+        void save(SnapshotWriter &out) const;
+        void load(SnapshotReader &in);
+
+    private:
+        struct Entry
+        {
+            std::uint64_t key = 0;
+            Fifo fifo;
+            bool used = false;
+        };
+        std::size_t home(std::uint64_t key) const
+        {
+            return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+        std::size_t position(std::uint64_t key) const; // of the key, or of the free entry it would take
+        void grow();
+
+        std::vector<Entry> entries_; // a power of two of them, at most half used
+        std::size_t size_ = 0;
+        int shift_ = 64;
+    };
+
+    // a request; a posted receive is in its (source, tag) bucket and in posted_,
+    // a free slot in the free list through links[POSTED]
+    enum ReceiveLink { BUCKET, POSTED };
+    struct Slot
+    {
+        bool used = false;
+        bool receive = false;
+        bool complete = false;
+        int source = ANY_SOURCE; // receive pattern, the message's once it has matched
+        int tag = ANY_TAG;
+        std::uint64_t order = 0; // post order, the oldest of several matching receives wins
+        SimTick ready = 0;       // completion time
+        int group = -1;          // wait group
+        Payload data;
+        Link links[2];
+    };
+
+    // an unexpected message, findable by each receive pattern that can match it
+    enum MessageLink { EXACT, BY_SOURCE, BY_TAG, ALL };
+    struct Message
+    {
+        int source = 0;
+        int tag = 0;
+        SimTick time = 0;
+        Payload data;
+        Link links[4];
+    };
+
+    struct WaitGroup
+    {
+        int pending = 0;     // requests not complete yet
+        SimTick last = 0;    // the last completion so far
+        SimTick delay = 0;
+        std::optional<Event> resume;
+    };
+
+    template <class T>
+    static void pushBack(std::vector<T> &slots, Fifo &fifo, int index, int link);
+    template <class T>
+    static void unlink(std::vector<T> &slots, Fifo &fifo, int index, int link);
+    // unlink from a fifo of `buckets`, dropping the bucket once it is empty
+    template <class T>
+    static void unlinkBucket(std::vector<T> &slots, Buckets &buckets, std::uint64_t key, int index, int link);
+    static std::uint64_t key(int source, int tag)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(source)) << 32 | static_cast<std::uint32_t>(tag);
+    }
+    static bool matches(int source, int tag, int message_source, int message_tag)
+    {
+        return (source == ANY_SOURCE || source == message_source) && (tag == ANY_TAG || tag == message_tag);
+    }
+
+    Slot &slot(Request request);
+    Request newSlot();
+    void freeSlot(Request request);
+
+    // hashed mode: bucket a queue once it grows past SHORT_QUEUE entries (until it
+    // is empty again); shorter ones are searched faster than hashed
+    static constexpr std::size_t SHORT_QUEUE = 8;
+    void indexPosted();
+    void indexMessage(int index);
+    int findPosted(int source, int tag);     // oldest posted receive matching a message, -1 if none
+    int findUnexpected(int source, int tag); // oldest unexpected message matching a receive, -1 if none
+    void removeUnexpected(int index);
+    // a receive completed: count it down in its wait group; the group's event if it is done
+    std::optional<Event> complete(Slot &request, SimTick time);
+    static Event retime(const WaitGroup &group);
+
+    // touched by every message first, the rest after them
+    MatchingMode mode_;
+    int free_slot_ = -1;
+    std::vector<Slot> slots_;
+    Fifo posted_;                      // posted receives, in post order
+    Fifo unexpected_;                  // unexpected messages, in arrival order
+    std::size_t wildcards_posted_ = 0; // posted receives with ANY_SOURCE or ANY_TAG
+    bool posted_indexed_ = false;      // posted_by_key_ holds the posted receives
+    bool unexpected_indexed_ = false;  // unexpected_by_key_ holds the unexpected messages
+    std::uint64_t next_order_ = 0;
+    Stats stats_;
+
+    Buckets posted_by_key_; // hashed: by (source, tag), wildcards included
+    // hashed: by (source, tag), and by (source, ANY_TAG) and (ANY_SOURCE, tag)
+    // for wildcard receives (messages themselves never carry a wildcard)
+    Buckets unexpected_by_key_;
+    std::vector<Message> messages_;
+    std::vector<int> free_messages_;
+    std::vector<WaitGroup> groups_;
+    std::vector<int> free_groups_;
+};
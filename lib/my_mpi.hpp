@@ -3,58 +3,80 @@
 #include <vector>
 #include <queue>
 #include <deque>
-#include <mutex>
-#include <condition_variable>
 #include <memory>
-#include <chrono>
 #include <unordered_map>
 #include <algorithm>
 #include <iostream>
 
 #include "processor.hpp"
-#include "utils.hpp"
+#include "collectives.hpp"
+#include "network_model.hpp"
 
 
+// The simulated MPI layer of one simulation: message events and their costs
+// under its network model, and the schedules of its collectives. Every
+// EventSimulator owns one.
 class MyMPI
 {
 public:
-    static MyMPI &getInstance()
-    {
-        static MyMPI instance;
-        return instance;
-    }
+    MyMPI() = default;
+    MyMPI(const MyMPI &) = delete;
+    MyMPI &operator=(const MyMPI &) = delete;
 
-    // Initialize the simulator with number of processes
-    void init(int num_processes);
+    // Initialize the simulator with number of processes and the network they talk over;
+    // throws std::runtime_error if the network's topology does not fit
+    void init(int num_processes, const NetworkConfig &network = NetworkConfig());
 
     // Simulated MPI_Send
-    Event send(int source, int dest, const std::vector<int> &data, int tag, double current_time);
+    Event send(int source, int dest, Payload data, int tag, SimTick current_time);
 
-    // Simulated MPI_Recv with retry logic
-    Event receive(int rank, int source,const std::vector<int> &data, int tag, double current_time);
+    // Simulated MPI_Recv of a message that left source at `departure`, arriving
+    // calculateTransferTime() later
+    Event receive(int rank, int source, Payload data, int tag, SimTick departure);
 
-    int getNumProcesses() const { return num_processes_; }
+    // Simulated MPI_Allreduce over all ranks, completing allreduceTime() after current_time
+    Event allreduce(int tag, SimTick current_time);
+    SimTick allreduceTime() const;
 
-private:
-    struct Message
+    // Transfer time of a message of `elements` ints under the network model;
+    // the link model books the links of its route
+    SimTick calculateTransferTime(int source, int dest, std::size_t elements, SimTick departure)
     {
-        int source;
-        std::vector<int> data;
-        int tag;
-    };
+        return network_->transferTime(source, dest, elements, departure);
+    }
+    const NetworkModel &network() const { return *network_; }
+    void resetNetwork() { network_->reset(); }
+    // checkpoints: the network model's state (link bookings)
+    void saveNetwork(SnapshotWriter &out) const { network_->save(out); }
+    void loadNetwork(SnapshotReader &in) { network_->load(in); }
 
+    // Simulated collectives: the schedule of the chosen algorithm, run by
+    // EventSimulator::startCollective (see collectives.hpp). By default over
+    // all ranks, else separately in each group of group_size ranks
+    // group_stride apart, with group ranks as roots.
+    Collectives::Schedule bcast(int root, Collectives::Algorithm algorithm = Collectives::Algorithm::AUTO,
+                                int group_size = 0, int group_stride = 1) const;
+    Collectives::Schedule scatter(int root, Collectives::Algorithm algorithm = Collectives::Algorithm::AUTO,
+                                  int group_size = 0, int group_stride = 1) const;
+    Collectives::Schedule gather(int root, Collectives::Algorithm algorithm = Collectives::Algorithm::AUTO,
+                                 int group_size = 0, int group_stride = 1) const;
+    Collectives::Schedule allreduce(Collectives::ReduceOp reduce,
+                                    Collectives::Algorithm algorithm = Collectives::Algorithm::AUTO,
+                                    int group_size = 0, int group_stride = 1) const;
+    Collectives::Schedule alltoall(Collectives::Algorithm algorithm = Collectives::Algorithm::AUTO,
+                                   int group_size = 0, int group_stride = 1) const;
 
-    MyMPI() = default;
-    ~MyMPI() = default;
-    MyMPI(const MyMPI &) = delete;
-    MyMPI &operator=(const MyMPI &) = delete;
+    // Time a message of `elements` ints keeps its sender's and its receiver's
+    // network interface busy: a rank's messages leave (and arrive) one at a time
+    SimTick wireTime(std::size_t elements) const { return network_->wireTime(elements); }
 
-    double calculateTransferTime(size_t data_size)
-    {
-        // Simulate network delay: 1ms base + 0.1ms per element
-        return 0.001 + (data_size * 0.0001);
-    }
+    // Collective message leaving source at `departure`, tagged with its round
+    Event collectiveMessage(int source, int dest, Payload data, std::size_t elements, int round, SimTick departure);
+
+    int getNumProcesses() const { return num_processes_; }
 
-    int num_processes_;
+private:
+    int num_processes_ = 0;
+    std::unique_ptr<NetworkModel> network_;
 
 };
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "event_types.hpp"
+#include "key_type.hpp"
+
+class SnapshotWriter;
+class SnapshotReader;
+
+enum class NetworkModelType {
+    FLAT,    // every message SEND_TIME + RECV_TIME, whatever its size (the costs before network models)
+    HOCKNEY, // alpha + beta * bytes (default)
+    LOGGP,   // L + 2o + (bytes - 1) G, sends of a rank at least g apart
+    LINKS,   // messages routed over the links of a topology; a link carries one message at a time
+};
+
+enum class TopologyType {
+    RING,
+    TORUS_2D,
+    TORUS_3D,
+    FAT_TREE,  // two levels: leaf switches with k hosts each, k spine switches (full bisection)
+    DRAGONFLY, // groups of routers, all-to-all local links in a group and one global link between groups
+};
+
+// Network parameters, in simulated time units and bytes
+struct NetworkConfig
+{
+    NetworkModelType model = NetworkModelType::HOCKNEY;
+    TopologyType topology = TopologyType::TORUS_2D;
+    std::vector<int> shape;    // torus dimensions, fat-tree hosts per leaf or dragonfly hosts x routers per group;
+                               // empty = derived from the number of ranks
+    double latency = 2.0;      // hockney alpha, loggp L, link model per-message software latency
+    double bandwidth = 4000.0; // bytes per time unit: 1 / beta, 1 / G, the bandwidth of every link
+    double overhead = 0.5;     // loggp o, paid by sender and receiver
+    double gap = 0.5;          // loggp g
+    double hop_latency = 0.05; // link model: per link traversed
+    std::size_t record_bytes = 0; // bytes of the record each key stands for on the wire; 0 = the key alone
+
+    std::size_t elementBytes() const { return record_bytes > 0 ? record_bytes : sizeof(Key); }
+};
+
+/** Cost of moving a message between two ranks.
+ * transferTime() is the time from the message leaving its sender until it has
+ * fully arrived; wireTime() is how long it keeps the sender's (and the
+ * receiver's) network interface busy, so a rank's messages leave and arrive
+ * one after another. Every model but LINKS is contention-free: its cost only
+ * depends on the message size.
+ */
+class NetworkModel
+{
+public:
+    virtual ~NetworkModel() = default;
+
+    // the link model books the links of the message's route from `departure` on
+    virtual SimTick transferTime(int source, int dest, std::size_t elements, SimTick departure)
+    {
+        (void)source;
+        (void)dest;
+        (void)departure;
+        return latency(elements);
+    }
+    // contention-free transfer time between neighboring ranks
+    virtual SimTick latency(std::size_t elements) const = 0;
+    virtual SimTick wireTime(std::size_t elements) const = 0;
+    // lower bound of every transferTime(), at least one tick
+    virtual SimTick minLatency() const = 0;
+
+    virtual bool contentionFree() const { return true; }
+    virtual void reset() {} // forget link bookings of an earlier run
+    // checkpoints: the link bookings, nothing for the contention-free models
+    virtual void save(SnapshotWriter &) const {}
+    virtual void load(SnapshotReader &) {}
+    virtual std::string describe() const = 0;
+
+    // link model: messages that waited for a busy link, and the time they waited in total
+    virtual std::size_t delayedMessages() const { return 0; }
+    virtual SimTick contentionDelay() const { return 0; }
+};
+
+// throws std::runtime_error if the topology shape does not fit num_ranks
+std::unique_ptr<NetworkModel> makeNetworkModel(const NetworkConfig &config, int num_ranks);
+const char *networkModelName(NetworkModelType type);
+const char *topologyName(TopologyType type);
+
+class FlatNetwork : public NetworkModel
+{
+public:
+    SimTick latency(std::size_t) const override { return SimTime::SEND_TIME + SimTime::RECV_TIME; }
+    SimTick wireTime(std::size_t) const override { return 0; }
+    SimTick minLatency() const override { return SimTime::SEND_TIME + SimTime::RECV_TIME; }
+    std::string describe() const override;
+};
+
+class HockneyNetwork : public NetworkModel
+{
+public:
+    explicit HockneyNetwork(const NetworkConfig &config);
+    SimTick latency(std::size_t elements) const override { return alpha_ + wireTime(elements); }
+    SimTick wireTime(std::size_t elements) const override;
+    SimTick minLatency() const override { return std::max<SimTick>(alpha_, 1); }
+    std::string describe() const override;
+
+private:
+    SimTick alpha_;
+    double ticks_per_byte_; // beta
+    std::size_t element_bytes_;
+};
+
+class LogGPNetwork : public NetworkModel
+{
+public:
+    explicit LogGPNetwork(const NetworkConfig &config);
+    SimTick latency(std::size_t elements) const override;
+    SimTick wireTime(std::size_t elements) const override;
+    SimTick minLatency() const override { return std::max<SimTick>(latency_ + 2 * overhead_, 1); }
+    std::string describe() const override;
+
+private:
+    SimTick latency_;  // L
+    SimTick overhead_; // o
+    SimTick gap_;      // g
+    double ticks_per_byte_; // G
+    std::size_t element_bytes_;
+};
+
+class LinkNetwork : public NetworkModel
+{
+public:
+    LinkNetwork(const NetworkConfig &config, int num_ranks);
+
+    SimTick transferTime(int source, int dest, std::size_t elements, SimTick departure) override;
+    SimTick latency(std::size_t elements) const override;
+    SimTick wireTime(std::size_t elements) const override;
+    SimTick minLatency() const override { return std::max<SimTick>(latency_ + hop_latency_, 1); }
+    bool contentionFree() const override { return false; }
+    void reset() override;
+    void save(SnapshotWriter &out) const override;
+    void load(SnapshotReader &in) override;
+    std::string describe() const override;
+    std::size_t delayedMessages() const override { return delayed_; }
+    SimTick contentionDelay() const override { return waited_; }
+
+    // vertices from source to dest: ranks are vertices 0..P-1, switches / routers follow
+    std::vector<int> route(int source, int dest) const;
+
+private:
+    void torusRoute(std::vector<int> &path, int source, int dest) const;
+    void fatTreeRoute(std::vector<int> &path, int source, int dest) const;
+    void dragonflyRoute(std::vector<int> &path, int source, int dest) const;
+
+    TopologyType topology_;
+    int num_ranks_;
+    std::vector<int> shape_;
+    SimTick latency_;
+    SimTick hop_latency_;
+    double ticks_per_byte_;
+    std::size_t element_bytes_;
+    int neighbor_hops_; // links between rank 0 and rank 1
+
+    std::unordered_map<std::uint64_t, SimTick> link_free_; // directed link (from << 32 | to) -> free from
+    std::size_t delayed_ = 0;
+    SimTick waited_ = 0;
+};
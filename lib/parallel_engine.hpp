@@ -0,0 +1,19 @@
+#pragma once
+
+#include "event_types.hpp"
+
+class TraceWriter;
+
+// Multi-threaded execution backend of EventSimulator. While one runs, every
+// EventSimulator::scheduleEvent call is routed to it.
+class ParallelEngine
+{
+public:
+    virtual ~ParallelEngine() = default;
+
+    // process all pending events; processed events are traced to `trace` if given
+    virtual void run(TraceWriter *trace) = 0;
+
+    // accept an event scheduled by a handler (or before run)
+    virtual void schedule(Event event) = 0;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+#include "key_type.hpp"
+
+class PayloadPool;
+
+// Per-run statistics of a PayloadPool
+struct PoolStats
+{
+    std::size_t bytes_allocated = 0;   // slab bytes requested from the system
+    std::size_t bytes_in_use = 0;      // bytes of buffers currently handed out
+    std::size_t peak_bytes_in_use = 0; // high-water mark of bytes_in_use
+    std::size_t acquires = 0;          // buffers handed out
+    std::size_t reuses = 0;            // ... of which came from a free list
+
+    double reuseRate() const { return acquires == 0 ? 0.0 : static_cast<double>(reuses) / acquires; }
+};
+
+/** Reference-counted handle to a key buffer owned by a PayloadPool.
+ * Copying a Payload shares the buffer, so message data is written once by the
+ * sender and handed to the receiver without further copies. The buffer goes
+ * back to its pool when the last handle is dropped.
+ */
+class Payload
+{
+public:
+    Payload() = default;
+    Payload(const Payload &other) : block_(other.block_) { retain(); }
+    Payload(Payload &&other) noexcept : block_(other.block_) { other.block_ = nullptr; }
+    Payload &operator=(const Payload &other);
+    Payload &operator=(Payload &&other) noexcept;
+    ~Payload() { release(); }
+
+    const Key *data() const;
+    Key *mutableData(); // only valid while this is the only handle
+    std::size_t size() const;
+    bool empty() const { return size() == 0; }
+    bool unique() const;
+    // sortedness travels with the buffer so receivers need not re-sort;
+    // set by the writer, only while this is the only handle
+    bool isSorted() const;
+    void setSorted(bool sorted);
+
+    const Key *begin() const { return data(); }
+    const Key *end() const { return data() + size(); }
+    Key operator[](std::size_t i) const { return data()[i]; }
+
+    Payload clone() const; // private copy from the same pool
+
+private:
+    friend class PayloadPool;
+    struct Block;
+
+    explicit Payload(Block *block);
+    void retain();
+    void release();
+
+    Block *block_ = nullptr;
+};
+
+/** Slab allocator for message buffers.
+ * Buffers are rounded up to power-of-two size classes and carved out of
+ * slabs of at least SLAB_BYTES; released buffers go onto a per-class free
+ * list and are handed out again before any new slab is requested.
+ * Acquire and release are thread-safe, payloads cross partition threads.
+ */
+class PayloadPool
+{
+public:
+    PayloadPool() = default;
+    ~PayloadPool();
+    PayloadPool(const PayloadPool &) = delete;
+    PayloadPool &operator=(const PayloadPool &) = delete;
+
+    // buffer of `count` uninitialized keys
+    Payload acquire(std::size_t count);
+    // buffer holding a copy of [data, data + count)
+    Payload copyOf(const Key *data, std::size_t count);
+    Payload copyOf(const std::vector<Key> &data) { return copyOf(data.data(), data.size()); }
+
+    PoolStats stats() const;
+    void resetStats(); // start a new run, keeping the slabs for reuse
+
+private:
+    friend class Payload;
+
+    static constexpr std::size_t SLAB_BYTES = std::size_t(1) << 20;
+    static constexpr std::size_t MIN_CLASS_ELEMENTS = 16;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    static std::size_t sizeClass(std::size_t count);
+    static std::size_t blockBytes(std::size_t size_class);
+    void grow(std::size_t size_class);
+    void recycle(Payload::Block *block);
+
+    std::vector<Payload::Block *> free_lists_; // indexed by size class
+    std::vector<void *> slabs_;
+    PoolStats stats_;
+    mutable std::mutex mutex_;
+};
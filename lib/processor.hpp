@@ -1,72 +1,141 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <algorithm>
 #include <string>
 
-#include "utils.hpp"
 #include "event_types.hpp"
+#include "processor_store.hpp"
+#include "matching_engine.hpp"
+#include "sort_kernels.hpp"
 
 // Forward declaration
 class EventSimulator;
+class SnapshotWriter;
+class SnapshotReader;
+
+// Read-only view of a rank's data slice
+struct DataView
+{
+    const Key *ptr;
+    std::size_t count;
+
+    const Key *data() const { return ptr; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Key *begin() const { return ptr; }
+    const Key *end() const { return ptr + count; }
+    Key operator[](std::size_t i) const { return ptr[i]; }
+};
 
 class Processor
 {
 public:
-    // constr
-    Processor(int rank, int num_processes)
-        : rank_(rank), num_processes_(num_processes)
+    // Copy of the state an event may change, for optimistic rollback
+    struct SavedState
     {
-        // Initialize workspace array
-        workspace_.reserve(1000); // Reserve space for merging
-        setNeighbors();
+        bool has_local = false;       // local data is only saved when the event rewrites it
+        std::vector<Key> local_data;
+        Payload received_data;        // shared handle, no copy
+        bool sorted = false;
+        MatchingEngine mailbox;
+        std::array<Request, 2> phase_requests;
+        std::size_t bytes() const { return local_data.size() * sizeof(Key) + mailbox.bytes(); }
+    };
 
-    }
-
-    // Set the local data for this processor
-    void setData(const std::vector<int> &data)
+    // constr: a view of the rank's two slices in the store
+    Processor(int rank, int num_processes, const ProcessorStore &store)
+        : rank_(rank), num_processes_(num_processes), elements_(store.elements())
     {
-        local_data_ = std::vector<int>(data); // Create a copy of the input data
-        received_data_.clear();
-        workspace_.clear();
+        planes_[0] = store.slice(rank, 0);
+        planes_[1] = store.slice(rank, 1);
     }
-    void setNeighbors();
-  
+
+    // Set the local data for this processor: copied into its slice, or kept
+    // aside when a sort left it with another element count
+    void setData(const std::vector<Key> &data, bool sorted = false);
+    void setData(std::vector<Key> &&data, bool sorted = false);
+    void setData(const Key *data, std::size_t count, bool sorted = false);
+    // the input is already in the rank's plane 0 slice (ProcessorStore::mapInput)
+    void adoptSliceData();
 
     // Get the local data
-    const std::vector<int> &getData() const
+    DataView getData() const
     {
-        return local_data_;
+        return in_slice_ ? DataView{local(), elements_} : DataView{resized_.data(), resized_.size()};
     }
-    const std::vector<int> &getReceived() const {
+    const Payload &getReceived() const {
         return received_data_;
     }
 
-    void setReceived(const std::vector<int> &data)
+    // take over the message buffer, no copy
+    void setReceived(Payload data)
     {
-        received_data_ = std::vector<int>(data);
+        received_data_ = std::move(data);
         // printVector(received_data_, "processor successfully received##");
     }
     void receiveMessage(); // get message data to its local cache
 
-    void localSort(); // sort local cache
+    void sortLocalData(); // sort local cache once, no-op afterwards
+    void localSort(); // sort local and received caches where needed
+    bool isSorted() const { return sorted_; }
+
+    // compare-split with the received data, keeping its lower or upper half;
+    // true if local data changed. Without a full received slice it returns
+    // false when `speculative` (Time Warp may run ahead of the message) and
+    // throws otherwise
+    bool handleMerge(bool keepLow, bool speculative = false);
+    // whether any compare-split changed local data since the last call
+    bool takeChanged()
+    {
+        bool changed = changed_;
+        changed_ = false;
+        return changed;
+    }
+
+    // matching of the rank's point-to-point messages
+    MatchingEngine &mailbox() { return mailbox_; }
+    const MatchingEngine &mailbox() const { return mailbox_; }
+    // the compare-split phase in progress: its irecv and isend
+    std::array<Request, 2> &phaseRequests() { return phase_requests_; }
+
+    // blocks of the current collective: its input before, its result after it
+    // (the algorithm's slots while it runs)
+    std::vector<std::vector<Key>> &collectiveBuffer() { return collective_buffer_; }
+    const std::vector<std::vector<Key>> &collectiveBuffer() const { return collective_buffer_; }
 
-    void handleMerge(bool isOddPhase);
+    SavedState saveState(bool with_local) const;
+    void restoreState(SavedState state);
+
+    // checkpoints: data, received message, requests and mailbox
+    void save(SnapshotWriter &out) const;
+    void load(SnapshotReader &in);
 
     int getRank() const { return rank_; }
-    int getNeighbor(bool isOddPhase) {
-        return (isOddPhase ? odd_neighbor : even_neighbor);
-    }
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+    void setKernels(SortKernels::Isa kernels) { kernels_ = kernels; } // resolved, not AUTO
 
 private:
+    Key *local() const { return planes_[current_]; } // Local array holding processor's numbers
+    Key *spare() const { return planes_[current_ ^ 1]; } // Merge target / sort scratch
+
     int rank_;
-    int odd_neighbor;
-    int even_neighbor;
     int num_processes_;
     double processor_time = 0.;
-    std::vector<int> local_data_;    // Local array holding processor's numbers
-    std::vector<int> received_data_; // Array holding received data
-    std::vector<int> workspace_;     // Workspace array for merging
+    bool verbose_ = true;
+    bool sorted_ = false;            // local data is ascending
+    bool changed_ = false;           // a compare-split changed local data
+    SortKernels::Isa kernels_ = SortKernels::Isa::SCALAR; // of the simulation
+    Key *planes_[2];                 // this rank's slices in the ProcessorStore
+    std::size_t elements_;
+    int current_ = 0;                // plane holding the local data
+    bool in_slice_ = true;           // false: the data is resized_ (element count changed)
+    std::vector<Key> resized_;
+    Payload received_data_;          // Neighbor's array, shared with the message
+    std::array<Request, 2> phase_requests_{REQUEST_NULL, REQUEST_NULL};
+    MatchingEngine mailbox_;
+    std::vector<std::vector<Key>> collective_buffer_;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+
+#include "key_type.hpp"
+
+/** One arena holding every rank's data.
+ * Two planes of num_ranks fixed-stride slices: a rank's local data lives in
+ * one plane and its merge target in the same slot of the other, and a
+ * compare-split swaps which is which. Slices are padded to a cache line so
+ * ranks never share one. Large arenas come straight from mmap with
+ * transparent huge pages requested; pages are placed by first touch
+ * (Processor::setData). An input file can stand in for plane 0 (mapInput).
+ */
+class ProcessorStore
+{
+public:
+    ProcessorStore() = default;
+    ~ProcessorStore() { release(); }
+    ProcessorStore(const ProcessorStore &) = delete;
+    ProcessorStore &operator=(const ProcessorStore &) = delete;
+
+    // lay out num_ranks ranks of elements_per_rank keys each; the arena is kept
+    // if it is large enough (and holds no input mapping), else reallocated
+    void init(int num_ranks, std::size_t elements_per_rank);
+
+    // plane 0 becomes a private (copy-on-write) mapping of the file's first
+    // num_ranks x elements keys, rank 0 first: ranks read their input straight
+    // from the page cache and a page is only copied when its rank first writes
+    // to it. Needs a mapped arena whose slices are not padded (elements
+    // filling whole cache lines); false, and nothing changed, otherwise. The
+    // file must hold that many keys. Throws std::runtime_error if the mapping fails.
+    bool mapInput(int fd);
+
+    // slice of `rank` in plane 0 or 1
+    Key *slice(int rank, int plane) const
+    {
+        return arena_ + (static_cast<std::size_t>(plane) * num_ranks_ + rank) * stride_;
+    }
+
+    int ranks() const { return num_ranks_; }
+    std::size_t elements() const { return elements_; }
+    std::size_t strideBytes() const { return stride_ * sizeof(Key); }
+    std::size_t arenaBytes() const { return bytes_; }
+    bool hugePages() const { return huge_pages_; }
+    bool inputMapped() const { return input_mapped_; }
+
+private:
+    static constexpr std::size_t ALIGNMENT = 64;              // cache line
+    static constexpr std::size_t HUGE_PAGE_BYTES = 2u << 20; // mmap + THP from this size on
+
+    void release();
+
+    Key *arena_ = nullptr;
+    std::size_t bytes_ = 0;    // in use by the current layout
+    std::size_t capacity_ = 0; // allocated
+    std::size_t stride_ = 0; // keys per slice, elements_ rounded up to a cache line
+    std::size_t elements_ = 0;
+    int num_ranks_ = 0;
+    bool mapped_ = false;
+    bool huge_pages_ = false;
+    bool input_mapped_ = false; // plane 0 maps an input file
+};
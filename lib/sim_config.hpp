@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+
+#include "event_queue.hpp"
+#include "sort_kernels.hpp"
+#include "collectives.hpp"
+#include "sort_algorithm.hpp"
+#include "network_model.hpp"
+#include "matching_engine.hpp"
+#include "workload.hpp"
+
+enum class EventGeneration {
+    LAZY,  // schedule phase i+1 of a processor when its phase i compare-split finishes (default)
+    EAGER, // schedule every phase at START_SORT
+};
+
+enum class EngineType {
+    SEQUENTIAL,   // single-threaded pop/dispatch loop (default)
+    CONSERVATIVE, // multi-threaded, bounded-lag time windows
+    TIME_WARP,    // multi-threaded, optimistic with rollback
+    THREADS,      // sequential prediction, then the compare-split sort on real threads for comparison
+};
+
+// Run-time options of the simulator, set from "--name=value" command line flags
+struct SimConfig
+{
+    QueueType queue_type = QueueType::CALENDAR;
+    EventGeneration event_generation = EventGeneration::LAZY;
+    EngineType engine = EngineType::SEQUENTIAL;
+    int threads = 0;      // worker threads of parallel engines and real threads, 0 = hardware concurrency
+    double time_warp_window = 100.0; // Time Warp optimism bound in time units, 0 = unbounded
+    bool early_termination = false; // stop once a phase pair changes nothing (allreduce after each pair)
+    // --phase-delay: fixed slot between the SENDs of consecutive compare-split phases in time
+    // units; 0 = none, a phase starts once its message and the previous compare-split allow
+    double phase_delay = ticksToUnits(SimTime::PHASE_DELAY);
+    SortKernels::Isa kernels = SortKernels::Isa::AUTO; // instruction set of the sort / merge kernels
+    std::string trace_file = "event_trace.bin"; // binary event trace, empty = none
+    std::string timeline_file; // --timeline: per-rank spans and critical path as Chrome trace JSON, empty = none
+    std::string checkpoint_file;         // --checkpoint: snapshot of the run, rewritten as it goes; empty = none
+    double checkpoint_interval = 10000.0; // simulated time units between checkpoints
+    std::string resume_file;             // --resume: continue from this snapshot instead of new data
+    WorkloadConfig workload; // --dist / --seed: the generated input
+    std::string input_file;  // --input: binary file of native ints, P x N of them, instead of random data
+    std::string output_file; // --output: the sorted data, rank by rank, as native ints
+    NetworkConfig network; // message costs of the sort and the collectives
+    MatchingMode matching = MatchingMode::HASHED; // point-to-point matching of compare-split messages
+    SortAlgorithmType sort_algorithm = SortAlgorithmType::ODD_EVEN;
+    bool compare_sorts = false; // --compare: run every sort algorithm on the same input, print a table
+    std::string batch_file;     // --batch: run the simulations listed in this file instead
+    int jobs = 0;               // --batch: simulations run at once, 0 = hardware concurrency
+    // --collective: run one collective over each rank's data instead of the sort
+    bool run_collective = false;
+    Collectives::Op collective = Collectives::Op::BCAST;
+    bool collective_varying = false; // scatterv / gatherv / alltoallv: blocks of random sizes
+    Collectives::Algorithm collective_algorithm = Collectives::Algorithm::AUTO;
+    Collectives::ReduceOp collective_reduce = Collectives::ReduceOp::SUM;
+    int collective_root = 0;
+    bool verbose = true;  // per-event and per-element console output
+};
+
+// Parse one "--name=value" option into config; returns false if the option is
+// unknown and throws std::invalid_argument if its value is malformed
+bool parseSimOption(const std::string &arg, SimConfig &config);
+
+// Usage lines for all options
+std::string simOptionsUsage();
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+
+// Bitonic merge loop shared by the per-instruction-set kernel files. Each of
+// them is compiled with its own -m flags and instantiates mergeRuns with a
+// vector type V providing:
+//   Reg, WIDTH                  register type and number of ints in it
+//   load(p), store(p, r)        unaligned load / store
+//   reverse(r), invert(r)       reverse the lanes, bitwise NOT every lane
+//   network(a, b)               a, b sorted -> a = lower WIDTH, b = upper WIDTH, sorted
+namespace SortKernels
+{
+    namespace detail
+    {
+        void mergeSse41(const int *a, const int *b, int *out, std::size_t n, bool high);
+        void mergeAvx2(const int *a, const int *b, int *out, std::size_t n, bool high);
+        void mergeAvx512(const int *a, const int *b, int *out, std::size_t n, bool high);
+
+        // A run read front to back, or (High) back to front with every value
+        // inverted: ~x reverses the order of ints without overflow, so the
+        // upper half of a merge is the lower half of the inverted runs
+        template <class V, bool High>
+        struct Run
+        {
+            const int *data;
+            std::size_t n;
+
+            int at(std::size_t i) const { return High ? ~data[n - 1 - i] : data[i]; }
+            typename V::Reg load(std::size_t i) const
+            {
+                return High ? V::invert(V::reverse(V::load(data + n - V::WIDTH - i))) : V::load(data + i);
+            }
+        };
+
+        template <class V, bool High>
+        void mergeRuns(const int *a, const int *b, int *out, std::size_t n)
+        {
+            constexpr std::size_t W = V::WIDTH;
+            const Run<V, High> ra{a, n}, rb{b, n};
+            std::size_t k = 0, ia = 0, ib = 0;
+
+            // elements still in the upper register when the vector loop stops
+            int spill[W];
+            std::size_t is = W;
+
+            if (n >= W)
+            {
+                typename V::Reg va = ra.load(0), vb = rb.load(0);
+                ia = ib = W;
+                for (;;)
+                {
+                    V::network(va, vb);
+                    if (High)
+                        V::store(out + n - W - k, V::reverse(V::invert(va)));
+                    else
+                        V::store(out + k, va);
+                    k += W;
+                    if (k + W > n)
+                        break;
+
+                    // the next block comes from the run with the smaller head
+                    bool take_a = ib >= n || (ia < n && ra.at(ia) <= rb.at(ib));
+                    if (take_a)
+                    {
+                        if (ia + W > n)
+                            break;
+                        va = ra.load(ia);
+                        ia += W;
+                    }
+                    else
+                    {
+                        if (ib + W > n)
+                            break;
+                        va = rb.load(ib);
+                        ib += W;
+                    }
+                }
+                V::store(spill, vb);
+                is = 0;
+            }
+
+            // scalar tail (shorter than two blocks): merge spill and both run remainders
+            while (k < n)
+            {
+                bool has_s = is < W, has_a = ia < n, has_b = ib < n;
+                int value;
+                if (has_s && (!has_a || spill[is] <= ra.at(ia)) && (!has_b || spill[is] <= rb.at(ib)))
+                    value = spill[is++];
+                else if (has_a && (!has_b || ra.at(ia) <= rb.at(ib)))
+                    value = ra.at(ia++);
+                else
+                    value = rb.at(ib++);
+
+                if (High)
+                    out[n - 1 - k] = ~value;
+                else
+                    out[k] = value;
+                ++k;
+            }
+        }
+    }
+}
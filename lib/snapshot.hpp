@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "event_types.hpp"
+#include "mapped_file.hpp"
+#include "payload_pool.hpp"
+
+// On-disk layout of a simulation checkpoint (EventSimulator::writeCheckpoint):
+// one SnapshotHeader, the state section (scalars, queues and mailboxes in the
+// order the simulator saves them), then the data section, 64-byte aligned:
+// the key arrays (rank data, message payloads) in the order they were put.
+// Native byte order.
+
+constexpr char SNAPSHOT_MAGIC[8] = {'O', 'E', 'S', 'N', 'A', 'P', 'S', 'H'};
+constexpr std::uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;   // sizeof(SnapshotHeader), checked by readers
+    std::int64_t ticks_per_unit;
+    std::int32_t num_processes;
+    std::int32_t elements_per_processor;
+    std::uint64_t state_bytes;
+    std::uint64_t data_offset;   // from the start of the file
+    std::uint64_t data_keys;
+    std::uint32_t key_bytes;     // sizeof(Key) of the writing build
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout changed");
+
+/** Builds a snapshot and writes it in one go.
+ * Scalars go into an in-memory state section; key arrays are only recorded
+ * by reference and copied once, straight into a shared mapping of the file,
+ * when write() runs, so they must stay alive and unchanged until then.
+ * Payloads shared by several holders are stored once and shared again on
+ * restore.
+ */
+class SnapshotWriter
+{
+public:
+    template <class T>
+    void put(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "put() takes plain data");
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        state_.insert(state_.end(), bytes, bytes + sizeof(T));
+    }
+    template <class T>
+    void putVector(const std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "putVector() takes plain data");
+        put<std::uint64_t>(values.size());
+        const char *bytes = reinterpret_cast<const char *>(values.data());
+        state_.insert(state_.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+    void putString(const std::string &value);
+    void putKeys(const Key *data, std::size_t count); // into the data section
+    void putPayload(const Payload &payload);
+    void putEvent(const Event &event);
+
+    // write to path + ".tmp" and rename it over `path`, so an interrupted
+    // write leaves the previous snapshot intact; throws std::runtime_error
+    void write(const std::string &path, int num_processes, int elements_per_processor) const;
+
+private:
+    struct Keys
+    {
+        const Key *data;
+        std::size_t count;
+    };
+
+    std::vector<char> state_;
+    std::vector<Keys> data_;
+    std::size_t data_keys_ = 0;
+    std::unordered_map<const Key *, std::int64_t> payloads_; // by buffer, index in order of first put
+};
+
+/** Reads a snapshot back through a read-only mapping of the file, in the
+ * order it was written. Throws std::runtime_error for a file that is not a
+ * snapshot of this version and key type or ends early.
+ */
+class SnapshotReader
+{
+public:
+    // payloads are rebuilt in `pool`
+    SnapshotReader(const std::string &path, PayloadPool &pool);
+
+    const SnapshotHeader &header() const { return *reinterpret_cast<const SnapshotHeader *>(file_.data()); }
+
+    template <class T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "get() returns plain data");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    template <class T>
+    void getVector(std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "getVector() takes plain data");
+        std::size_t count = get<std::uint64_t>();
+        const char *bytes = take(count * sizeof(T));
+        values.resize(count);
+        if (count > 0)
+            std::memcpy(values.data(), bytes, count * sizeof(T));
+    }
+    std::string getString();
+    const Key *getKeys(std::size_t count); // points into the mapping, valid while the reader lives
+    Payload getPayload();
+    Event getEvent();
+
+    bool stateConsumed() const { return state_pos_ == header().state_bytes; }
+
+private:
+    const char *take(std::size_t bytes); // the next `bytes` of the state section
+
+    MappedFile file_;
+    PayloadPool &pool_;
+    std::size_t state_pos_ = 0;
+    std::size_t data_pos_ = 0; // keys
+    std::vector<Payload> payloads_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "event_types.hpp"
+
+class EventSimulator;
+
+enum class SortAlgorithmType {
+    ODD_EVEN,   // odd-even transposition: P compare-split phases (default)
+    BITONIC,    // bitonic sort: log P (log P + 1) / 2 compare-split phases, P a power of two
+    SAMPLE,     // sample sort: regular samples, splitters, one alltoallv
+    HYPERQUICK, // hyperquicksort: log P rounds of pivot bcast and pairwise exchange, P a power of two
+};
+
+/** A parallel sort driven by the EventSimulator.
+ * Compare-split networks (odd-even, bitonic) are a fixed sequence of phases in
+ * which a rank exchanges its data with one partner and keeps the lower or
+ * upper half; the simulator schedules their SEND / RECV / COMPARE_SPLIT events
+ * itself, lazily or eagerly and on every engine. The other sorts take over at
+ * START_SORT: they run collectives and schedule SORT_STEP events for their
+ * local work (sequential engine).
+ */
+class SortAlgorithm
+{
+public:
+    explicit SortAlgorithm(int num_processes) : num_processes_(num_processes) {}
+    virtual ~SortAlgorithm() = default;
+
+    virtual SortAlgorithmType type() const = 0;
+
+    // compare-split networks: number of phases, partner of `rank` in `phase`
+    // (-1 if it sits the phase out) and whether it keeps the lower half of the split
+    virtual bool comparesSplits() const { return false; }
+    virtual int phases() const { return 0; }
+    virtual int partner(int rank, int phase) const;
+    virtual bool keepsLow(int rank, int phase) const { return rank < partner(rank, phase); }
+
+    // the other sorts: called at START_SORT, then for each of their SORT_STEP events
+    virtual void start(EventSimulator &simulator, SimTick time);
+    virtual void step(EventSimulator &simulator, const Event &event);
+
+protected:
+    void scheduleStep(EventSimulator &simulator, SimTick time, int step) const;
+    // merge sorted runs into one sorted vector
+    static std::vector<Key> mergeRuns(std::vector<std::vector<Key>> &runs);
+
+    int num_processes_;
+};
+
+// throws std::runtime_error if the algorithm cannot sort on num_processes ranks
+std::unique_ptr<SortAlgorithm> makeSortAlgorithm(SortAlgorithmType type, int num_processes);
+const char *sortAlgorithmName(SortAlgorithmType type);  // command line name
+const char *sortAlgorithmTitle(SortAlgorithmType type); // for reports
+
+class OddEvenSort : public SortAlgorithm
+{
+public:
+    using SortAlgorithm::SortAlgorithm;
+    SortAlgorithmType type() const override { return SortAlgorithmType::ODD_EVEN; }
+    bool comparesSplits() const override { return true; }
+    int phases() const override { return num_processes_; }
+    int partner(int rank, int phase) const override;
+};
+
+class BitonicSort : public SortAlgorithm
+{
+public:
+    explicit BitonicSort(int num_processes);
+    SortAlgorithmType type() const override { return SortAlgorithmType::BITONIC; }
+    bool comparesSplits() const override { return true; }
+    int phases() const override { return static_cast<int>(stage_.size()); }
+    int partner(int rank, int phase) const override { return rank ^ (1 << bit_[phase]); }
+    bool keepsLow(int rank, int phase) const override;
+
+private:
+    std::vector<int> stage_; // merge stage of each phase: bitonic sequences of 2^(stage + 1) ranks
+    std::vector<int> bit_;   // the partner differs in this bit
+};
+
+class SampleSort : public SortAlgorithm
+{
+public:
+    using SortAlgorithm::SortAlgorithm;
+    SortAlgorithmType type() const override { return SortAlgorithmType::SAMPLE; }
+    void start(EventSimulator &simulator, SimTick time) override;
+    void step(EventSimulator &simulator, const Event &event) override;
+
+private:
+    enum Step { LOCAL_SORT, SPLITTERS, PARTITION, MERGE };
+};
+
+class HyperQuickSort : public SortAlgorithm
+{
+public:
+    explicit HyperQuickSort(int num_processes);
+    SortAlgorithmType type() const override { return SortAlgorithmType::HYPERQUICK; }
+    void start(EventSimulator &simulator, SimTick time) override;
+    void step(EventSimulator &simulator, const Event &event) override;
+
+private:
+    enum Step { LOCAL_SORT, EXCHANGE, MERGE };
+    void broadcastPivots(EventSimulator &simulator, SimTick time);
+
+    int dimensions_;
+    int dimension_ = 0; // hypercube dimension of the current round, counting down
+};
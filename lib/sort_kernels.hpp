@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sort and merge kernels used by Processor, with SIMD versions picked at run
+// time from the CPU's feature flags. Stateless: every simulation passes the
+// instruction set it resolved, so simulations in one process may differ.
+// Overloaded for every key type a build can choose (key_type.hpp): int gets
+// the vector merges, int64 and float a radix sort on their order-preserving
+// bit patterns and the scalar merge.
+namespace SortKernels
+{
+    enum class Isa {
+        AUTO,   // best one the CPU and the build support (default)
+        SCALAR, // std::sort and a branchy two-pointer merge
+        SSE41,  // 4-wide bitonic merge, radix sort
+        AVX2,   // 8-wide bitonic merge, radix sort
+        AVX512, // 16-wide bitonic merge, radix sort
+    };
+
+    // Best instruction set available on this machine
+    Isa detectIsa();
+    bool isSupported(Isa isa);
+    const char *isaName(Isa isa);
+
+    // The instruction set `isa` stands for, the detected one for AUTO; throws
+    // std::runtime_error if the CPU or the build lacks it
+    Isa resolve(Isa isa);
+
+    // Sort data[0, n) ascending; scratch must hold n elements
+    void sort(Isa isa, int *data, int *scratch, std::size_t n);
+    void sort(Isa isa, std::int64_t *data, std::int64_t *scratch, std::size_t n);
+    void sort(Isa isa, float *data, float *scratch, std::size_t n);
+    // The n smallest (mergeLow) or largest (mergeHigh) of two sorted runs of
+    // n elements, written sorted to out; out must not alias a or b
+    void mergeLow(Isa isa, const int *a, const int *b, int *out, std::size_t n);
+    void mergeHigh(Isa isa, const int *a, const int *b, int *out, std::size_t n);
+    void mergeLow(Isa isa, const std::int64_t *a, const std::int64_t *b, std::int64_t *out, std::size_t n);
+    void mergeHigh(Isa isa, const std::int64_t *a, const std::int64_t *b, std::int64_t *out, std::size_t n);
+    void mergeLow(Isa isa, const float *a, const float *b, float *out, std::size_t n);
+    void mergeHigh(Isa isa, const float *a, const float *b, float *out, std::size_t n);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "sort_algorithm.hpp"
+#include "sort_kernels.hpp"
+#include "spsc_queue.hpp"
+
+// Wall-clock timing of one compare-split phase on real threads, in seconds
+// from the start of the run
+struct MeasuredPhase
+{
+    double start = 0.0;    // the first rank sent
+    double finish = 0.0;   // the last rank finished its compare-split
+    double exchange = 0.0; // summed over ranks: sending until the partner's data is in, waiting included
+    double merge = 0.0;    // summed over ranks: the compare-split itself
+    // summed over ranks: from the rank's previous compare-split done (for the
+    // first, both partners' local sorts done) to this one done; ranks run ahead
+    // of each other, so phases overlap and finish - previous finish is no phase length
+    double step = 0.0;
+    int ranks = 0;         // ranks taking part
+
+    double span() const { return finish - start; }
+};
+
+struct ThreadRunStats
+{
+    int workers = 0;
+    double wall = 0.0;       // seconds, local sorts included
+    double local_sort = 0.0; // seconds until the last rank had sorted its data
+    std::size_t messages = 0;
+    std::size_t full_mailboxes = 0; // sends retried because the partner's mailbox was full
+    std::vector<MeasuredPhase> phases;
+};
+
+/** Runs a compare-split sort network for real, to validate simulated times.
+ * Every rank is a small state machine (send phase k, wait for the partner's
+ * data, compare-split, on to phase k + 1) driven by one of `threads` workers:
+ * one worker per rank, or M:N with several ranks per worker served round
+ * robin, so a rank waiting for its partner never blocks the others. Ranks
+ * exchange their data through lock-free single-producer single-consumer
+ * mailboxes, one per directed pair of partners; message buffers circulate
+ * between ranks and are never copied twice or reallocated.
+ */
+class ThreadBackend
+{
+public:
+    // threads: 0 = hardware concurrency, at most one per rank
+    ThreadBackend(const SortAlgorithm &algorithm, int num_ranks, int threads, SortKernels::Isa kernels);
+
+    // sorts `data` (indexed by rank, equal sizes) in place
+    ThreadRunStats run(std::vector<std::vector<Key>> &data);
+
+private:
+    using Mailbox = SpscQueue<std::vector<Key>, 4>;
+
+    struct Step
+    {
+        int phase;
+        int partner;
+        bool keep_low;
+        int in;  // mailbox the partner sends to
+        int out; // mailbox of the partner
+    };
+
+    // per step: sent, data in, compare-split done (seconds after the start)
+    struct StepTimes
+    {
+        double sent = 0.0;
+        double received = 0.0;
+        double done = 0.0;
+    };
+
+    struct alignas(64) Rank
+    {
+        std::vector<Step> steps;
+        std::size_t next = 0; // step in progress
+        bool sent = false;    // its message is out, waiting for the partner's
+        std::vector<Key> data, spare, outgoing, incoming;
+        std::vector<StepTimes> times;
+        double sorted = 0.0;
+        std::size_t full_mailboxes = 0;
+    };
+
+    // advance the rank as far as it goes without waiting; true if it did anything
+    bool advance(Rank &rank);
+    void workerLoop(int worker);
+    double now() const;
+
+    int num_ranks_;
+    int workers_;
+    SortKernels::Isa kernels_;
+    int phases_;
+    std::vector<Rank> ranks_;
+    std::unique_ptr<Mailbox[]> mailboxes_;
+    long long start_ = 0; // steady clock, nanoseconds
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <exception>
+#include <limits>
+
+#include "parallel_engine.hpp"
+#include "event_queue.hpp"
+#include "processor.hpp"
+#include "barrier.hpp"
+#include "trace_format.hpp"
+
+class EventSimulator;
+
+/** Optimistic parallel engine (Jefferson's Time Warp).
+ * Ranks are split into contiguous blocks, one per worker thread. Workers run
+ * their pending events in (time, sequence) order without waiting for each
+ * other, saving beforehand the part of the owner's Processor state the event
+ * can change. A message that arrives in a worker's past (a straggler) rolls
+ * the worker back: later events are undone in reverse order, their state
+ * restored, and every message they sent is cancelled - locally by removing
+ * it, remotely by an anti-message that annihilates it or rolls its receiver
+ * back in turn. Periodically all workers stop to compute the global virtual
+ * time (GVT), the earliest time any rollback can still reach; events before
+ * it are committed, logged and their saved state reclaimed. Optimism can be
+ * bounded by a moving time window: no event later than GVT + window runs.
+ */
+class TimeWarpEngine : public ParallelEngine
+{
+public:
+    // window: optimism bound in ticks, 0 = unbounded
+    TimeWarpEngine(EventSimulator &simulator, int threads, SimTick window);
+    ~TimeWarpEngine() override;
+
+    void run(TraceWriter *trace) override;
+    void schedule(Event event) override;
+
+private:
+    static constexpr SimTick NO_EVENT = std::numeric_limits<SimTick>::max();
+    static constexpr std::size_t GVT_INTERVAL = 4096; // events a worker executes between GVT rounds
+    static constexpr int IDLE_POLLS = 256;                  // empty polls before an idle worker asks for GVT
+
+    using EventKey = std::pair<SimTick, std::uint64_t>; // (time, sequence) identifies an event
+
+    struct Sent
+    {
+        EventKey key;
+        int partition;
+    };
+
+    struct Processed
+    {
+        Event event;
+        Processor::SavedState saved;
+        std::vector<Sent> sent; // messages this event scheduled
+    };
+
+    struct Incoming
+    {
+        EventKey key;
+        std::optional<Event> event; // empty for an anti-message
+    };
+
+    struct Partition
+    {
+        std::map<EventKey, Event> pending;
+        std::deque<Processed> processed; // uncommitted, in processing order
+        Processed *current = nullptr;    // record of the event being dispatched
+
+        std::mutex inbox_mutex;
+        std::vector<Incoming> inbox;
+
+        std::uint64_t next_sequence = 0;
+        std::vector<TraceRecord> trace; // committed since the last GVT round
+        SimTick last_committed = 0;
+        SimTick local_min = NO_EVENT;
+
+        std::size_t executed = 0;
+        std::size_t since_gvt = 0;
+        std::size_t committed = 0;
+        MessageCount traffic; // of the committed events
+        std::size_t rollbacks = 0;
+        std::size_t rolled_back = 0;
+        std::size_t anti_messages = 0;
+        std::size_t remote = 0;
+        std::size_t saved_bytes = 0;
+        std::size_t peak_saved_bytes = 0;
+        std::size_t pending_high_water = 0;
+        std::exception_ptr error;
+    };
+
+    static EventKey keyOf(const Event &event) { return EventKey(event.getTime(), event.getSequence()); }
+
+    int partitionOf(int rank) const { return static_cast<int>(static_cast<long long>(rank) * workers_ / num_ranks_); }
+    std::uint64_t makeSequence(std::uint64_t counter, int origin) const { return counter * (workers_ + 1) + origin; }
+
+    void workerLoop(int index);
+    void processNext(Partition &partition);
+    bool drainInbox(int index);
+    void post(int target, Incoming message);
+    void insertPending(Partition &partition, Event event);
+    void rollback(int index, const EventKey &key);
+    bool gvtRound(int index);
+    void fossilCollect(Partition &partition, SimTick gvt);
+
+    EventSimulator &sim_;
+    int workers_;
+    int num_ranks_;
+    SimTick window_;
+    std::atomic<SimTick> gvt_{0};
+    std::vector<std::unique_ptr<Partition>> partitions_;
+    std::map<EventKey, Event> global_pending_; // global events, run before the workers start
+    std::uint64_t global_sequence_ = 0;
+    bool tracing_ = false;
+    TraceWriter *trace_ = nullptr;
+
+    std::atomic<bool> gvt_requested_{false};
+    std::atomic<bool> sent_during_gvt_{false};
+    std::atomic<bool> failed_{false};
+    bool repeat_drain_ = false;
+    std::size_t gvt_rounds_ = 0;
+    Barrier barrier_;
+};
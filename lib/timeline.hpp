@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "event_types.hpp"
+
+/** Simulated-time profile of a compare-split sort (--timeline).
+ * The event handlers report each rank's SENDs, message arrivals and
+ * compare-splits and the allreduces of early termination. From these the
+ * timeline keeps per-rank spans (send, recv-wait, compare-split, allreduce;
+ * the gaps are idle) and the dependency graph of the events: a SEND follows
+ * its rank's last compare-split (or allreduce), an arrival follows the
+ * partner's SEND, a compare-split follows its own SEND and the arrival of the
+ * partner's data. The critical path walks that graph back from the last
+ * event, always to the predecessor that finished last. write() exports
+ * everything as Chrome trace-event JSON, which Perfetto and chrome://tracing
+ * open; one simulated time unit is shown as one microsecond.
+ */
+class Timeline
+{
+public:
+    enum class SpanKind { SEND, RECV_WAIT, COMPARE_SPLIT, ALLREDUCE, IDLE };
+    static const char *spanKindName(SpanKind kind);
+
+    struct Span
+    {
+        SimTick start;
+        SimTick end;
+        SpanKind kind;
+        int phase;
+        int peer; // partner rank, -1 if none
+    };
+
+    // what held up the critical path between two of its events
+    enum class PathKind { PHASE_SLOT, NETWORK, COMPARE_SPLIT, ALLREDUCE };
+    static constexpr int PATH_KINDS = 4;
+    static const char *pathKindName(PathKind kind);
+
+    struct PathSegment
+    {
+        SimTick start;
+        SimTick end;
+        PathKind kind;
+        int rank;
+        int phase;
+    };
+
+    struct CriticalPath
+    {
+        SimTick length = 0;
+        SimTick by_kind[PATH_KINDS] = {};
+        std::size_t events = 0;
+        std::size_t rank_changes = 0; // messages the path follows from one rank to another
+        std::vector<PathSegment> segments; // in time order
+    };
+
+    struct PhaseUse
+    {
+        SimTick start = -1; // first SEND
+        SimTick finish = 0; // last compare-split
+        SimTick busy = 0;   // send and compare-split, summed over ranks
+        SimTick wait = 0;   // recv-wait, summed over ranks
+        int ranks = 0;      // ranks taking part
+
+        SimTick span() const { return start < 0 ? 0 : finish - start; }
+    };
+
+    // opens (truncates) `path`, written by write(); throws std::runtime_error.
+    // `start`: the time the profile begins if no START_SORT follows (a resumed run)
+    Timeline(const std::string &path, int num_processes, SimTick start);
+    Timeline(const Timeline &) = delete;
+    Timeline &operator=(const Timeline &) = delete;
+
+    // hooks of the event handlers
+    void start(SimTick time);
+    void send(int rank, int partner, int phase, SimTick time, SimTick wire_end);
+    void arrive(int rank, int source, int phase, SimTick time);
+    void compareSplit(int rank, int partner, int phase, SimTick time);
+    void allreduce(SimTick time, SimTick duration);
+
+    // end of the run: close the idle gaps and find the critical path
+    void finish(SimTick time);
+    // the JSON file, `title` names the trace's process; throws std::runtime_error
+    void write(const std::string &title);
+
+    const std::string &path() const { return path_; }
+    SimTick startTime() const { return start_; }
+    SimTick finishTime() const { return finish_; }
+    int ranks() const { return static_cast<int>(spans_.size()); }
+    std::size_t spanCount() const;
+    // summed over ranks
+    SimTick total(SpanKind kind) const { return totals_[static_cast<int>(kind)]; }
+    const std::vector<PhaseUse> &phases() const { return phases_; }
+    const CriticalPath &criticalPath() const { return path_found_; }
+
+private:
+    enum class NodeKind { START, SEND, ARRIVAL, SPLIT, ALLREDUCE };
+    struct Node
+    {
+        SimTick time;
+        NodeKind kind;
+        int rank;
+        int phase;
+        int pred; // the predecessor that finished last, -1 for none
+    };
+    struct PendingSend
+    {
+        int node;
+        SimTick time;
+        SimTick wire_end;
+    };
+
+    static std::uint64_t key(int rank, int phase)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(rank)) << 32 | static_cast<std::uint32_t>(phase);
+    }
+    int addNode(SimTick time, NodeKind kind, int rank, int phase, int pred);
+    int later(int a, int b) const; // of two nodes (-1: none), the one that happened last
+    void addSpan(int rank, SimTick start, SimTick end, SpanKind kind, int phase, int peer);
+    PhaseUse &phaseUse(int phase);
+
+    std::string path_;
+    std::ofstream file_;
+    SimTick start_;
+    SimTick finish_ = 0;
+
+    std::vector<std::vector<Span>> spans_; // by rank, in time order
+    SimTick totals_[5] = {};
+    std::vector<PhaseUse> phases_;
+
+    std::vector<Node> nodes_;
+    int start_node_ = -1;
+    int barrier_node_ = -1;    // the last allreduce (or START_SORT)
+    int latest_split_ = -1;
+    std::vector<int> last_split_; // by rank
+    std::unordered_map<std::uint64_t, PendingSend> own_sends_; // (rank, phase), until its compare-split
+    std::unordered_map<std::uint64_t, int> messages_;          // (sender, phase) -> SEND node, until it arrives
+    std::unordered_map<std::uint64_t, int> arrivals_;          // (receiver, phase), until its compare-split
+    CriticalPath path_found_;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// On-disk layout of the binary event trace written by TraceWriter and read
+// by trace2txt: one TraceHeader, then one fixed-size TraceRecord per
+// processed event, in processing order. Native byte order.
+
+constexpr char TRACE_MAGIC[8] = {'O', 'E', 'S', 'T', 'R', 'A', 'C', 'E'};
+constexpr std::uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;   // sizeof(TraceRecord), checked by readers
+    std::int64_t ticks_per_unit;
+    std::int32_t num_processes;
+    std::int32_t elements_per_processor;
+};
+
+struct TraceRecord
+{
+    std::int64_t time;            // ticks
+    std::uint64_t payload_hash;   // payloadHash() of the message data, 0 without data
+    std::uint32_t payload_length; // keys
+    std::int32_t src;
+    std::int32_t dst;
+    std::int32_t tag;
+    std::uint8_t type;            // EventType
+    std::uint8_t reserved[7];
+};
+
+static_assert(sizeof(TraceHeader) == 32, "trace header layout changed");
+static_assert(sizeof(TraceRecord) == 40, "trace record layout changed");
+
+// FNV-1a over the payload keys (their bit patterns, one step per key),
+// enough to tell message contents apart
+template <class T>
+std::uint64_t payloadHash(const T *data, std::size_t count)
+{
+    static_assert(sizeof(T) <= sizeof(std::uint64_t), "keys hash as one word each");
+    if (count == 0)
+        return 0;
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &data[i], sizeof(T));
+        hash ^= bits;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_types.hpp"
+#include "trace_format.hpp"
+
+/** Binary event trace, written by a background thread.
+ * Records are collected in one buffer while the writer thread flushes the
+ * other, so the simulation only stops when the disk falls a full buffer
+ * behind. Single producer: record() and append() must not be called from
+ * two threads at once (the parallel engines hand over per-partition batches
+ * from their coordinating thread).
+ */
+class TraceWriter
+{
+public:
+    // opens (truncates) the file and writes the header; throws std::runtime_error
+    TraceWriter(const std::string &path, int num_processes, int elements_per_processor);
+    ~TraceWriter();
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    static TraceRecord makeRecord(const Event &event);
+
+    void record(const Event &event) { push(makeRecord(event)); }
+    void append(const std::vector<TraceRecord> &records);
+
+    // flush everything and stop the writer; throws std::runtime_error on a write error
+    void close();
+
+    const std::string &path() const { return path_; }
+    std::size_t records() const { return records_; }
+
+private:
+    static constexpr std::size_t BUFFER_RECORDS = std::size_t(1) << 16; // 2.5 MiB per buffer
+
+    void push(const TraceRecord &record)
+    {
+        active_.push_back(record);
+        ++records_;
+        if (active_.size() == BUFFER_RECORDS)
+            handOver();
+    }
+    void handOver(); // give the active buffer to the writer thread
+    void writerLoop();
+
+    std::string path_;
+    std::ofstream file_;
+    std::vector<TraceRecord> active_;  // filled by the simulation
+    std::vector<TraceRecord> pending_; // being written
+    std::size_t records_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool pending_full_ = false; // pending_ holds records not yet written
+    bool stop_ = false;
+    bool failed_ = false;
+    bool closed_ = false;
+    std::thread writer_;
+};
@@ -1,8 +0,0 @@
-#include <vector>
-#include <string>
-
-
-// UTIL FUNCTIONS
-void printVector(const std::vector<int> &vec, const std::string &label);
-
-bool isSorted(const std::vector<int> &vec);
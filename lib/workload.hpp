@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "key_type.hpp"
+
+/** Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+ * 3", SC'11): a counter-based generator, the n-th block of random bits is a
+ * function of (counter n, key) alone. Every element of the input can thus be
+ * drawn on its own, by any thread, in any order, with the same result.
+ */
+class Philox4x32
+{
+public:
+    using Block = std::array<std::uint32_t, 4>;
+
+    explicit Philox4x32(std::uint64_t seed)
+        : key_{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)} {}
+
+    Block operator()(Block counter) const;
+    // 128 random bits for (index, stream, draw) as two 64-bit words
+    std::array<std::uint64_t, 2> words(std::uint64_t index, std::uint32_t stream, std::uint32_t draw = 0) const;
+
+private:
+    std::array<std::uint32_t, 2> key_;
+};
+
+enum class InputDistribution {
+    UNIFORM,       // uniform in [KEY_MIN, KEY_MAX] (1..100000 for int32), the default
+    FULL,          // uniform over every value of the key type (finite bit patterns for float)
+    ZIPF,          // Zipf with exponent s over up to 2^20 values spread over the key range, KEY_MIN most frequent
+    DUPLICATES,    // D distinct values
+    SORTED,        // ascending across ranks
+    REVERSED,      // descending across ranks: every element has to travel
+    NEARLY_SORTED, // sorted, then K random pairs of elements swapped
+    RUNS,          // every rank a sequence of ascending runs of length L, ranks independent
+};
+
+// --dist and --seed
+struct WorkloadConfig
+{
+    InputDistribution distribution = InputDistribution::UNIFORM;
+    double parameter = -1; // zipf s, duplicates D, nearly-sorted K, runs L; negative = the default
+    std::uint64_t seed = 0;
+    bool seeded = false; // seed given, else each run draws one
+};
+
+const char *inputDistributionName(InputDistribution distribution);
+// "NAME[:PARAMETER]" as --dist takes it; throws std::invalid_argument
+WorkloadConfig parseWorkload(const std::string &spec);
+// the --dist spec of `workload`
+std::string workloadName(const WorkloadConfig &workload);
+
+/** Input keys of every rank, a function of (distribution, seed, P, N) only:
+ * generate() fills one rank's keys independently of the others, so ranks can
+ * be generated in parallel. Only nearly-sorted needs one serial step, the
+ * constructor draws its K swaps (O(K)) and hands each rank the positions it
+ * gets a foreign key for.
+ */
+class WorkloadGenerator
+{
+public:
+    WorkloadGenerator(const WorkloadConfig &workload, std::uint64_t seed, int ranks, std::size_t elements_per_rank);
+
+    // the keys of `rank` into out[0, elements_per_rank); thread-safe
+    void generate(int rank, Key *out) const;
+
+private:
+    struct Moved
+    {
+        std::size_t position; // in the rank
+        std::uint64_t source; // global index of the sorted key it gets
+    };
+
+    Key sortedKey(std::uint64_t index, std::uint64_t r) const; // of the ascending sequence, r: its random word
+    Key zipfKey(std::uint64_t index) const;
+
+    InputDistribution distribution_;
+    Philox4x32 random_;
+    int ranks_;
+    std::size_t elements_;
+    std::uint64_t total_;
+    std::uint64_t count_ = 0;  // duplicates: distinct values, runs: run length
+    double exponent_ = 1.0;    // zipf
+    std::uint64_t zipf_values_ = 0;
+    double h_integral_x1_ = 0, h_integral_n_ = 0, s_ = 0; // zipf rejection-inversion constants
+    std::vector<std::vector<Moved>> moved_; // nearly-sorted, by rank
+};
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "batch_runner.hpp"
+#include "processor.hpp"
+
+BatchRunner::BatchRunner(int workers)
+{
+    if (workers <= 0)
+        workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < workers; ++i)
+        simulators_.push_back(std::make_unique<EventSimulator>());
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob> &jobs)
+{
+    std::vector<BatchResult> results(jobs.size());
+    std::atomic<std::size_t> next{0};
+    auto work = [&](EventSimulator &simulator) {
+        for (std::size_t job = next++; job < jobs.size(); job = next++)
+            results[job] = runJob(simulator, jobs[job]);
+    };
+
+    std::size_t workers = std::min(simulators_.size(), jobs.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < workers; ++i)
+        threads.emplace_back(work, std::ref(*simulators_[i]));
+    if (workers > 0)
+        work(*simulators_[0]); // the calling thread is a worker too
+    for (auto &thread : threads)
+        thread.join();
+    return results;
+}
+
+BatchResult BatchRunner::runJob(EventSimulator &simulator, const BatchJob &job)
+{
+    BatchResult result;
+    try
+    {
+        simulator.init(job.num_processes, job.elements_per_processor, job.config);
+        if (job.config.input_file.empty())
+            simulator.initializeData();
+        else
+            simulator.loadDataFile(job.config.input_file);
+        std::uint64_t input_digest = simulator.dataDigest();
+
+        auto start = std::chrono::steady_clock::now();
+        simulator.run();
+        result.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (job.config.run_collective)
+            result.correct = simulator.collectiveResultCorrect();
+        else
+            result.correct = simulator.sortedAcrossRanks() && simulator.dataDigest() == input_digest;
+        if (!job.config.output_file.empty() && !job.config.run_collective)
+            simulator.writeDataFile(job.config.output_file);
+        result.sim_time = simulator.getCurrentTime();
+        result.events = simulator.getEngineStats().events_processed;
+        result.traffic = simulator.getEngineStats().traffic;
+        result.completed = true;
+    }
+    catch (const std::exception &e)
+    {
+        result.error = e.what();
+    }
+    return result;
+}
+
+std::vector<BatchJob> readBatchFile(const std::string &path, const SimConfig &defaults)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot open batch file " + path);
+
+    std::vector<BatchJob> jobs;
+    // jobs run side by side: no two may write the same file
+    std::unordered_map<std::string, std::string> written; // normalized path -> "--option of line N"
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string word;
+        std::vector<std::string> fields;
+        while (words >> word)
+            fields.push_back(word);
+        if (fields.empty())
+            continue;
+
+        const std::string where = path + ":" + std::to_string(number) + ": ";
+        BatchJob job;
+        job.config = defaults;
+        if (fields.size() < 2)
+            throw std::invalid_argument(where + "needs <processors> <elements> [options]");
+        job.num_processes = std::atoi(fields[0].c_str());
+        job.elements_per_processor = std::atoi(fields[1].c_str());
+        if (job.num_processes <= 0 || job.elements_per_processor <= 0)
+            throw std::invalid_argument(where + "number of processors and elements per processor must be positive");
+        for (std::size_t i = 2; i < fields.size(); ++i)
+        {
+            try
+            {
+                if (!parseSimOption(fields[i], job.config))
+                    throw std::invalid_argument("unknown option " + fields[i]);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                throw std::invalid_argument(where + e.what());
+            }
+            job.options += (job.options.empty() ? "" : " ") + fields[i];
+        }
+        if (job.config.compare_sorts || !job.config.batch_file.empty() || !job.config.checkpoint_file.empty() ||
+            !job.config.resume_file.empty())
+            throw std::invalid_argument(where + "--compare, --batch, --checkpoint and --resume cannot run inside a batch");
+        for (const auto &[option, file] : {std::pair<const char *, const std::string &>{"--output", job.config.output_file},
+                                           {"--trace", job.config.trace_file},
+                                           {"--timeline", job.config.timeline_file}})
+        {
+            if (file.empty())
+                continue;
+            std::string key = std::filesystem::absolute(file).lexically_normal().string();
+            auto [previous, added] = written.emplace(key, std::string(option) + " of line " + std::to_string(number));
+            if (!added)
+                throw std::invalid_argument(where + option + "=" + file + " is also written by " + previous->second);
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
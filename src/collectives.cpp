@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "collectives.hpp"
+#include "instrumentation.hpp"
+
+namespace Collectives
+{
+    namespace
+    {
+        template <class T>
+        T sum(T a, T b)
+        {
+            if constexpr (std::is_integral<T>::value)
+            {
+                using Unsigned = std::make_unsigned_t<T>;
+                return static_cast<T>(static_cast<Unsigned>(a) + static_cast<Unsigned>(b));
+            }
+            else
+                return a + b;
+        }
+
+        // slot sizes travel in the message as the bit pattern of a key
+        Key sizeKey(std::size_t size)
+        {
+            std::uint32_t bits = static_cast<std::uint32_t>(size);
+            Key key{};
+            std::memcpy(&key, &bits, sizeof(bits));
+            return key;
+        }
+
+        std::size_t keySize(Key key)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, &key, sizeof(bits));
+            return bits;
+        }
+
+        int ceilLog2(int n)
+        {
+            int log = 0;
+            while ((1 << log) < n)
+                ++log;
+            return log;
+        }
+
+        int floorPow2(int n)
+        {
+            int pow = 1;
+            while (pow * 2 <= n)
+                pow *= 2;
+            return pow;
+        }
+
+        std::vector<int> iota(int first, int last)
+        {
+            std::vector<int> values(last > first ? last - first : 0);
+            std::iota(values.begin(), values.end(), first);
+            return values;
+        }
+
+        bool implements(Op op, Algorithm algorithm)
+        {
+            switch (op)
+            {
+            case Op::BCAST:
+                return algorithm == Algorithm::LINEAR || algorithm == Algorithm::BINOMIAL ||
+                       algorithm == Algorithm::RECURSIVE_DOUBLING || algorithm == Algorithm::RING;
+            case Op::SCATTER:
+            case Op::GATHER:
+                return algorithm == Algorithm::LINEAR || algorithm == Algorithm::BINOMIAL;
+            case Op::ALLREDUCE:
+                return algorithm == Algorithm::BINOMIAL || algorithm == Algorithm::RECURSIVE_DOUBLING ||
+                       algorithm == Algorithm::RING;
+            case Op::ALLTOALL:
+                return algorithm == Algorithm::LINEAR || algorithm == Algorithm::RING || algorithm == Algorithm::BRUCK;
+            }
+            return false;
+        }
+    }
+
+    Schedule::Schedule(Op op, Algorithm algorithm, int num_ranks, int root, ReduceOp reduce, int group_size,
+                       int group_stride)
+        : op_(op), algorithm_(algorithm == Algorithm::AUTO ? defaultAlgorithm(op) : algorithm),
+          total_ranks_(num_ranks), stride_(group_stride), num_ranks_(group_size == 0 ? num_ranks : group_size),
+          root_(root), reduce_(reduce)
+    {
+        if (total_ranks_ <= 0 || num_ranks_ <= 0 || stride_ <= 0)
+            throw std::runtime_error("A collective needs at least one rank");
+        if (total_ranks_ % (static_cast<long long>(num_ranks_) * stride_) != 0)
+            throw std::runtime_error("Groups of " + std::to_string(num_ranks_) + " ranks " + std::to_string(stride_) +
+                                     " apart do not tile " + std::to_string(total_ranks_) + " ranks");
+        if (root_ < 0 || root_ >= num_ranks_)
+            throw std::runtime_error("Collective root " + std::to_string(root_) + " is not a rank");
+        if (!implements(op_, algorithm_))
+            throw std::runtime_error(std::string("No ") + algorithmName(algorithm_) + " algorithm for " + opName(op_));
+        if (op_ == Op::ALLREDUCE || op_ == Op::ALLTOALL)
+            root_ = 0; // rootless, the closed forms below use relative ranks throughout
+
+        log_ = ceilLog2(num_ranks_);
+        pow2_ = floorPow2(num_ranks_);
+        int direct = num_ranks_ > 1 ? 1 : 0;
+        int doubling = ceilLog2(pow2_) + (num_ranks_ > pow2_ ? 2 : 0); // fold, exchanges, unfold
+        switch (op_)
+        {
+        case Op::BCAST:
+            rounds_ = algorithm_ == Algorithm::LINEAR     ? direct
+                      : algorithm_ == Algorithm::BINOMIAL ? log_
+                      : algorithm_ == Algorithm::RING     ? log_ + num_ranks_ - 1
+                                                          : log_ + doubling;
+            break;
+        case Op::SCATTER:
+        case Op::GATHER:
+            rounds_ = algorithm_ == Algorithm::LINEAR ? direct : log_;
+            break;
+        case Op::ALLREDUCE:
+            rounds_ = algorithm_ == Algorithm::BINOMIAL ? 2 * log_
+                      : algorithm_ == Algorithm::RING   ? 2 * (num_ranks_ - 1)
+                                                        : doubling;
+            break;
+        case Op::ALLTOALL:
+            rounds_ = algorithm_ == Algorithm::LINEAR ? direct
+                      : algorithm_ == Algorithm::RING ? num_ranks_ - 1
+                                                      : log_;
+            break;
+        }
+    }
+
+    int Schedule::slots() const
+    {
+        switch (op_)
+        {
+        case Op::BCAST:
+        case Op::ALLREDUCE:
+            return segmented() ? num_ranks_ : 1;
+        case Op::SCATTER:
+        case Op::GATHER:
+            return num_ranks_;
+        case Op::ALLTOALL:
+            // send blocks by destination, then received blocks by origin; Bruck works in place
+            return algorithm_ == Algorithm::BRUCK ? num_ranks_ : 2 * num_ranks_;
+        }
+        return 0;
+    }
+
+    bool Schedule::segmented() const
+    {
+        return (op_ == Op::BCAST && (algorithm_ == Algorithm::RING || algorithm_ == Algorithm::RECURSIVE_DOUBLING)) ||
+               (op_ == Op::ALLREDUCE && algorithm_ == Algorithm::RING);
+    }
+
+    bool Schedule::rotates() const
+    {
+        return op_ == Op::ALLTOALL && algorithm_ == Algorithm::BRUCK;
+    }
+
+    int Schedule::slotOf(int v) const
+    {
+        // scatter / gather blocks belong to absolute ranks, segments are numbered from the root
+        return op_ == Op::SCATTER || op_ == Op::GATHER ? absolute(v) : v;
+    }
+
+    std::vector<int> Schedule::slotRange(int first, int last) const
+    {
+        std::vector<int> slots;
+        for (int v = first; v < last; ++v)
+            slots.push_back(slotOf(v));
+        return slots;
+    }
+
+    Round Schedule::round(int rank, int k) const
+    {
+        int group_rank = groupRank(rank);
+        Round round = groupRound(group_rank, k);
+        int base = rank - group_rank * stride_;
+        for (Transfer &send : round.sends)
+            send.peer = base + send.peer * stride_;
+        for (Transfer &recv : round.recvs)
+            recv.peer = base + recv.peer * stride_;
+        return round;
+    }
+
+    Round Schedule::groupRound(int rank, int k) const
+    {
+        Round round;
+        const int p = num_ranks_;
+        const int v = relative(rank);
+        switch (op_)
+        {
+        case Op::BCAST:
+            if (algorithm_ == Algorithm::LINEAR)
+            {
+                if (v == 0)
+                    for (int t = 1; t < p; ++t)
+                        round.sends.push_back({absolute(t), {0}});
+                else
+                    round.recvs.push_back({root_, {0}});
+            }
+            else if (algorithm_ == Algorithm::BINOMIAL)
+                scatterRound(round, v, k, true);
+            else if (k < log_) // scatter the segments, then allgather them
+                scatterRound(round, v, k, false);
+            else if (algorithm_ == Algorithm::RING)
+                ringAllgatherRound(round, v, k - log_);
+            else
+                doublingRound(round, v, k - log_, false);
+            break;
+
+        case Op::SCATTER:
+            if (algorithm_ == Algorithm::BINOMIAL)
+                scatterRound(round, v, k, false);
+            else if (v == 0)
+                for (int t = 1; t < p; ++t)
+                    round.sends.push_back({absolute(t), {absolute(t)}});
+            else
+                round.recvs.push_back({root_, {rank}});
+            break;
+
+        case Op::GATHER:
+            if (algorithm_ == Algorithm::BINOMIAL)
+                gatherRound(round, v, k, false);
+            else if (v == 0)
+                for (int t = 1; t < p; ++t)
+                    round.recvs.push_back({absolute(t), {absolute(t)}});
+            else
+                round.sends.push_back({root_, {rank}});
+            break;
+
+        case Op::ALLREDUCE:
+            if (algorithm_ == Algorithm::BINOMIAL) // reduce to rank 0, broadcast the result
+            {
+                if (k < log_)
+                    gatherRound(round, v, k, true);
+                else
+                    scatterRound(round, v, k - log_, true);
+            }
+            else if (algorithm_ == Algorithm::RECURSIVE_DOUBLING)
+                doublingRound(round, v, k, true);
+            else if (k < p - 1) // reduce-scatter: segment v - k travels right, collecting every rank's part
+            {
+                round.sends.push_back({absolute(v + 1), {(v - k + p) % p}});
+                round.recvs.push_back({absolute(v - 1), {(v - k - 1 + 2 * p) % p}});
+                round.reduce = true;
+            }
+            else // allgather: rank v starts with the complete segment v + 1
+            {
+                int j = k - (p - 1);
+                round.sends.push_back({absolute(v + 1), {(v + 1 - j + p) % p}});
+                round.recvs.push_back({absolute(v - 1), {(v - j + p) % p}});
+            }
+            break;
+
+        case Op::ALLTOALL:
+            alltoallRound(round, rank, k);
+            break;
+        }
+        return round;
+    }
+
+    // Binomial tree from the root, largest subtree first: in round k ranks at
+    // multiples of 2m (m = 2^(log - 1 - k)) hand the blocks of the subtree at
+    // distance m to its head
+    void Schedule::scatterRound(Round &round, int v, int k, bool whole) const
+    {
+        const int p = num_ranks_;
+        const int m = 1 << (log_ - 1 - k);
+        if (v % (2 * m) == 0)
+        {
+            if (v + m < p)
+                round.sends.push_back({absolute(v + m), whole ? std::vector<int>{0} : slotRange(v + m, std::min(v + 2 * m, p))});
+        }
+        else if (v % (2 * m) == m)
+            round.recvs.push_back({absolute(v - m), whole ? std::vector<int>{0} : slotRange(v, std::min(v + m, p))});
+    }
+
+    // The scatter tree run backwards: in round k subtrees of size m = 2^k
+    // report to the rank m below them; `whole` reduces a single slot on the way
+    void Schedule::gatherRound(Round &round, int v, int k, bool whole) const
+    {
+        const int p = num_ranks_;
+        const int m = 1 << k;
+        if (v % (2 * m) == m)
+            round.sends.push_back({absolute(v - m), whole ? std::vector<int>{0} : slotRange(v, std::min(v + m, p))});
+        else if (v % (2 * m) == 0 && v + m < p)
+            round.recvs.push_back({absolute(v + m), whole ? std::vector<int>{0} : slotRange(v + m, std::min(v + 2 * m, p))});
+        round.reduce = whole;
+    }
+
+    // Rank v starts with segment v; in round k it passes on the segment it got
+    // in round k - 1 (its own in round 0)
+    void Schedule::ringAllgatherRound(Round &round, int v, int k) const
+    {
+        const int p = num_ranks_;
+        round.sends.push_back({absolute(v + 1), {slotOf((v - k + p) % p)}});
+        round.recvs.push_back({absolute(v - 1), {slotOf((v - k - 1 + 2 * p) % p)}});
+    }
+
+    // Recursive doubling over the largest power of two ranks. With P not a
+    // power of two the first 2 * rem ranks pair up: the even one hands its part
+    // to the odd one (fold), sits the exchanges out and gets the result back
+    // (unfold). `whole` exchanges and reduces one slot (allreduce), otherwise
+    // segments are gathered.
+    void Schedule::doublingRound(Round &round, int v, int k, bool whole) const
+    {
+        const int p = num_ranks_;
+        const int rem = p - pow2_;
+        if (rem > 0)
+        {
+            if (k == 0)
+            {
+                if (v < 2 * rem && v % 2 == 0)
+                    round.sends.push_back({absolute(v + 1), {whole ? 0 : slotOf(v)}});
+                else if (v < 2 * rem)
+                    round.recvs.push_back({absolute(v - 1), {whole ? 0 : slotOf(v - 1)}});
+                round.reduce = whole;
+                return;
+            }
+            if (k == ceilLog2(pow2_) + 1)
+            {
+                std::vector<int> all = whole ? std::vector<int>{0} : slotRange(0, p);
+                if (v < 2 * rem && v % 2 == 1)
+                    round.sends.push_back({absolute(v - 1), all});
+                else if (v < 2 * rem)
+                    round.recvs.push_back({absolute(v + 1), all});
+                return;
+            }
+            --k;
+        }
+        if (v < 2 * rem && v % 2 == 0)
+            return; // folded into v + 1
+
+        // renumber the remaining ranks 0 .. pow2 - 1; after k exchanges each
+        // holds the segments of the 2^k ranks of its aligned group
+        auto original = [rem](int w) { return w < rem ? 2 * w + 1 : w + rem; };
+        auto groupSlots = [&](int w) {
+            if (whole)
+                return std::vector<int>{0};
+            int first = w & ~((1 << k) - 1);
+            int last = first + (1 << k);
+            return slotRange(first < rem ? 2 * first : first + rem, last <= rem ? 2 * last : last + rem);
+        };
+        int w = v < 2 * rem ? v / 2 : v - rem;
+        int partner = w ^ (1 << k);
+        round.sends.push_back({absolute(original(partner)), groupSlots(w)});
+        round.recvs.push_back({absolute(original(partner)), groupSlots(partner)});
+        round.reduce = whole;
+    }
+
+    void Schedule::alltoallRound(Round &round, int rank, int k) const
+    {
+        const int p = num_ranks_;
+        if (algorithm_ == Algorithm::LINEAR)
+        {
+            // start at the right neighbor so the ranks do not all hit rank 0 first
+            for (int i = 1; i < p; ++i)
+            {
+                round.sends.push_back({(rank + i) % p, {(rank + i) % p}});
+                round.recvs.push_back({(rank - i + p) % p, {p + (rank - i + p) % p}});
+            }
+        }
+        else if (algorithm_ == Algorithm::RING)
+        {
+            int to = (rank + k + 1) % p;
+            int from = (rank - k - 1 + p) % p;
+            round.sends.push_back({to, {to}});
+            round.recvs.push_back({from, {p + from}});
+        }
+        else
+        {
+            // slot d holds the block d ranks further on; round k moves every
+            // block whose remaining distance has bit k set
+            int bit = 1 << k;
+            std::vector<int> slots;
+            for (int d = bit; d < p; ++d)
+                if (d & bit)
+                    slots.push_back(d);
+            round.sends.push_back({(rank + bit) % p, slots});
+            round.recvs.push_back({(rank - bit + p) % p, slots});
+        }
+    }
+
+    std::vector<int> Schedule::inputSlots(int rank) const
+    {
+        const int p = num_ranks_;
+        rank = groupRank(rank);
+        switch (op_)
+        {
+        case Op::BCAST:
+            if (rank != root_)
+                return {};
+            return segmented() ? iota(0, p) : std::vector<int>{0};
+        case Op::SCATTER:
+            return rank == root_ ? iota(0, p) : std::vector<int>{};
+        case Op::GATHER:
+            return {rank};
+        case Op::ALLREDUCE:
+            return segmented() ? iota(0, p) : std::vector<int>{0};
+        case Op::ALLTOALL:
+        {
+            std::vector<int> slots = iota(0, p);
+            if (rotates())
+                for (int d = 0; d < p; ++d)
+                    slots[d] = (d - rank + p) % p;
+            return slots;
+        }
+        }
+        return {};
+    }
+
+    std::vector<int> Schedule::outputSlots(int rank) const
+    {
+        const int p = num_ranks_;
+        rank = groupRank(rank);
+        switch (op_)
+        {
+        case Op::BCAST:
+        case Op::ALLREDUCE:
+            return segmented() ? iota(0, p) : std::vector<int>{0};
+        case Op::SCATTER:
+            return {rank};
+        case Op::GATHER:
+            return rank == root_ ? iota(0, p) : std::vector<int>{};
+        case Op::ALLTOALL:
+        {
+            std::vector<int> slots(p);
+            for (int o = 0; o < p; ++o)
+                slots[o] = rotates() ? (rank - o + p) % p : (o == rank ? rank : p + o);
+            return slots;
+        }
+        }
+        return {};
+    }
+
+    Algorithm defaultAlgorithm(Op op)
+    {
+        switch (op)
+        {
+        case Op::BCAST:
+        case Op::SCATTER:
+        case Op::GATHER:
+            return Algorithm::BINOMIAL;
+        case Op::ALLREDUCE:
+            return Algorithm::RECURSIVE_DOUBLING;
+        case Op::ALLTOALL:
+            return Algorithm::BRUCK;
+        }
+        return Algorithm::BINOMIAL;
+    }
+
+    const char *opName(Op op)
+    {
+        switch (op)
+        {
+        case Op::BCAST:
+            return "bcast";
+        case Op::SCATTER:
+            return "scatter";
+        case Op::GATHER:
+            return "gather";
+        case Op::ALLREDUCE:
+            return "allreduce";
+        case Op::ALLTOALL:
+            return "alltoall";
+        }
+        return "unknown";
+    }
+
+    const char *algorithmName(Algorithm algorithm)
+    {
+        switch (algorithm)
+        {
+        case Algorithm::AUTO:
+            return "auto";
+        case Algorithm::LINEAR:
+            return "linear";
+        case Algorithm::BINOMIAL:
+            return "binomial";
+        case Algorithm::RECURSIVE_DOUBLING:
+            return "recursive-doubling";
+        case Algorithm::RING:
+            return "ring";
+        case Algorithm::BRUCK:
+            return "bruck";
+        }
+        return "unknown";
+    }
+
+    const char *reduceOpName(ReduceOp reduce)
+    {
+        switch (reduce)
+        {
+        case ReduceOp::SUM:
+            return "sum";
+        case ReduceOp::MIN:
+            return "min";
+        case ReduceOp::MAX:
+            return "max";
+        }
+        return "unknown";
+    }
+
+    void combine(ReduceOp reduce, Key *into, const Key *from, std::size_t count)
+    {
+        switch (reduce)
+        {
+        case ReduceOp::SUM:
+            for (std::size_t i = 0; i < count; ++i)
+                into[i] = sum(into[i], from[i]);
+            break;
+        case ReduceOp::MIN:
+            for (std::size_t i = 0; i < count; ++i)
+                into[i] = std::min(into[i], from[i]);
+            break;
+        case ReduceOp::MAX:
+            for (std::size_t i = 0; i < count; ++i)
+                into[i] = std::max(into[i], from[i]);
+            break;
+        }
+    }
+
+    Payload pack(PayloadPool &pool, const std::vector<std::vector<Key>> &slots, const std::vector<int> &which,
+                 std::size_t &elements)
+    {
+        elements = 0;
+        for (int slot : which)
+            elements += slots[slot].size();
+
+        Payload message = pool.acquire(which.size() + elements);
+        Key *out = message.mutableData();
+        for (int slot : which)
+            *out++ = sizeKey(slots[slot].size());
+        for (int slot : which)
+            out = std::copy(slots[slot].begin(), slots[slot].end(), out);
+        if (Instrumentation *sink = Instrumentation::active())
+            sink->copied(message.size() * sizeof(Key));
+        return message;
+    }
+
+    std::size_t unpack(const Payload &message, std::vector<std::vector<Key>> &slots, const std::vector<int> &which,
+                       bool reduce, ReduceOp op)
+    {
+        if (message.size() < which.size())
+            throw std::runtime_error("Collective message shorter than its header");
+        const Key *sizes = message.data();
+        const Key *in = sizes + which.size();
+        std::size_t elements = 0;
+        for (std::size_t i = 0; i < which.size(); ++i)
+            elements += keySize(sizes[i]);
+        if (message.size() != which.size() + elements)
+            throw std::runtime_error("Collective message size does not match its header");
+
+        for (std::size_t i = 0; i < which.size(); ++i)
+        {
+            std::vector<Key> &slot = slots[which[i]];
+            std::size_t count = keySize(sizes[i]);
+            if (reduce)
+            {
+                if (slot.size() != count)
+                    throw std::runtime_error("Allreduce inputs differ in length");
+                combine(op, slot.data(), in, count);
+            }
+            else
+                slot.assign(in, in + count);
+            in += count;
+        }
+        return elements;
+    }
+
+    std::vector<std::vector<std::vector<Key>>> expectedResult(Op op, int root, ReduceOp reduce,
+                                                              const std::vector<std::vector<std::vector<Key>>> &input)
+    {
+        const std::size_t p = input.size();
+        std::vector<std::vector<std::vector<Key>>> result(p);
+        switch (op)
+        {
+        case Op::BCAST:
+            for (auto &blocks : result)
+                blocks = {input[root][0]};
+            break;
+        case Op::SCATTER:
+            for (std::size_t t = 0; t < p; ++t)
+                result[t] = {input[root][t]};
+            break;
+        case Op::GATHER:
+            for (std::size_t t = 0; t < p; ++t)
+                result[root].push_back(input[t][0]);
+            break;
+        case Op::ALLREDUCE:
+        {
+            std::vector<Key> reduced = input[0][0];
+            for (std::size_t t = 1; t < p; ++t)
+                combine(reduce, reduced.data(), input[t][0].data(), reduced.size());
+            for (auto &blocks : result)
+                blocks = {reduced};
+            break;
+        }
+        case Op::ALLTOALL:
+            for (std::size_t t = 0; t < p; ++t)
+                for (std::size_t o = 0; o < p; ++o)
+                    result[t].push_back(input[o][t]);
+            break;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "conservative_engine.hpp"
+#include "event_simulator.hpp"
+#include "trace_writer.hpp"
+
+namespace
+{
+    // partition served by the calling thread, -1 on the coordinating thread
+    thread_local int current_partition = -1;
+
+    int workerCount(int threads, int num_ranks)
+    {
+        if (threads <= 0)
+            threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        return std::max(1, std::min(threads, num_ranks));
+    }
+}
+
+ConservativeEngine::ConservativeEngine(EventSimulator &simulator, int threads)
+    : sim_(simulator),
+      workers_(workerCount(threads, simulator.getNumProcesses())),
+      num_ranks_(simulator.getNumProcesses()),
+      partitions_(workers_),
+      global_queue_(makeEventQueue(simulator.getConfig().queue_type)),
+      start_barrier_(workers_ + 1),
+      worker_barrier_(workers_),
+      end_barrier_(workers_ + 1)
+{
+    for (auto &partition : partitions_)
+    {
+        partition.queue = makeEventQueue(simulator.getConfig().queue_type);
+        partition.outbox.resize(workers_);
+    }
+}
+
+ConservativeEngine::~ConservativeEngine()
+{
+    stopWorkers();
+}
+
+void ConservativeEngine::schedule(Event event)
+{
+    int owner = EventSimulator::ownerRank(event);
+    int self = current_partition;
+
+    if (owner == EventSimulator::GLOBAL_EVENT)
+    {
+        if (self != -1)
+            throw std::runtime_error("Global events cannot be scheduled from inside a window");
+        event.setSequence(makeSequence(global_sequence_++, workers_));
+        global_queue_->push(std::move(event));
+        return;
+    }
+
+    int target = partitionOf(owner);
+    if (self == -1)
+    {
+        // coordinator: workers are parked at the barrier, queues are free
+        event.setSequence(makeSequence(global_sequence_++, workers_));
+        partitions_[target].queue->push(std::move(event));
+        return;
+    }
+
+    Partition &partition = partitions_[self];
+    event.setSequence(makeSequence(partition.next_sequence++, self));
+    if (target == self)
+    {
+        partition.queue->push(std::move(event));
+        return;
+    }
+    if (event.getTime() < window_end_)
+        throw std::runtime_error("Lookahead violation: cross-partition event inside the current window");
+    partition.outbox[target].push_back(std::move(event));
+    ++partition.remote;
+}
+
+void ConservativeEngine::run(TraceWriter *trace)
+{
+    tracing_ = trace != nullptr;
+
+    // take over what was scheduled before run() (START_SORT)
+    while (!sim_.event_queue_->empty())
+        schedule(sim_.event_queue_->pop());
+
+    for (auto &partition : partitions_)
+        partition.next_time = partition.queue->empty() ? NO_EVENT : partition.queue->top().getTime();
+
+    for (int i = 0; i < workers_; ++i)
+        threads_.emplace_back(&ConservativeEngine::workerLoop, this, i);
+
+    EngineStats &stats = sim_.stats_;
+    SimTick last_time = sim_.current_time_;
+    for (;;)
+    {
+        SimTick next_local = NO_EVENT;
+        for (const auto &partition : partitions_)
+            next_local = std::min(next_local, partition.next_time);
+        SimTick next_global = global_queue_->empty() ? NO_EVENT : global_queue_->top().getTime();
+
+        if (next_local == NO_EVENT && next_global == NO_EVENT)
+            break;
+
+        if (next_global <= next_local)
+        {
+            // global event runs alone, everything it schedules goes straight into the queues
+            Event event = global_queue_->pop();
+            last_time = std::max(last_time, event.getTime());
+            sim_.dispatchEvent(event);
+            ++stats.events_processed;
+            stats.traffic.add(event, sim_.elementBytes());
+            if (trace)
+                trace->record(event);
+            for (auto &partition : partitions_)
+                partition.next_time = partition.queue->empty() ? NO_EVENT : partition.queue->top().getTime();
+            continue;
+        }
+
+        window_end_ = std::min(next_local + sim_.lookahead(), next_global);
+        ++stats.windows;
+
+        start_barrier_.wait();
+        end_barrier_.wait();
+
+        for (auto &partition : partitions_)
+        {
+            if (partition.error)
+            {
+                std::exception_ptr error = partition.error;
+                stopWorkers();
+                std::rethrow_exception(error);
+            }
+            if (trace)
+                trace->append(partition.trace);
+            partition.trace.clear();
+        }
+    }
+
+    stopWorkers();
+
+    for (auto &partition : partitions_)
+    {
+        last_time = std::max(last_time, partition.last_time);
+        stats.events_processed += partition.processed;
+        stats.remote_events += partition.remote;
+        stats.traffic += partition.traffic;
+        stats.queue_high_water += partition.queue->highWaterMark();
+    }
+    stats.queue_high_water += global_queue_->highWaterMark();
+    sim_.current_time_ = last_time;
+}
+
+void ConservativeEngine::workerLoop(int index)
+{
+    current_partition = index;
+    Partition &partition = partitions_[index];
+
+    for (;;)
+    {
+        start_barrier_.wait();
+        if (done_)
+            return;
+
+        if (!partition.error)
+        {
+            try
+            {
+                processWindow(partition);
+            }
+            catch (...)
+            {
+                partition.error = std::current_exception();
+            }
+        }
+
+        worker_barrier_.wait();
+        deliver(index);
+        end_barrier_.wait();
+    }
+}
+
+void ConservativeEngine::processWindow(Partition &partition)
+{
+    while (!partition.queue->empty() && partition.queue->top().getTime() < window_end_)
+    {
+        Event event = partition.queue->pop();
+        partition.last_time = std::max(partition.last_time, event.getTime());
+        sim_.dispatchEvent(event);
+        ++partition.processed;
+        partition.traffic.add(event, sim_.elementBytes());
+        if (tracing_)
+            partition.trace.push_back(TraceWriter::makeRecord(event));
+    }
+}
+
+void ConservativeEngine::deliver(int index)
+{
+    Partition &partition = partitions_[index];
+    for (auto &source : partitions_)
+    {
+        for (auto &event : source.outbox[index])
+            partition.queue->push(std::move(event));
+        source.outbox[index].clear();
+    }
+    partition.next_time = partition.queue->empty() ? NO_EVENT : partition.queue->top().getTime();
+}
+
+void ConservativeEngine::stopWorkers()
+{
+    if (threads_.empty())
+        return;
+    done_ = true;
+    start_barrier_.wait();
+    for (auto &thread : threads_)
+        thread.join();
+    threads_.clear();
+}
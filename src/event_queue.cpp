@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "event_queue.hpp"
+
+// ---------------------------------------------------------------- binary heap
+
+void BinaryHeapQueue::push(Event event)
+{
+    heap_.push_back(std::move(event));
+    std::push_heap(heap_.begin(), heap_.end(), EventComparator());
+    notePush(heap_.size());
+}
+
+Event BinaryHeapQueue::pop()
+{
+    std::pop_heap(heap_.begin(), heap_.end(), EventComparator());
+    Event event = std::move(heap_.back());
+    heap_.pop_back();
+    return event;
+}
+
+void BinaryHeapQueue::forEach(const std::function<void(const Event &)> &visit) const
+{
+    for (const Event &event : heap_)
+        visit(event);
+}
+
+void BinaryHeapQueue::clear()
+{
+    heap_.clear();
+    high_water_mark_ = 0;
+}
+
+// ------------------------------------------------------------- calendar queue
+
+CalendarQueue::CalendarQueue()
+    : buckets_(MIN_BUCKETS), width_(TICKS_PER_UNIT), current_day_(0), size_(0)
+{
+}
+
+void CalendarQueue::clear()
+{
+    buckets_.assign(MIN_BUCKETS, Bucket());
+    width_ = TICKS_PER_UNIT;
+    current_day_ = 0;
+    size_ = 0;
+    high_water_mark_ = 0;
+}
+
+void CalendarQueue::forEach(const std::function<void(const Event &)> &visit) const
+{
+    for (const Bucket &bucket : buckets_)
+        for (const TickGroup &group : bucket)
+            for (std::size_t i = group.head; i < group.events.size(); ++i)
+                visit(group.events[i]);
+}
+
+void CalendarQueue::insert(Event event)
+{
+    Bucket &bucket = buckets_[bucketOf(event.getTime())];
+    SimTick time = event.getTime();
+
+    // a bucket holds a handful of distinct times, search from the latest
+    auto pos = bucket.end();
+    while (pos != bucket.begin() && time < (pos - 1)->time)
+        --pos;
+    if (pos != bucket.begin() && (pos - 1)->time == time)
+    {
+        (pos - 1)->events.push_back(std::move(event));
+        return;
+    }
+    pos = bucket.insert(pos, TickGroup{time, 0, {}});
+    pos->events.push_back(std::move(event));
+}
+
+void CalendarQueue::push(Event event)
+{
+    if (event.getTime() < 0)
+        throw std::runtime_error("Calendar queue cannot hold negative event times");
+
+    SimTick day = event.getTime() / width_;
+    if (size_ == 0 || day < current_day_)
+        current_day_ = day;
+
+    insert(std::move(event));
+    ++size_;
+    notePush(size_);
+
+    if (size_ > 2 * buckets_.size())
+        resize(2 * buckets_.size());
+}
+
+std::size_t CalendarQueue::findCurrentBucket()
+{
+    if (size_ == 0)
+        throw std::runtime_error("Calendar queue is empty");
+
+    // scan at most one year forward from the current day
+    for (std::size_t scanned = 0; scanned < buckets_.size(); ++scanned)
+    {
+        std::size_t idx = static_cast<std::size_t>(current_day_) & (buckets_.size() - 1);
+        const Bucket &bucket = buckets_[idx];
+        if (!bucket.empty() && bucket.front().time < (current_day_ + 1) * width_)
+            return idx;
+        ++current_day_;
+    }
+
+    // nothing due within a year: jump directly to the earliest event
+    std::size_t earliest = buckets_.size();
+    for (std::size_t idx = 0; idx < buckets_.size(); ++idx)
+    {
+        if (!buckets_[idx].empty() &&
+            (earliest == buckets_.size() || buckets_[idx].front().time < buckets_[earliest].front().time))
+            earliest = idx;
+    }
+    current_day_ = buckets_[earliest].front().time / width_;
+    return earliest;
+}
+
+const Event &CalendarQueue::top()
+{
+    const TickGroup &group = buckets_[findCurrentBucket()].front();
+    return group.events[group.head];
+}
+
+Event CalendarQueue::take()
+{
+    Bucket &bucket = buckets_[findCurrentBucket()];
+    TickGroup &group = bucket.front();
+    Event event = std::move(group.events[group.head++]);
+    if (group.head == group.events.size())
+        bucket.erase(bucket.begin());
+    --size_;
+    return event;
+}
+
+Event CalendarQueue::pop()
+{
+    Event event = take();
+    if (buckets_.size() > MIN_BUCKETS && size_ < buckets_.size() / 2)
+        resize(buckets_.size() / 2);
+    return event;
+}
+
+// Brown's heuristic: three times the average gap between the earliest
+// distinct pending times, ignoring gaps more than twice the first average.
+// `events` must be in dequeue order.
+SimTick CalendarQueue::estimateWidth(const std::vector<Event> &events) const
+{
+    const std::size_t SAMPLE = 64;
+    std::size_t n = std::min(SAMPLE, events.size());
+    if (n < 2)
+        return width_;
+
+    std::vector<SimTick> gaps;
+    for (std::size_t i = 1; i < n; ++i)
+    {
+        SimTick gap = events[i].getTime() - events[i - 1].getTime();
+        if (gap > 0)
+            gaps.push_back(gap);
+    }
+    if (gaps.empty())
+        return width_;
+
+    SimTick sum = 0;
+    for (SimTick gap : gaps)
+        sum += gap;
+    SimTick average = sum / static_cast<SimTick>(gaps.size());
+
+    SimTick trimmed_sum = 0, trimmed_count = 0;
+    for (SimTick gap : gaps)
+    {
+        if (gap <= 2 * average)
+        {
+            trimmed_sum += gap;
+            ++trimmed_count;
+        }
+    }
+    if (trimmed_count > 0)
+        average = trimmed_sum / trimmed_count;
+
+    return std::max<SimTick>(1, 3 * average);
+}
+
+void CalendarQueue::resize(std::size_t bucket_count)
+{
+    // drain in dequeue order; this both samples the earliest events and lets
+    // every reinsertion be an O(1) group append
+    std::vector<Event> events;
+    events.reserve(size_);
+    while (size_ > 0)
+        events.push_back(take());
+
+    width_ = estimateWidth(events);
+    buckets_.assign(std::max(bucket_count, MIN_BUCKETS), Bucket());
+    size_ = events.size();
+    for (auto &event : events)
+        insert(std::move(event));
+    current_day_ = events.empty() ? 0 : events.front().getTime() / width_;
+}
+
+std::unique_ptr<EventQueue> makeEventQueue(QueueType type)
+{
+    switch (type)
+    {
+    case QueueType::BINARY_HEAP:
+        return std::make_unique<BinaryHeapQueue>();
+    case QueueType::CALENDAR:
+        return std::make_unique<CalendarQueue>();
+    }
+    throw std::runtime_error("Unknown event queue type");
+}
@@ -1,70 +1,300 @@
+#include <cstdio>
+#include <fstream>
 #include <sstream>
 #include <string>
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <type_traits>
 
 #include "event_simulator.hpp"
+#include "conservative_engine.hpp"
+#include "time_warp_engine.hpp"
+#include "trace_writer.hpp"
 #include "processor.hpp"
-#include "utils.hpp"
+#include "snapshot.hpp"
+#include "mapped_file.hpp"
 
-void EventSimulator::init(int num_processes, int elements_per_processor)
+void EventSimulator::init(int num_processes, int elements_per_processor, const SimConfig &config)
 {
+    config_ = config;
+    kernels_ = SortKernels::resolve(config_.kernels);
+    if (config_.early_termination && config_.engine != EngineType::SEQUENTIAL &&
+        config_.engine != EngineType::CONSERVATIVE)
+        throw std::runtime_error("Early termination needs the sequential or conservative engine");
+    if (config_.run_collective && config_.engine != EngineType::SEQUENTIAL)
+        throw std::runtime_error("Collectives need the sequential engine");
+
+    // events hold ranks in 24 bits
+    if (num_processes > Event::MAX_RANK)
+        throw std::runtime_error("At most " + std::to_string(Event::MAX_RANK) + " processors can be simulated");
 
     // processor declarations
     num_processes_ = num_processes;
     elements_per_processor_ = elements_per_processor;
+    if (config_.workload.seeded)
+        data_seed_ = config_.workload.seed;
+    else
+    {
+        std::random_device rd;
+        data_seed_ = static_cast<std::uint64_t>(rd()) << 32 | rd();
+    }
 
     // MyMPI init
-    mpi = &MyMPI::getInstance();
-    mpi->init(num_processes_);
+    mpi_.init(num_processes_, config_.network);
+    if (config_.run_collective)
+        configuredCollective(); // reject a bad root / algorithm before any work
+
+    // the sort run at START_SORT; throws if it cannot sort on this many ranks
+    sort_algorithm_ = makeSortAlgorithm(config_.sort_algorithm, num_processes_);
+    if (!config_.run_collective && !sort_algorithm_->comparesSplits() && config_.engine != EngineType::SEQUENTIAL)
+        throw std::runtime_error(std::string(sortAlgorithmTitle(config_.sort_algorithm)) +
+                                 " runs on collectives and needs the sequential engine");
+    if (config_.early_termination && config_.sort_algorithm != SortAlgorithmType::ODD_EVEN)
+        throw std::runtime_error("Early termination needs odd-even sort");
+    if ((!config_.checkpoint_file.empty() || !config_.resume_file.empty()) &&
+        (config_.engine != EngineType::SEQUENTIAL || config_.run_collective || !sort_algorithm_->comparesSplits()))
+        throw std::runtime_error("Checkpoints need the sequential engine and a compare-split sort");
+    if (!config_.timeline_file.empty() &&
+        ((config_.engine != EngineType::SEQUENTIAL && config_.engine != EngineType::THREADS) ||
+         config_.run_collective || !sort_algorithm_->comparesSplits()))
+        throw std::runtime_error("The timeline needs the sequential or threads engine and a compare-split sort");
+    if (!mpi_.network().contentionFree())
+    {
+        if (config_.engine != EngineType::SEQUENTIAL && config_.engine != EngineType::THREADS)
+            throw std::runtime_error("The links network model needs the sequential engine");
+        if (config_.event_generation == EventGeneration::EAGER || config_.early_termination)
+            throw std::runtime_error("Eager event generation and early termination schedule phases at fixed times "
+                                     "and need a contention-free network model");
+    }
+
+    // a phase's compare-split is due once its message has arrived (without
+    // contention) and the next phase starts after it
+    SimTick transfer = mpi_.network().latency(elements_per_processor_);
+    split_delay_ = std::max(SimTime::RECV_TIME + SimTime::COMPARE_SPLIT_TIME - SimTime::SEND_TIME,
+                            transfer + SimTime::RECV_TIME);
+    phase_delay_ = std::max(toTicks(config_.phase_delay), SimTime::SEND_TIME + split_delay_);
 
     // Create processor instances
+    // all ranks' data in one arena, processors are views into it
     processors_.clear();
+    processor_store_.init(num_processes, elements_per_processor);
     processors_.reserve(num_processes);
     for (int i = 0; i < num_processes; ++i)
     {
-        processors_.push_back(std::make_unique<Processor>(i, num_processes));
+        processors_.emplace_back(i, num_processes, processor_store_);
+    }
+
+    // per-event console output is only readable from the sequential engine
+    verbose_ = config_.verbose && config_.engine == EngineType::SEQUENTIAL;
+    for (auto &processor : processors_)
+    {
+        processor.setVerbose(verbose_);
+        processor.setKernels(kernels_);
+        processor.mailbox() = MatchingEngine(config_.matching);
     }
 
     // Reset simulation state
-    current_time_ = 0.0;
+    current_time_ = 0;
+    sort_start_time_ = 0;
+    phase_offset_ = 0;
+    next_sequence_ = 0;
+    resumed_ = false;
+    checkpoints_written_ = 0;
+
+    // pending events ordered by (time, sequence); a queue of the same type is
+    // emptied and reused, so a batch worker keeps its buffers
+    if (event_queue_ && event_queue_type_ == config_.queue_type)
+        event_queue_->clear();
+    else
+    {
+        event_queue_ = makeEventQueue(config_.queue_type);
+        event_queue_type_ = config_.queue_type;
+    }
 
-    // MAX HEAP FOR EVENT TIME, (comparator reverse the sort so it is MIN HEAP now)
-    event_queue_ = std::priority_queue<Event, std::vector<Event>, EventComparator>();
+    // per-run pool statistics; slabs from earlier runs are reused
+    payload_pool_.resetStats();
 }
 
 void EventSimulator::initializeData()
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(1, 100000);
+    WorkloadGenerator generator(config_.workload, data_seed_, num_processes_, elements_per_processor_);
 
-    for (auto &processor : processors_)
-    {
-        std::vector<int> data(elements_per_processor_);
-        for (int &val : data)
+    // ranks are independent: workers take the next rank until none is left,
+    // with at least 64K keys per worker so small inputs do not start threads
+    std::size_t total = static_cast<std::size_t>(num_processes_) * elements_per_processor_;
+    int workers = config_.threads > 0 ? config_.threads
+                                      : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workers = static_cast<int>(std::max<std::size_t>(
+        1, std::min({static_cast<std::size_t>(workers), static_cast<std::size_t>(num_processes_), total >> 16})));
+    std::atomic<int> next{0};
+    auto work = [&]() {
+        std::vector<Key> data(elements_per_processor_);
+        for (int rank = next++; rank < num_processes_; rank = next++)
         {
-            val = dis(gen);
+            generator.generate(rank, data.data());
+            processors_[rank].setData(data.data(), data.size());
         }
-        processor->setData(data);
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; ++i)
+        threads.emplace_back(work);
+    work(); // the calling thread is a worker too
+    for (auto &thread : threads)
+        thread.join();
+
+    if (config_.run_collective)
+        initializeCollectiveInput();
+}
+
+void EventSimulator::loadData(const std::vector<std::vector<Key>> &data)
+{
+    if (data.size() != processors_.size())
+        throw std::runtime_error("Data for " + std::to_string(data.size()) + " processors, not " +
+                                 std::to_string(processors_.size()));
+    for (auto &processor : processors_)
+        processor.setData(data[processor.getRank()]);
+}
+
+void EventSimulator::loadDataFile(const std::string &path)
+{
+    MappedFile file(path);
+    std::size_t count = static_cast<std::size_t>(num_processes_) * elements_per_processor_;
+    if (file.size() / sizeof(Key) < count)
+        throw std::runtime_error(path + " holds " + std::to_string(file.size() / sizeof(Key)) + " " + KEY_TYPE_NAME +
+                                 " keys, " + std::to_string(num_processes_) + " x " +
+                                 std::to_string(elements_per_processor_) + " are needed");
+
+    // zero-copy where the store allows it, else one copy per rank out of the page cache
+    bool mapped = processor_store_.mapInput(file.fd());
+    const Key *data = reinterpret_cast<const Key *>(file.data());
+    for (auto &processor : processors_)
+    {
+        if (mapped)
+            processor.adoptSliceData();
+        else
+            processor.setData(data + static_cast<std::size_t>(processor.getRank()) * elements_per_processor_,
+                              elements_per_processor_);
+    }
+
+    if (config_.run_collective)
+        initializeCollectiveInput();
+}
+
+void EventSimulator::writeDataFile(const std::string &path) const
+{
+    // written next to the file and renamed over it: `path` may be the --input
+    // file, which plane 0 still maps
+    const std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        throw std::runtime_error("Cannot open output file " + temporary);
+    for (const auto &processor : processors_)
+    {
+        DataView data = processor.getData();
+        out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(Key)));
+    }
+    out.close();
+    if (out.fail())
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Error writing output file " + temporary);
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Cannot rename " + temporary + " to " + path);
+}
+
+bool EventSimulator::sortedAcrossRanks() const
+{
+    const Key *last = nullptr;
+    for (const auto &processor : processors_)
+    {
+        DataView data = processor.getData();
+        if (data.empty())
+            continue;
+        if ((last && data[0] < *last) || !std::is_sorted(data.begin(), data.end()))
+            return false;
+        last = data.end() - 1;
     }
+    return true;
 }
 
+Collectives::Schedule EventSimulator::configuredCollective() const
+{
+    switch (config_.collective)
+    {
+    case Collectives::Op::BCAST:
+        return mpi_.bcast(config_.collective_root, config_.collective_algorithm);
+    case Collectives::Op::SCATTER:
+        return mpi_.scatter(config_.collective_root, config_.collective_algorithm);
+    case Collectives::Op::GATHER:
+        return mpi_.gather(config_.collective_root, config_.collective_algorithm);
+    case Collectives::Op::ALLREDUCE:
+        return mpi_.allreduce(config_.collective_reduce, config_.collective_algorithm);
+    case Collectives::Op::ALLTOALL:
+        break;
+    }
+    return mpi_.alltoall(config_.collective_algorithm);
+}
 
-// For debugging purposes
-void EventSimulator::initializeData1()
+void EventSimulator::initializeCollectiveInput()
 {
+    std::mt19937_64 gen(data_seed_);
+    const int root = config_.collective_root;
+
+    // one block per rank: equal parts, or cut at random points for the v variants
+    auto cut = [&](DataView data) {
+        std::vector<std::size_t> bounds(num_processes_ + 1);
+        for (int b = 0; b <= num_processes_; ++b)
+            bounds[b] = data.size() * b / num_processes_;
+        if (config_.collective_varying)
+        {
+            std::uniform_int_distribution<std::size_t> dis(0, data.size());
+            for (int b = 1; b < num_processes_; ++b)
+                bounds[b] = dis(gen);
+            std::sort(bounds.begin() + 1, bounds.end() - 1);
+        }
+        std::vector<std::vector<Key>> blocks(num_processes_);
+        for (int b = 0; b < num_processes_; ++b)
+            blocks[b].assign(data.begin() + bounds[b], data.begin() + bounds[b + 1]);
+        return blocks;
+    };
 
+    collective_input_.assign(num_processes_, {});
     for (auto &processor : processors_)
     {
-        std::vector<int> data(elements_per_processor_);
-        int i = 0;
-        for (int &val : data)
+        int rank = processor.getRank();
+        DataView data = processor.getData();
+        std::vector<std::vector<Key>> &blocks = collective_input_[rank];
+        switch (config_.collective)
         {
-            val = (processor->getRank() * elements_per_processor_) + i++;
-            val *= -1;
-            std::cout << val << " ";
+        case Collectives::Op::BCAST:
+            if (rank == root)
+                blocks.emplace_back(data.begin(), data.end());
+            break;
+        case Collectives::Op::SCATTER:
+            if (rank == root)
+                blocks = cut(data);
+            break;
+        case Collectives::Op::GATHER:
+        {
+            std::size_t count = data.size();
+            if (config_.collective_varying)
+                count = std::uniform_int_distribution<std::size_t>(0, data.size())(gen);
+            blocks.emplace_back(data.begin(), data.begin() + count);
+            break;
         }
-        processor->setData(data);
+        case Collectives::Op::ALLREDUCE:
+            blocks.emplace_back(data.begin(), data.end());
+            break;
+        case Collectives::Op::ALLTOALL:
+            blocks = cut(data);
+            break;
+        }
+        processor.collectiveBuffer() = blocks;
     }
 }
 
@@ -75,123 +305,275 @@ Processor *EventSimulator::findProcessor(int rank)
         return nullptr; // Invalid rank
     }
 
-    // Search through processors to find matching rank
-    for (const auto &processor : processors_)
+    // processors_ is indexed by rank
+    return &processors_[rank];
+}
+
+void EventSimulator::scheduleEvent(Event event)
+{
+    if (parallel_engine_)
     {
-        if (processor->getRank() == rank)
-        {
-            return processor.get();
-        }
+        parallel_engine_->schedule(std::move(event));
+        return;
     }
-
-    return nullptr; // No processor found with this rank
+    event.setSequence(next_sequence_++);
+    event_queue_->push(std::move(event));
 }
 
 void EventSimulator::run()
 {
 
-    // logging events to output file
-    std::ofstream logFile("event_log.txt");
-    if (logFile.is_open())
+    // binary trace of the processed events, readable with trace2txt
+    std::unique_ptr<TraceWriter> trace;
+    if (!config_.trace_file.empty())
     {
-        // HEADER (might turn it to csv for visualization)
-        logFile << "=== DISCRETE EVENT SIMULATION LOG ===\n";
-        logFile << "Number of Processors: " << num_processes_ << "\n";
-        logFile << "Elements per Processor: " << elements_per_processor_ << "\n";
-        logFile << "Total Elements: " << (num_processes_ * elements_per_processor_) << "\n";
-        logFile << "========================================\n\n";
+        try
+        {
+            trace = std::make_unique<TraceWriter>(config_.trace_file, num_processes_, elements_per_processor_);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Warning: " << e.what() << ", running without event trace" << std::endl;
+        }
     }
 
-    event_queue_.push(Event(current_time_ + SimTime::START_SORT_TIME, EventType::START_SORT, 0, 0, {}));
+    instrumentation_.reset();
+    // simulated-time profile, the handlers report to it
+    timeline_.reset();
+    if (!config_.timeline_file.empty())
+        timeline_ = std::make_unique<Timeline>(config_.timeline_file, num_processes_, current_time_);
 
-    while (!event_queue_.empty())
+    if (resumed_)
+        resumed_ = false; // the restored queue holds the rest of the run
+    else
     {
-        const Event &event = event_queue_.top();
-        current_time_ = event.getTime();
+        stats_ = EngineStats();
+        mpi_.resetNetwork();
+        if (!config_.checkpoint_file.empty())
+            input_digest_ = dataDigest();
+        if (config_.run_collective)
+            startCollective(configuredCollective(), current_time_ + SimTime::START_SORT_TIME);
+        else
+            scheduleEvent(Event(current_time_ + SimTime::START_SORT_TIME, EventType::START_SORT, 0, 0, {}));
+    }
 
-        // Process each event based on its type
-        switch (event.getType())
+    if (config_.engine == EngineType::SEQUENTIAL)
+    {
+        runSequential(trace.get());
+    }
+    else if (config_.engine == EngineType::THREADS)
+    {
+        runThreads(trace.get());
+    }
+    else
+    {
+        std::unique_ptr<ParallelEngine> engine;
+        if (config_.engine == EngineType::CONSERVATIVE)
+            engine = std::make_unique<ConservativeEngine>(*this, config_.threads);
+        else
+            engine = std::make_unique<TimeWarpEngine>(*this, config_.threads, toTicks(config_.time_warp_window));
+
+        parallel_engine_ = engine.get();
+        try
         {
-        case EventType::SEND:
-            processSendEvent(event);
-            break;
-        case EventType::RECV:
-            processRecvEvent(event);
-            break;
-        case EventType::START_SORT:
-            processStartSortEvent(event);
-            break;
-        case EventType::COMPARE_SPLIT:
-            processCompareSplitEvent(event);
-            break;
+            engine->run(trace.get());
+        }
+        catch (...)
+        {
+            parallel_engine_ = nullptr;
+            throw;
         }
+        parallel_engine_ = nullptr;
+    }
 
-        event_queue_.pop();
+    if (trace)
+    {
+        trace->close();
+        std::cout << "\nEvent trace saved to: " << trace->path() << " (" << trace->records()
+                  << " records, trace2txt converts it to text)" << std::endl;
+    }
+    if (timeline_)
+    {
+        timeline_->finish(current_time_);
+        timeline_->write(std::string(sortAlgorithmTitle(config_.sort_algorithm)) + ", " +
+                         std::to_string(num_processes_) + " ranks x " + std::to_string(elements_per_processor_) +
+                         " elements");
+        std::cout << "Timeline saved to: " << timeline_->path() << " (" << timeline_->spanCount()
+                  << " spans, Chrome trace JSON: open in ui.perfetto.dev)" << std::endl;
+    }
+}
 
-        // append for logging
-        if (logFile.is_open())
+void EventSimulator::runSequential(TraceWriter *trace)
+{
+    // checkpoints at multiples of the interval, between the last event before and the first after it
+    SimTick interval = config_.checkpoint_file.empty() ? 0 : std::max<SimTick>(toTicks(config_.checkpoint_interval), 1);
+    SimTick next_checkpoint = interval > 0 ? (current_time_ / interval + 1) * interval : 0;
+    Instrumentation::Scope instrumented(instrumentation_);
+    while (!event_queue_->empty())
+    {
+        if (interval > 0 && event_queue_->top().getTime() >= next_checkpoint)
         {
-            logFile << toStringEvent(event, current_time_) << "\n";
+            writeCheckpoint(config_.checkpoint_file);
+            ++checkpoints_written_;
+            next_checkpoint = (event_queue_->top().getTime() / interval + 1) * interval;
         }
-        // event_log_ += toStringEvent(event, current_time_) + "\n";
+
+        // take the event out before dispatching, handlers schedule new ones
+        Event event = event_queue_->pop();
+        current_time_ = event.getTime();
+
+        std::uint64_t dispatched = instrumentation_.eventStart(event.getType());
+        dispatchEvent(event);
+        if constexpr (Instrumentation::ENABLED)
+            instrumentation_.eventDone(dispatched, event_queue_->size(), current_time_);
+        ++stats_.events_processed;
+        stats_.traffic.add(event, elementBytes());
+
+        if (trace)
+            trace->record(event);
     }
+    stats_.queue_high_water = event_queue_->highWaterMark();
+    instrumentation_.stop();
+}
+
+void EventSimulator::runThreads(TraceWriter *trace)
+{
+    std::vector<std::vector<Key>> data;
+    for (const auto &processor : processors_)
+        data.emplace_back(processor.getData().begin(), processor.getData().end());
+
+    // the discrete-event run on the input predicts the phases
+    simulated_phases_.assign(sort_algorithm_->phases(), SimulatedPhase());
+    record_phases_ = true;
+    runSequential(trace);
+    record_phases_ = false;
+
+    // then the same input sorted on real threads, its result is the one kept
+    ThreadBackend backend(*sort_algorithm_, num_processes_, config_.threads, kernels_);
+    thread_stats_ = backend.run(data);
+    for (auto &processor : processors_)
+        processor.setData(std::move(data[processor.getRank()]), true);
+}
 
-    // print processed events log
-    // std::cout << "\n\n\t --EVENT LOGGED IN PROCESS ORDER--\n";
-    // std::cout << event_log_;
-    if (logFile.is_open())
+const EventSimulator::EventKind &EventSimulator::eventKind(EventType type)
+{
+    // one entry per event type, in the order of the enum
+    static constexpr EventKind KINDS[] = {
+        {EventType::SEND, &EventSimulator::processSendEvent, EventOwner::SOURCE, false},
+        {EventType::RECV, &EventSimulator::processRecvEvent, EventOwner::DEST, false},
+        {EventType::START_SORT, &EventSimulator::processStartSortEvent, EventOwner::GLOBAL, false},
+        {EventType::COMPARE_SPLIT, &EventSimulator::processCompareSplitEvent, EventOwner::SOURCE, true},
+        {EventType::ALLREDUCE, &EventSimulator::processAllreduceEvent, EventOwner::GLOBAL, false},
+        {EventType::COLLECTIVE, &EventSimulator::processCollectiveEvent, EventOwner::DEST, false},
+        {EventType::SORT_STEP, &EventSimulator::processSortStepEvent, EventOwner::GLOBAL, false},
+    };
+    static_assert(sizeof(KINDS) / sizeof(KINDS[0]) == EVENT_TYPE_COUNT, "every event type needs a handler");
+    static_assert([] {
+        for (int i = 0; i < EVENT_TYPE_COUNT; ++i)
+            if (static_cast<int>(KINDS[i].type) != i)
+                return false;
+        return true;
+    }(), "handler table out of the order of EventType");
+    return KINDS[static_cast<int>(type)];
+}
+
+void EventSimulator::dispatchEvent(const Event &event)
+{
+    (this->*eventKind(event.getType()).handler)(event);
+}
+
+int EventSimulator::ownerRank(const Event &event)
+{
+    switch (eventKind(event.getType()).owner)
     {
-        logFile.close();
-        std::cout << "\nEvent log saved to: event_log.txt" << std::endl;
+    case EventOwner::SOURCE:
+        return event.getSourceRank();
+    case EventOwner::DEST:
+        return event.getDestRank();
+    case EventOwner::GLOBAL:
+        break;
     }
+    return GLOBAL_EVENT;
 }
 
+bool EventSimulator::rewritesLocalData(const Event &event)
+{
+    return eventKind(event.getType()).rewrites_local;
+}
+
+SimTick EventSimulator::lookahead() const
+{
+    // the only events one rank schedules for another are RECVs, created by a
+    // SEND handler at least the network's minimum latency ahead
+    return mpi_.network().minLatency();
+}
+
+// Handlers only use the event's own time: under the parallel engines several
+// of them run at once and current_time_ is not theirs to read.
 void EventSimulator::processSendEvent(const Event &event)
 {
-    double event_process_time = event.getTime();
-    if (event_process_time >= current_time_)
-        setCurrentTime(event_process_time);
+    SimTick now = event.getTime();
 
     auto curr_processor = findProcessor(event.getSourceRank());
-    auto curr_message = curr_processor->getData();
 
-    std::cout << "\n[Event Time: " << current_time_ << "] Processing SEND event:"
-              << "\n  From: Processor " << event.getSourceRank()
-              << "\n  To: Processor " << event.getDestRank();
-    //           << "\n  Data: ";
+    // sort before sending (once, on the first send) so the receiver need not
+    // sort its copy; the data is sorted before its compare-split anyway
+    curr_processor->sortLocalData();
 
-    // for (int val : curr_message)
-    // {
-    //     std::cout << val << " ";
-    // }
-    std::cout << "\n  Tag: " << event.getTag() << std::endl;
+    // the only copy of the message: sender's data written once into a pooled buffer
+    DataView local = curr_processor->getData();
+    Payload curr_message = payload_pool_.copyOf(local.data(), local.size());
+    curr_message.setSorted(curr_processor->isSorted());
+
+    // nonblocking exchange with the partner: post the receive of its data, and
+    // our send, done once the message has left
+    MatchingEngine &mailbox = curr_processor->mailbox();
+    SimTick sent = now + mpi_.wireTime(local.size());
+    curr_processor->phaseRequests() = {mailbox.irecv(event.getDestRank(), event.getTag()), mailbox.isend(sent)};
+    if (timeline_)
+        timeline_->send(event.getSourceRank(), event.getDestRank(), event.getTag(), now, sent);
+    if (record_phases_)
+    {
+        SimulatedPhase &phase = simulated_phases_[event.getTag()];
+        phase.start = phase.start < 0 ? now : std::min(phase.start, now);
+    }
 
-    double expected_arrival_time = current_time_ + SimTime::RECV_TIME;
+    if (verbose_)
+    {
+        std::cout << "\n[Event Time: " << ticksToUnits(now) << "] Processing SEND event:"
+                  << "\n  From: Processor " << event.getSourceRank()
+                  << "\n  To: Processor " << event.getDestRank();
+        //           << "\n  Data: ";
+
+        // for (int val : curr_message)
+        // {
+        //     std::cout << val << " ";
+        // }
+        std::cout << "\n  Tag: " << event.getTag() << std::endl;
+    }
 
-    // Schedule the RECV event after SEND_TIME
-    scheduleEvent(mpi->receive(event.getDestRank(), event.getSourceRank(), curr_message, event.getTag(), expected_arrival_time));
+    // the RECV event fires when the network model has delivered the message
+    scheduleEvent(mpi_.receive(event.getDestRank(), event.getSourceRank(), std::move(curr_message), event.getTag(), now));
 }
 
 // this function's aim is to get new array to local cache!!
 void EventSimulator::processRecvEvent(const Event &event)
 {
-    // time calculation
-    double event_process_time = event.getTime();
-    if (event_process_time >= current_time_)
-        setCurrentTime(event_process_time);
-
     // find processor
     Processor *curr_processor = findProcessor(event.getDestRank());
 
-    std::cout << "\n[Event Time: " << current_time_ << "] Processing RECV event:"
-              << "\n  Receiver: Processor " << event.getDestRank()
-              << "\n  From: Processor " << event.getSourceRank();
-            //   << "\n  Data: ";
-    // for (int val : event.getData())
-    // {
-    //     std::cout << val << " ";
-    // }
-    std::cout << "\n  Tag: " << event.getTag() << std::endl;
+    if (verbose_)
+    {
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] Processing RECV event:"
+                  << "\n  Receiver: Processor " << event.getDestRank()
+                  << "\n  From: Processor " << event.getSourceRank();
+                //   << "\n  Data: ";
+        // for (int val : event.getData())
+        // {
+        //     std::cout << val << " ";
+        // }
+        std::cout << "\n  Tag: " << event.getTag() << std::endl;
+    }
 
     // std::cout << " Current local_cache: \n\t";
     // for (int val : curr_processor->getData())
@@ -199,7 +581,15 @@ void EventSimulator::processRecvEvent(const Event &event)
     //     std::cout << val << " ";
     // }
 
-    curr_processor->setReceived(event.getData());
+    // complete the receive the phase's SEND posted; a message of a phase the
+    // receiver has not reached yet (link contention) waits as unexpected. If its
+    // compare-split was already due and waits for it, that resumes now.
+    std::optional<Event> resumed = curr_processor->mailbox().arrive(event.getSourceRank(), event.getTag(),
+                                                                    event.getData(), event.getTime());
+    if (timeline_)
+        timeline_->arrive(event.getDestRank(), event.getSourceRank(), event.getTag(), event.getTime());
+    if (resumed)
+        scheduleEvent(*resumed);
 
     // std::cout << "\n Current received_cache: \n\t";
     // for (int val : curr_processor->getReceived())
@@ -224,131 +614,501 @@ void EventSimulator::processStartSortEvent(const Event &event)
      *
      *  each iteration increase arrival time
      *
+     *  EAGER generation schedules every phase here (O(P^2) pending events),
+     *  LAZY generation schedules only the first phase of each processor; the
+     *  next one is scheduled when its compare-split completes (O(P) pending).
+     *
      *  AFTER PROCESSING CURR_TIME becomes curr_time + START_SORT_TIME !!!!! not arrival time
      */
 
-    double event_process_time = event.getTime();
-    if (event_process_time >= current_time_)
-        setCurrentTime(event_process_time);
+    if (verbose_)
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] Starting SORT event:"
+                  << std::endl;
+
+    sort_start_time_ = event.getTime();
+    if (timeline_)
+        timeline_->start(event.getTime());
+
+    // sorts built on collectives schedule their own steps
+    if (!sort_algorithm_->comparesSplits())
+    {
+        sort_algorithm_->start(*this, event.getTime());
+        return;
+    }
+
+    // a lone rank has no partner to compare-split with, it only sorts locally
+    if (num_processes_ == 1)
+        processors_[0].sortLocalData();
+
+    if (config_.early_termination)
+    {
+        schedulePhasePair(0);
+        return;
+    }
 
-    std::cout << "\n[Event Time: " << current_time_ << "] Starting SORT event:"
-              << std::endl;
+    stats_.phases_executed = sort_algorithm_->phases();
+    if (config_.event_generation == EventGeneration::LAZY)
+    {
+        for (auto &&p : processors_)
+            scheduleNextPhase(p, 0);
+        return;
+    }
 
-    for (int i = 0; i < (int)processors_.size(); i++)
+    for (int i = 0; i < sort_algorithm_->phases(); i++)
     {
         bool isOddPhase = i % 2 != 0;
-        std::cout << "\n\t Entered " << i + 1 << ". Phase: " << (isOddPhase ? "ODD" : "EVEN") << std::endl;
+        if (verbose_)
+            std::cout << "\n\t Entered " << i + 1 << ". Phase: " << (isOddPhase ? "ODD" : "EVEN") << std::endl;
 
         for (auto &&p : processors_)
-        {
-            // schedule send event
-            int my_rank = p->getRank();                     // current processor id
-            int neighbor_rank = p->getNeighbor(isOddPhase); // current processor's corresponding phase's neighbor id
-            if (neighbor_rank < 0 || neighbor_rank >= (int)processors_.size())
-                continue;
-            double expected_arrival_time = current_time_ + SimTime::SEND_TIME + i * SimTime::PHASE_DELAY;
+            schedulePhase(p, i);
+        if (verbose_)
+            std::cout << std::endl;
+    }
+}
 
-            std::cout << "\t [Processor " << my_rank << " ] Neighbor: [Processor " << neighbor_rank << "]" << std::endl;
-            scheduleEvent(mpi->send(my_rank, neighbor_rank, p->getData(), 0, expected_arrival_time));
-            std::cout << "\t SEND Event scheduled FROM [ " << my_rank
-                      << " ] TO: " << neighbor_rank << " AT ARRIVAL TIME: " << expected_arrival_time
-                      << std::endl;
+bool EventSimulator::schedulePhase(Processor &p, int phase, SimTick ready)
+{
+    // schedule send event
+    int my_rank = p.getRank();                                   // current processor id
+    int neighbor_rank = sort_algorithm_->partner(my_rank, phase); // its partner in this phase
+    if (neighbor_rank < 0)
+        return false;
+    // the phase's slot, or later while the processor is still busy with its previous phase
+    SimTick expected_arrival_time =
+        std::max(sort_start_time_ + phase_offset_ + SimTime::SEND_TIME + phase * phase_delay_, ready);
 
-            // // schedule recv event REDUNDANT
-            // expected_arrival_time += SimTime::RECV_TIME;
-            // scheduleEvent(mpi->receive(neighbor_rank, my_rank, p->getData(), 0, expected_arrival_time));
-            // std::cout << "\t RECV Event scheduled FOR [ " << neighbor_rank
-            //           << " ] FROM: " << my_rank << " AT ARRIVAL TIME: " << expected_arrival_time
-            //           << std::endl;
+    if (verbose_)
+        std::cout << "\t [Processor " << my_rank << " ] Neighbor: [Processor " << neighbor_rank << "]" << std::endl;
+    // no payload yet: the SEND handler snapshots the data when it fires
+    scheduleEvent(mpi_.send(my_rank, neighbor_rank, Payload(), phase, expected_arrival_time));
+    if (verbose_)
+        std::cout << "\t SEND Event scheduled FROM [ " << my_rank
+                  << " ] TO: " << neighbor_rank << " AT ARRIVAL TIME: " << ticksToUnits(expected_arrival_time)
+                  << std::endl;
 
-            // schedule comparesplit event
+    // schedule comparesplit event, split_delay_ after the SEND
+    expected_arrival_time += SimTime::SEND_TIME + split_delay_;
 
-            expected_arrival_time += SimTime::RECV_TIME + SimTime::COMPARE_SPLIT_TIME;
+    // the tag carries the phase number, the sort algorithm tells which half is kept
+    scheduleEvent(Event(expected_arrival_time, EventType::COMPARE_SPLIT,
+                        my_rank, neighbor_rank,
+                        Payload(), phase));
 
-            // pass isOddPhase boolean to determine which half of the array will be discarded
-            scheduleEvent(Event(expected_arrival_time, EventType::COMPARE_SPLIT,
-                                my_rank, isOddPhase ? 1 : 0,
-                                event.getData(), event.getTag()));
+    if (verbose_)
+        std::cout << "\t COMPARE-SPLIT Event scheduled FOR [ " << my_rank
+                  << " ] " << " AT ARRIVAL TIME: " << ticksToUnits(expected_arrival_time)
+                  << std::endl << std::endl;
+    return true;
+}
 
-            std::cout << "\t COMPARE-SPLIT Event scheduled FOR [ " << my_rank
-                      << " ] " << " AT ARRIVAL TIME: " << expected_arrival_time
-                      << std::endl;
-            std::cout << std::endl;
-        }
-        std::cout << std::endl;
+void EventSimulator::scheduleNextPhase(Processor &p, int phase, SimTick ready)
+{
+    // edge processors sit out every other phase
+    for (; phase < sort_algorithm_->phases(); ++phase)
+    {
+        if (schedulePhase(p, phase, ready))
+            return;
     }
 }
-void EventSimulator::processCompareSplitEvent(const Event &event)
+
+void EventSimulator::schedulePhasePair(int first_phase)
+{
+    int last_phase = std::min(first_phase + 1, sort_algorithm_->phases() - 1);
+    for (auto &&p : processors_)
+    {
+        for (int phase = first_phase; phase <= last_phase; ++phase)
+            schedulePhase(p, phase);
+    }
+    stats_.phases_executed = last_phase + 1;
+
+    // the allreduce starts once the last compare-split of the pair is done
+    SimTick pair_end = sort_start_time_ + phase_offset_ + SimTime::SEND_TIME + last_phase * phase_delay_ +
+                       SimTime::SEND_TIME + split_delay_;
+    scheduleEvent(mpi_.allreduce(first_phase, pair_end));
+}
+
+void EventSimulator::processAllreduceEvent(const Event &event)
 {
-    double event_process_time = event.getTime();
-    if (event_process_time >= current_time_)
-        setCurrentTime(event_process_time);
+    // logical OR over "did my last compare-splits change anything"; every
+    // flag is taken so the next pair starts from a clean slate
+    bool changed = false;
+    for (auto &&p : processors_)
+        changed = p.takeChanged() || changed;
 
-    bool isOddPhase = (event.getDestRank() == 1);
-    std::string phaseName = isOddPhase ? "(ODD PHASE)" : "(EVEN_PHASE)";
-    std::cout << "\n[Event Time: " << current_time_ << "] Starting COMPARE - SPLIT event" << phaseName << ":"
-              << std::endl;
+    int next_phase = event.getTag() + 2;
+    bool done = !changed || next_phase >= sort_algorithm_->phases();
+    if (timeline_)
+        timeline_->allreduce(event.getTime(), mpi_.allreduceTime());
+    if (verbose_)
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] ALLREDUCE after phases "
+                  << event.getTag() << "-" << event.getTag() + 1 << ": "
+                  << (changed ? "data changed" : "nothing changed") << (done ? ", sort finished" : "") << std::endl;
+    if (done)
+        return;
+
+    // later phases shift by the time the allreduce took
+    phase_offset_ += mpi_.allreduceTime();
+    schedulePhasePair(next_phase);
+}
+
+void EventSimulator::processCompareSplitEvent(const Event &event)
+{
+    bool isOddPhase = event.getTag() % 2 != 0;
+    if (verbose_)
+    {
+        std::string phaseName = isOddPhase ? "(ODD PHASE)" : "(EVEN_PHASE)";
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] Starting COMPARE - SPLIT event" << phaseName << ":"
+                  << std::endl;
+    }
 
     auto p = findProcessor(event.getSourceRank());
 
-    // std::cout << "Processor: [" << p->getRank() << " ]" << std::endl;
+    // the phase's irecv and isend; a message held up by link contention resumes
+    // the compare-split RECV_TIME after it arrives (the Time Warp engine may
+    // also get here before the message, and rolls back once it comes in)
+    std::array<Request, 2> &requests = p->phaseRequests();
+    Payload received[2];
+    if (!p->mailbox().testAll(requests.data(), requests.size(), event.getTime(), received))
+    {
+        if (verbose_)
+            std::cout << "  Message of phase " << event.getTag() << " not arrived yet, waiting" << std::endl;
+        if (std::optional<Event> due = p->mailbox().waitAll(requests.data(), requests.size(), event, SimTime::RECV_TIME))
+            scheduleEvent(*due);
+        return;
+    }
+    p->setReceived(std::move(received[0]));
 
-    // printVector(p->getData(), "Local cache");
-    // printVector(p->getReceived(), "Received cache");
+    // std::cout << "Processor: [" << p->getRank() << " ]" << std::endl;
 
     // LOCAL sort before compare-split
     p->localSort();
 
     // Handle compare-split logic in processor cache
-    p->handleMerge(isOddPhase);
+    p->handleMerge(sort_algorithm_->keepsLow(p->getRank(), event.getTag()),
+                   config_.engine == EngineType::TIME_WARP);
+    if (record_phases_)
+        simulated_phases_[event.getTag()].finish = std::max(simulated_phases_[event.getTag()].finish, event.getTime());
+    if (timeline_)
+        timeline_->compareSplit(p->getRank(), event.getDestRank(), event.getTag(), event.getTime());
+
+    if (verbose_)
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] Completed COMPARE - SPLIT event:"
+                  << std::endl;
 
-    std::cout << "\n[Event Time: " << current_time_ << "] Completed COMPARE - SPLIT event:"
-              << std::endl;
+    // with early termination the allreduce schedules the next phases
+    if (config_.event_generation == EventGeneration::LAZY && !config_.early_termination)
+        scheduleNextPhase(*p, event.getTag() + 1, event.getTime());
 }
 
-// toString() function to log events easily
-std::string EventSimulator::toStringEvent(const Event &event, double current_time) const
+void EventSimulator::startCollective(const Collectives::Schedule &schedule, SimTick time,
+                                     std::function<void(SimTick)> done)
 {
-    std::ostringstream oss;
+    if (parallel_engine_)
+        throw std::runtime_error("Collectives need the sequential engine");
+    if (collective_running_ > 0)
+        throw std::runtime_error("A collective is already running");
+    if (schedule.ranks() != num_processes_)
+        throw std::runtime_error("Collective schedule is for " + std::to_string(schedule.ranks()) + " ranks, not " +
+                                 std::to_string(num_processes_));
+
+    collective_.emplace(schedule);
+    collective_done_ = std::move(done);
+    collective_stats_ = Collectives::Stats();
+    collective_stats_.start = time;
+    collective_stats_.finish = time;
+    collective_stats_.rounds = schedule.rounds();
+    collective_stats_.element_bytes = elementBytes();
+    collective_progress_.assign(num_processes_, CollectiveProgress());
+    collective_running_ = num_processes_;
 
-    // Convert EventType enum to string
-    std::string type_str;
-    switch (event.getType())
+    // move the input blocks (or segments of the single block) into the algorithm's slots
+    for (auto &processor : processors_)
     {
-    case EventType::SEND:
-        type_str = "SEND";
-        break;
-    case EventType::RECV:
-        type_str = "RECV";
-        break;
-    case EventType::START_SORT:
-        type_str = "START_SORT";
-        break;
-    case EventType::COMPARE_SPLIT:
-        type_str = "COMPARE_SPLIT";
-        break;
+        int rank = processor.getRank();
+        std::vector<std::vector<Key>> &buffer = processor.collectiveBuffer();
+        std::vector<int> input = schedule.inputSlots(rank);
+        std::vector<std::vector<Key>> slots(schedule.slots());
+        std::size_t moved = 0;
+        if (schedule.segmented() && !input.empty())
+        {
+            if (buffer.size() != 1)
+                throw std::runtime_error("Processor " + std::to_string(rank) + " needs one input block for " +
+                                         Collectives::opName(schedule.op()));
+            const std::vector<Key> &block = buffer[0];
+            for (std::size_t s = 0; s < input.size(); ++s)
+                slots[input[s]].assign(block.begin() + block.size() * s / input.size(),
+                                       block.begin() + block.size() * (s + 1) / input.size());
+        }
+        else
+        {
+            if (buffer.size() < input.size())
+                throw std::runtime_error("Processor " + std::to_string(rank) + " holds " +
+                                         std::to_string(buffer.size()) + " input blocks, " +
+                                         Collectives::opName(schedule.op()) + " needs " + std::to_string(input.size()));
+            for (std::size_t b = 0; b < input.size(); ++b)
+            {
+                moved += buffer[b].size();
+                slots[input[b]] = std::move(buffer[b]);
+            }
+        }
+        buffer = std::move(slots);
 
-    default:
-        type_str = "UNKNOWN_TYPE";
-        break;
+        CollectiveProgress &progress = collective_progress_[rank];
+        progress.clock = time + (schedule.rotates() ? static_cast<SimTick>(moved) * SimTime::LOCAL_ELEMENT_TIME : 0);
+        progress.send_free = progress.clock;
+        progress.recv_free = progress.clock;
+    }
+
+    for (int rank = 0; rank < num_processes_; ++rank)
+        advanceCollective(rank);
+}
+
+void EventSimulator::advanceCollective(int rank)
+{
+    CollectiveProgress &progress = collective_progress_[rank];
+    std::vector<std::vector<Key>> &slots = processors_[rank].collectiveBuffer();
+    for (; progress.round < collective_->rounds(); ++progress.round)
+    {
+        Collectives::Round round = collective_->round(rank, progress.round);
+
+        // the round's data leaves now; each message waits for the wire time of the one before
+        for (const Collectives::Transfer &send : round.sends)
+        {
+            std::size_t elements = 0;
+            Payload message = Collectives::pack(payload_pool_, slots, send.slots, elements);
+            SimTick departure = std::max(progress.clock, progress.send_free);
+            progress.send_free = departure + mpi_.wireTime(elements);
+            scheduleEvent(mpi_.collectiveMessage(rank, send.peer, std::move(message), elements, progress.round, departure));
+            ++collective_stats_.messages;
+            collective_stats_.elements += elements;
+        }
+
+        progress.expected = std::move(round.recvs);
+        std::sort(progress.expected.begin(), progress.expected.end(),
+                  [](const Collectives::Transfer &a, const Collectives::Transfer &b) { return a.peer < b.peer; });
+        progress.awaiting = progress.expected.size();
+        progress.reduce = round.reduce;
+
+        // messages that arrived before the rank got here
+        for (std::size_t i = 0; i < progress.early.size();)
+        {
+            if (progress.early[i].getTag() != progress.round)
+            {
+                ++i;
+                continue;
+            }
+            deliverCollective(rank, progress.early[i]);
+            progress.early.erase(progress.early.begin() + i);
+        }
+        if (progress.awaiting > 0)
+            return;
+    }
+    finishCollective(rank);
+}
+
+void EventSimulator::deliverCollective(int rank, const Event &event)
+{
+    CollectiveProgress &progress = collective_progress_[rank];
+    auto transfer = std::lower_bound(progress.expected.begin(), progress.expected.end(), event.getSourceRank(),
+                                     [](const Collectives::Transfer &t, int peer) { return t.peer < peer; });
+    if (transfer == progress.expected.end() || transfer->peer != event.getSourceRank())
+        throw std::runtime_error("Unexpected collective message from " + std::to_string(event.getSourceRank()) +
+                                 " to " + std::to_string(rank));
+
+    std::size_t elements = Collectives::unpack(event.getData(), processors_[rank].collectiveBuffer(), transfer->slots,
+                                               progress.reduce, collective_->reduceOp());
+    // messages arriving together stream in one after another
+    SimTick received = std::max(event.getTime(), progress.recv_free + mpi_.wireTime(elements));
+    progress.recv_free = received;
+    progress.clock = std::max(progress.clock, received);
+    if (progress.reduce)
+        progress.clock += static_cast<SimTick>(elements) * SimTime::LOCAL_ELEMENT_TIME;
+    --progress.awaiting;
+}
+
+void EventSimulator::finishCollective(int rank)
+{
+    CollectiveProgress &progress = collective_progress_[rank];
+    std::vector<std::vector<Key>> &slots = processors_[rank].collectiveBuffer();
+    std::vector<int> output = collective_->outputSlots(rank);
+
+    std::vector<std::vector<Key>> result;
+    std::size_t moved = 0;
+    if (collective_->segmented() && !output.empty())
+    {
+        result.emplace_back();
+        for (int slot : output)
+            result[0].insert(result[0].end(), slots[slot].begin(), slots[slot].end());
+    }
+    else
+    {
+        for (int slot : output)
+        {
+            moved += slots[slot].size();
+            result.push_back(std::move(slots[slot]));
+        }
     }
+    slots = std::move(result);
+    if (collective_->rotates())
+        progress.clock += static_cast<SimTick>(moved) * SimTime::LOCAL_ELEMENT_TIME;
 
-    oss << "Time: " << current_time << ", ";
-    oss << "Type: " << type_str << ", ";
-    oss << "Src: " << event.getSourceRank() << ", ";
-    oss << "Dest: " << event.getDestRank() << ", ";
-    oss << "Tag: " << event.getTag() << "\n";
-    oss << "Data: [";
+    collective_stats_.finish = std::max(collective_stats_.finish, progress.clock);
+    if (--collective_running_ > 0)
+        return;
+    // taken out first: the callback may start the next collective
+    std::function<void(SimTick)> done = std::move(collective_done_);
+    collective_done_ = nullptr;
+    if (done)
+        done(collective_stats_.finish);
+}
+
+void EventSimulator::processCollectiveEvent(const Event &event)
+{
+    int rank = event.getDestRank();
+    if (verbose_)
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] Processing COLLECTIVE message:"
+                  << "\n  " << Collectives::opName(collective_->op()) << " round " << event.getTag()
+                  << ", Processor " << event.getSourceRank() << " -> Processor " << rank << std::endl;
+
+    CollectiveProgress &progress = collective_progress_[rank];
+    if (event.getTag() != progress.round)
+    {
+        progress.early.push_back(event); // the rank is still in an earlier round
+        return;
+    }
+    deliverCollective(rank, event);
+    if (progress.awaiting > 0)
+        return;
+    ++progress.round;
+    advanceCollective(rank);
+}
 
+void EventSimulator::processSortStepEvent(const Event &event)
+{
+    if (verbose_)
+        std::cout << "\n[Event Time: " << ticksToUnits(event.getTime()) << "] " << sortAlgorithmTitle(config_.sort_algorithm)
+                  << " step " << event.getTag() << std::endl;
+    sort_algorithm_->step(*this, event);
+}
 
-    for (size_t i = 0; i < event.getData().size(); ++i)
+bool EventSimulator::collectiveResultCorrect() const
+{
+    if (!collective_ || collective_running_ > 0)
+        return false;
+    auto expected = Collectives::expectedResult(collective_->op(), collective_->root(), collective_->reduceOp(),
+                                                collective_input_);
+    if (std::is_floating_point<Key>::value && collective_->op() == Collectives::Op::ALLREDUCE &&
+        collective_->reduceOp() == Collectives::ReduceOp::SUM)
+        return floatSumsClose(expected[0][0]);
+    for (const auto &processor : processors_)
     {
-        oss << event.getData()[i];
-        if (i != event.getData().size() - 1)
-            oss << ", ";
+        if (processor.collectiveBuffer() != expected[processor.getRank()])
+            return false;
     }
+    return true;
+}
 
-    oss << "]\n";
+bool EventSimulator::floatSumsClose(const std::vector<Key> &expected) const
+{
+    // floating sums depend on the order they were added in: allow the rounding
+    // of P - 1 additions on either side, 2 eps (P - 1) sum |x| per element
+    std::vector<double> bound(expected.size(), 0.0);
+    for (const auto &blocks : collective_input_)
+    {
+        for (std::size_t i = 0; i < bound.size() && i < blocks[0].size(); ++i)
+            bound[i] += std::abs(static_cast<double>(blocks[0][i]));
+    }
+    const double eps = std::numeric_limits<Key>::epsilon() * 2 * std::max(num_processes_ - 1, 1);
+    for (const auto &processor : processors_)
+    {
+        const auto &result = processor.collectiveBuffer();
+        if (result.size() != 1 || result[0].size() != expected.size())
+            return false;
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            if (std::abs(static_cast<double>(result[0][i]) - expected[i]) > eps * bound[i])
+                return false;
+        }
+    }
+    return true;
+}
 
+std::string EventSimulator::checkpointSettings() const
+{
+    std::ostringstream oss;
+    oss << sortAlgorithmName(config_.sort_algorithm) << " sort, "
+        << (config_.event_generation == EventGeneration::LAZY ? "lazy" : "eager") << " events, "
+        << (config_.early_termination ? "early termination, " : "")
+        << (config_.matching == MatchingMode::HASHED ? "hashed" : "linear") << " matching, network "
+        << mpi_.network().describe();
     return oss.str();
 }
+
+void EventSimulator::writeCheckpoint(const std::string &path) const
+{
+    SnapshotWriter out;
+    out.putString(checkpointSettings());
+    out.put(current_time_);
+    out.put(sort_start_time_);
+    out.put(phase_offset_);
+    out.put(next_sequence_);
+    out.put(stats_);
+    out.put(input_digest_);
+    mpi_.saveNetwork(out);
+    for (const auto &processor : processors_)
+        processor.save(out);
+    out.put<std::uint64_t>(event_queue_->size());
+    event_queue_->forEach([&out](const Event &event) { out.putEvent(event); });
+    out.write(path, num_processes_, elements_per_processor_);
+}
+
+void EventSimulator::restoreCheckpoint(const std::string &path)
+{
+    SnapshotReader in(path, payload_pool_);
+    const SnapshotHeader &header = in.header();
+    if (header.num_processes != num_processes_ || header.elements_per_processor != elements_per_processor_)
+        throw std::runtime_error("Checkpoint " + path + " is of " + std::to_string(header.num_processes) +
+                                 " processors with " + std::to_string(header.elements_per_processor) +
+                                 " elements each, not " + std::to_string(num_processes_) + " with " +
+                                 std::to_string(elements_per_processor_));
+    std::string settings = in.getString();
+    if (settings != checkpointSettings())
+        throw std::runtime_error("Checkpoint " + path + " was written with " + settings + ", not " +
+                                 checkpointSettings());
+
+    current_time_ = in.get<SimTick>();
+    sort_start_time_ = in.get<SimTick>();
+    phase_offset_ = in.get<SimTick>();
+    next_sequence_ = in.get<std::uint64_t>();
+    stats_ = in.get<EngineStats>();
+    input_digest_ = in.get<std::uint64_t>();
+    mpi_.loadNetwork(in);
+    for (auto &processor : processors_)
+        processor.load(in);
+    event_queue_->clear();
+    for (std::size_t events = in.get<std::uint64_t>(); events > 0; --events)
+        event_queue_->push(in.getEvent());
+    if (!in.stateConsumed())
+        throw std::runtime_error("Checkpoint " + path + " holds more state than this build reads");
+    resumed_ = true;
+}
+
+std::uint64_t EventSimulator::dataDigest() const
+{
+    // a sum of mixed elements (splitmix64), the same in any order
+    std::uint64_t digest = 0;
+    for (const auto &processor : processors_)
+    {
+        for (Key value : processor.getData())
+        {
+            std::uint64_t x = 0;
+            std::memcpy(&x, &value, sizeof(value));
+            x += 0x9E3779B97F4A7C15ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            digest += x ^ (x >> 31);
+        }
+    }
+    return digest;
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "sort_algorithm.hpp"
+#include "event_simulator.hpp"
+#include "processor.hpp"
+
+HyperQuickSort::HyperQuickSort(int num_processes) : SortAlgorithm(num_processes), dimensions_(0)
+{
+    while ((1 << dimensions_) < num_processes)
+        ++dimensions_;
+    if ((1 << dimensions_) != num_processes)
+        throw std::runtime_error("Hyperquicksort needs a power-of-two number of processors");
+}
+
+void HyperQuickSort::start(EventSimulator &simulator, SimTick time)
+{
+    dimension_ = dimensions_ - 1;
+    scheduleStep(simulator, time + SimTime::LOCAL_SORT_TIME, LOCAL_SORT);
+}
+
+void HyperQuickSort::broadcastPivots(EventSimulator &simulator, SimTick time)
+{
+    // the first rank of every subcube of 2^(dimension + 1) ranks offers its median
+    const int subcube = 2 << dimension_;
+    for (int rank = 0; rank < num_processes_; ++rank)
+    {
+        Processor *processor = simulator.findProcessor(rank);
+        processor->collectiveBuffer().clear();
+        if (rank % subcube == 0)
+        {
+            DataView data = processor->getData();
+            processor->collectiveBuffer().push_back({data.empty() ? Key{} : data[data.size() / 2]});
+        }
+    }
+    simulator.startCollective(simulator.getMPI().bcast(0, Collectives::Algorithm::AUTO, subcube), time,
+                              [this, &simulator](SimTick done) { scheduleStep(simulator, done, EXCHANGE); });
+}
+
+void HyperQuickSort::step(EventSimulator &simulator, const Event &event)
+{
+    const SimTick now = event.getTime();
+
+    switch (event.getTag())
+    {
+    case LOCAL_SORT:
+        for (int rank = 0; rank < num_processes_; ++rank)
+            simulator.findProcessor(rank)->sortLocalData();
+        if (dimensions_ > 0)
+            broadcastPivots(simulator, now);
+        break;
+
+    case EXCHANGE:
+        // partners differ in bit `dimension`: the lower one keeps keys <= pivot, the upper one the rest
+        for (int rank = 0; rank < num_processes_; ++rank)
+        {
+            Processor *processor = simulator.findProcessor(rank);
+            Key pivot = processor->collectiveBuffer()[0][0];
+            DataView data = processor->getData();
+            const Key *cut = std::upper_bound(data.begin(), data.end(), pivot);
+            processor->collectiveBuffer() = {std::vector<Key>(data.begin(), cut), std::vector<Key>(cut, data.end())};
+        }
+        simulator.startCollective(simulator.getMPI().alltoall(Collectives::Algorithm::AUTO, 2, 1 << dimension_),
+                                  now, [this, &simulator](SimTick done)
+                                  { scheduleStep(simulator, done + SimTime::COMPARE_SPLIT_TIME, MERGE); });
+        break;
+
+    case MERGE:
+        for (int rank = 0; rank < num_processes_; ++rank)
+        {
+            Processor *processor = simulator.findProcessor(rank);
+            processor->setData(mergeRuns(processor->collectiveBuffer()), true);
+            processor->collectiveBuffer().clear();
+        }
+        if (dimension_-- > 0)
+            broadcastPivots(simulator, now);
+        break;
+    }
+}
@@ -0,0 +1,89 @@
+#include "instrumentation.hpp"
+
+#if defined(SIM_INSTRUMENT)
+
+#include <chrono>
+
+namespace
+{
+    std::int64_t nowNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+}
+
+std::uint64_t LatencyHistogram::bucketHigh(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return static_cast<std::uint64_t>(bucket);
+    int shift = bucket / SUB_BUCKETS - 1;
+    std::uint64_t low = static_cast<std::uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return low + ((std::uint64_t(1) << shift) - 1);
+}
+
+std::uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (count_ == 0)
+        return 0;
+    // the smallest bucket with at least p% of the values at or below it
+    auto rank = static_cast<std::uint64_t>(p / 100.0 * count_ + 0.5);
+    rank = rank < 1 ? 1 : rank;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        seen += counts_[i];
+        if (seen >= rank)
+            return bucketHigh(i) < max_ ? bucketHigh(i) : max_;
+    }
+    return max_;
+}
+
+const char *Instrumentation::kernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::LOCAL_SORT:
+        return "local sort";
+    case Kernel::MERGE:
+        return "merge";
+    }
+    return "unknown";
+}
+
+void Instrumentation::reset()
+{
+    *this = Instrumentation();
+    start_ns_ = nowNanoseconds();
+    start_cycles_ = cycleCount();
+}
+
+void Instrumentation::stop()
+{
+    stop_ns_ = nowNanoseconds();
+    stop_cycles_ = cycleCount();
+}
+
+double Instrumentation::cyclesPerNanosecond() const
+{
+    if (stop_ns_ <= start_ns_ || stop_cycles_ <= start_cycles_)
+        return 1.0;
+    return static_cast<double>(stop_cycles_ - start_cycles_) / static_cast<double>(stop_ns_ - start_ns_);
+}
+
+void Instrumentation::sampleDepth(std::size_t depth, SimTick time)
+{
+    if (depth_samples_.size() == MAX_DEPTH_SAMPLES)
+    {
+        // keep every other sample and sample half as often from now on
+        for (std::size_t i = 0; i < MAX_DEPTH_SAMPLES / 2; ++i)
+            depth_samples_[i] = depth_samples_[2 * i + 1];
+        depth_samples_.resize(MAX_DEPTH_SAMPLES / 2);
+        depth_stride_ *= 2;
+        if ((events_ & (depth_stride_ - 1)) != 0)
+            return;
+    }
+    depth_samples_.push_back({time, depth});
+}
+
+#endif
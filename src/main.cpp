@@ -1,16 +1,25 @@
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
 
-#include "utils.hpp"
 #include "event_simulator.hpp"
 #include "my_mpi.hpp"
+#include "sim_config.hpp"
+#include "batch_runner.hpp"
 
 // util signatures
-void printVector(const std::vector<int> &vec, const std::string &label);
-bool isSorted(const std::vector<int> &vec);
 void printProcessorState(const EventSimulator &simulator);
-std::vector<int> getSortedData(const EventSimulator &simulator);
+void printSortedData(const EventSimulator &simulator);
+void printMemoryFootprint(const EventSimulator &simulator);
+void printThreadComparison(const EventSimulator &simulator);
+void printTimeline(const Timeline &timeline);
+#if defined(SIM_INSTRUMENT)
+void printInstrumentation(const Instrumentation &instrumentation);
+#endif
+int runBatch(SimConfig config);
+int compareSortAlgorithms(EventSimulator &simulator, int num_processes, int elements_per_processor, SimConfig config);
 
 int main(int argc, char *argv[])
 {
@@ -18,107 +27,463 @@ int main(int argc, char *argv[])
     int num_processes = 10;          // Default value
     int elements_per_processor = 100; // Default value
 
-    // Parse command line arguments
-    if (argc >= 3)
+    SimConfig config;
+
+    // Parse command line arguments: positional counts first, then --name=value options
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0)
+        {
+            positional.push_back(arg);
+            continue;
+        }
+        try
+        {
+            if (!parseSimOption(arg, config))
+            {
+                std::cerr << "Error: Unknown option " << arg << std::endl;
+                std::cerr << "Options:\n" << simOptionsUsage();
+                return 1;
+            }
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!config.batch_file.empty())
+        return runBatch(config);
+
+    if (positional.size() >= 2)
     {
-        num_processes = std::atoi(argv[1]);
-        elements_per_processor = std::atoi(argv[2]);
+        num_processes = std::atoi(positional[0].c_str());
+        elements_per_processor = std::atoi(positional[1].c_str());
 
         // Validate arguments
         if (num_processes <= 0 || elements_per_processor <= 0)
         {
             std::cerr << "Error: Number of processors and elements per processor must be positive!" << std::endl;
-            std::cerr << "Usage: " << argv[0] << " <num_processors> <elements_per_processor>" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " <num_processors> <elements_per_processor> [options]" << std::endl;
             return 1;
         }
     }
-    else if (argc == 2)
+    else if (positional.size() == 1)
     {
         std::cerr << "Error: Please provide both arguments!" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <num_processors> <elements_per_processor>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <num_processors> <elements_per_processor> [options]" << std::endl;
         std::cerr << "Example: " << argv[0] << " 4 10" << std::endl;
         return 1;
     }
     else
     {
         std::cout << "Using default values:" <<num_processes<<" "<< elements_per_processor <<" (no arguments provided)" << std::endl;
-        std::cout << "Usage: " << argv[0] << " <num_processors> <elements_per_processor>" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <num_processors> <elements_per_processor> [options]" << std::endl;
+        std::cout << "Options:\n" << simOptionsUsage();
         std::cout << "Example: " << argv[0] << " 4 10" << std::endl;
         std::cout << std::endl;
     }
 
-    std::cout << "Starting Odd-Even Sort Simulation" << std::endl;
+    EventSimulator simulator;
+    if (config.compare_sorts && (!config.checkpoint_file.empty() || !config.resume_file.empty()))
+    {
+        std::cerr << "Error: --compare cannot checkpoint or resume" << std::endl;
+        return 1;
+    }
+    if (!config.resume_file.empty() && !config.input_file.empty())
+    {
+        std::cerr << "Error: --resume takes its data from the checkpoint, not --input" << std::endl;
+        return 1;
+    }
+    if (!config.output_file.empty() && config.run_collective)
+    {
+        std::cerr << "Error: --output writes sorted data, a collective has none" << std::endl;
+        return 1;
+    }
+    if (config.compare_sorts && !config.run_collective)
+        return compareSortAlgorithms(simulator, num_processes, elements_per_processor, config);
+
+    if (config.run_collective)
+        std::cout << "Starting " << Collectives::opName(config.collective) << (config.collective_varying ? "v" : "")
+                  << " Collective Simulation" << std::endl;
+    else
+        std::cout << "Starting " << sortAlgorithmTitle(config.sort_algorithm) << " Simulation" << std::endl;
     std::cout << "Number of processors: " << num_processes << std::endl;
     std::cout << "Elements per processor: " << elements_per_processor << std::endl;
     std::cout << "Total elements: " << (num_processes * elements_per_processor) << std::endl;
+    std::cout << "Keys: " << KEY_TYPE_NAME << ", " << config.network.elementBytes() << " bytes per element on the wire"
+              << std::endl;
     std::cout << std::endl;
 
     // Initialize the event simulator
-    auto &simulator = EventSimulator::getInstance();
-    simulator.init(num_processes, elements_per_processor);
+    try
+    {
+        simulator.init(num_processes, elements_per_processor, config);
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Event queue: " << simulator.getEventQueue().name() << std::endl;
+    std::cout << "Sort kernels: " << SortKernels::isaName(simulator.getKernels()) << std::endl;
+    std::cout << "Network: " << simulator.getMPI().network().describe() << std::endl;
+    printMemoryFootprint(simulator);
+    if (config.run_collective)
+    {
+        Collectives::Algorithm algorithm = config.collective_algorithm == Collectives::Algorithm::AUTO
+                                               ? Collectives::defaultAlgorithm(config.collective)
+                                               : config.collective_algorithm;
+        std::cout << "Collective algorithm: " << Collectives::algorithmName(algorithm);
+        if (config.collective == Collectives::Op::ALLREDUCE)
+            std::cout << ", " << Collectives::reduceOpName(config.collective_reduce);
+        else if (config.collective != Collectives::Op::ALLTOALL)
+            std::cout << ", root " << config.collective_root;
+        std::cout << std::endl;
+    }
 
     // Initialize random number array
-    // and partition it to the processors
-    simulator.initializeData();
+    // and partition it to the processors, read the input file, or take the
+    // state of a checkpoint
+    if (!config.input_file.empty())
+    {
+        try
+        {
+            simulator.loadDataFile(config.input_file);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Input: " << config.input_file
+                  << (simulator.getProcessorStore().inputMapped() ? " (mapped as processor data, zero-copy)"
+                                                                   : " (mapped, copied to the processors)")
+                  << std::endl;
+    }
+    else if (config.resume_file.empty())
+    {
+        simulator.initializeData();
+        std::cout << "Input: " << workloadName(config.workload) << " keys, seed " << simulator.getDataSeed()
+                  << std::endl;
+    }
+    else
+    {
+        auto restore_start = std::chrono::steady_clock::now();
+        try
+        {
+            simulator.restoreCheckpoint(config.resume_file);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::chrono::duration<double> restore = std::chrono::steady_clock::now() - restore_start;
+        std::cout << "Resumed from " << config.resume_file << " at time " << simulator.getCurrentTime() << " ("
+                  << simulator.getEngineStats().events_processed << " events done, restored in "
+                  << restore.count() * 1e3 << " ms)" << std::endl;
+    }
 
-    std::cout << "Initial state:" << std::endl;
-    printProcessorState(simulator);
-    std::cout << std::endl;
+    if (config.verbose)
+    {
+        std::cout << (config.resume_file.empty() ? "Initial state:" : "Resumed state:") << std::endl;
+        printProcessorState(simulator);
+        std::cout << std::endl;
+    }
+    // the sort must end with these elements in order: ranks ascending, and the
+    // same digest as the input (a resumed run's input is in the checkpoint)
+    std::uint64_t input_digest = config.resume_file.empty() ? simulator.dataDigest() : simulator.getInputDigest();
 
     // Measure Simulation in real-time
     auto start_time = std::chrono::high_resolution_clock::now();
 
     // Run the sort simulation
-    simulator.run();
+    try
+    {
+        simulator.run();
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
-    std::cout << "Final state:" << std::endl;
-    printProcessorState(simulator);
-    std::cout << std::endl;
-
-    // Get and verify the sorted data
-    std::vector<int> sorted_data = getSortedData(simulator);
+    if (config.verbose)
+    {
+        std::cout << "Final state:" << std::endl;
+        printProcessorState(simulator);
+        std::cout << std::endl;
+    }
 
     std::cout << "Verification:" << std::endl;
-    printVector(sorted_data, "Sorted data");
-    std::cout << "Is correctly sorted: " << (isSorted(sorted_data) ? "Yes" : "No") << std::endl;
-    std::cout << "Sorting time: " << duration.count() << " microseconds" << "\t"<<duration.count() / 1e+6 << " seconds" << std::endl;
+    if (config.run_collective)
+    {
+        // every rank's result against the one computed directly from the inputs
+        const Collectives::Stats &collective = simulator.getCollectiveStats();
+        std::cout << "Collective result correct: " << (simulator.collectiveResultCorrect() ? "Yes" : "No") << std::endl;
+        std::cout << "Run time: " << duration.count() << " microseconds" << "\t" << duration.count() / 1e+6 << " seconds" << std::endl;
+        std::cout << "Collective time: " << ticksToUnits(collective.duration()) << " units, " << collective.rounds
+                  << " rounds, " << collective.messages << " messages, " << collective.bytes() << " bytes" << std::endl;
+    }
+    else
+    {
+        // verify the sorted data rank by rank, the global array is never built
+        if (config.verbose)
+            printSortedData(simulator);
+        bool correct = simulator.sortedAcrossRanks() && simulator.dataDigest() == input_digest;
+        std::cout << "Is correctly sorted: " << (correct ? "Yes" : "No") << std::endl;
+        if (!config.output_file.empty())
+        {
+            try
+            {
+                simulator.writeDataFile(config.output_file);
+            }
+            catch (const std::runtime_error &e)
+            {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            std::cout << "Sorted data written to: " << config.output_file << std::endl;
+        }
+        std::cout << "Sorting time: " << duration.count() << " microseconds" << "\t"<<duration.count() / 1e+6 << " seconds" << std::endl;
+    }
     std::cout << "Simulation time: " << simulator.getCurrentTime() << " units" << std::endl;
+    const EngineStats &engine = simulator.getEngineStats();
+    if (!config.run_collective && simulator.getSortAlgorithm().comparesSplits())
+        std::cout << "Phases executed: " << engine.phases_executed << " of " << simulator.getSortAlgorithm().phases()
+                  << (config.early_termination ? " (early termination)" : "") << std::endl;
+    std::cout << "Messages: " << engine.traffic.messages << " (" << engine.traffic.bytes << " bytes)" << std::endl;
+    const NetworkModel &network = simulator.getMPI().network();
+    if (!network.contentionFree())
+        std::cout << "Link contention: " << network.delayedMessages() << " messages waited "
+                  << ticksToUnits(network.contentionDelay()) << " units in total" << std::endl;
+    MatchingEngine::Stats matching;
+    for (const Processor &processor : simulator.getProcessors())
+        matching += processor.mailbox().stats();
+    if (matching.receives > 0)
+        std::cout << "Matching (" << (config.matching == MatchingMode::HASHED ? "hashed" : "linear")
+                  << "): " << matching.receives << " receives, " << matching.unexpected << " unexpected messages"
+                  << " (queues up to " << matching.max_posted << " posted / " << matching.max_unexpected
+                  << " unexpected), " << matching.probesPerLookup() << " probes per lookup" << std::endl;
+    std::cout << "Events processed: " << engine.events_processed << std::endl;
+    if (!config.checkpoint_file.empty())
+        std::cout << "Checkpoints: " << simulator.getCheckpointsWritten() << " written to " << config.checkpoint_file
+                  << " (every " << config.checkpoint_interval << " units)" << std::endl;
+    std::cout << "Event queue high-water mark: " << engine.queue_high_water << " events" << std::endl;
+    if (config.engine == EngineType::CONSERVATIVE)
+        std::cout << "Conservative engine: " << engine.windows << " windows, "
+                  << engine.remote_events << " cross-partition events" << std::endl;
+    if (config.engine == EngineType::TIME_WARP)
+        std::cout << "Time Warp engine: " << engine.events_executed << " events executed, "
+                  << engine.rollbacks << " rollbacks (" << engine.rolled_back_events << " events undone), "
+                  << engine.anti_messages << " anti-messages, " << engine.gvt_rounds << " GVT rounds, "
+                  << "efficiency " << std::fixed << std::setprecision(3) << engine.efficiency() << ", "
+                  << engine.peak_saved_state_bytes << " bytes peak saved state" << std::endl;
+    if (config.engine == EngineType::THREADS)
+        printThreadComparison(simulator);
+    if (simulator.getTimeline())
+        printTimeline(*simulator.getTimeline());
+#if defined(SIM_INSTRUMENT)
+    printInstrumentation(simulator.getInstrumentation());
+#endif
+
+    PoolStats pool = simulator.getPayloadPool().stats();
+    std::cout << "Payload pool: " << pool.bytes_allocated << " bytes allocated, "
+              << pool.peak_bytes_in_use << " bytes peak in use, "
+              << pool.acquires << " buffers, reuse rate " << std::fixed << std::setprecision(1)
+              << pool.reuseRate() * 100.0 << "%" << std::endl;
 
     return 0;
 }
 
-// UTIL FUNCTIONS
-void printVector(const std::vector<int> &vec, const std::string &label)
+// --batch: the file's simulations side by side, one table row each
+int runBatch(SimConfig config)
 {
-    std::cout << label << ": ";
-    for (int val : vec)
+    std::string path = config.batch_file;
+    config.batch_file.clear();
+    config.verbose = false;
+    config.trace_file.clear();
+
+    std::vector<BatchJob> jobs;
+    try
     {
-        std::cout << std::setw(4) << val << " ";
+        jobs = readBatchFile(path, config);
     }
-    std::cout << std::endl;
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    BatchRunner runner(config.jobs);
+    std::cout << "Batch " << path << ": " << jobs.size() << " simulations on " << runner.workers() << " workers"
+              << std::endl;
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runner.run(jobs);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::cout << std::setw(5) << "#" << std::setw(8) << "Procs" << std::setw(10) << "Elements" << "  " << std::left
+              << std::setw(36) << "Options" << std::right << std::setw(9) << "Correct" << std::setw(14) << "Sim time"
+              << std::setw(12) << "Events" << std::setw(12) << "Wall ms" << std::endl;
+    int failed = 0;
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+    {
+        const BatchJob &job = jobs[i];
+        const BatchResult &result = results[i];
+        std::cout << std::setw(5) << i + 1 << std::setw(8) << job.num_processes << std::setw(10)
+                  << job.elements_per_processor << "  " << std::left << std::setw(36)
+                  << (job.options.empty() ? "-" : job.options) << std::right;
+        if (!result.completed)
+        {
+            ++failed;
+            std::cout << "  error: " << result.error << std::endl;
+            continue;
+        }
+        failed += !result.correct;
+        std::cout << std::setw(9) << (result.correct ? "yes" : "NO") << std::setw(14) << result.sim_time
+                  << std::setw(12) << result.events << std::setw(12) << std::fixed << std::setprecision(2)
+                  << result.wall * 1e3 << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    std::cout << jobs.size() << " simulations in " << std::fixed << std::setprecision(3) << wall << " s ("
+              << std::setprecision(1) << (wall > 0 ? jobs.size() / wall : 0.0) << " per second), " << failed
+              << " failed" << std::endl;
+    return failed == 0 ? 0 : 1;
 }
 
-bool isSorted(const std::vector<int> &vec)
+// --compare: every sort algorithm on the same input, one table row each
+int compareSortAlgorithms(EventSimulator &simulator, int num_processes, int elements_per_processor, SimConfig config)
 {
-    for (size_t i = 1; i < vec.size(); ++i)
+    config.verbose = false;
+    config.trace_file.clear();
+    config.timeline_file.clear();
+    if (!config.workload.seeded)
     {
-        if (vec[i] < vec[i - 1])
-            return false;
+        std::random_device rd;
+        config.workload.seed = static_cast<std::uint64_t>(rd()) << 32 | rd();
+        config.workload.seeded = true;
     }
-    return true;
+
+    std::cout << "Comparing sort algorithms: " << num_processes << " processors x " << elements_per_processor
+              << " elements";
+    if (config.input_file.empty())
+        std::cout << ", " << workloadName(config.workload) << " keys, seed " << config.workload.seed;
+    std::cout << std::endl;
+    // every algorithm pays only for its messages and local work; the fixed
+    // phase slot of the compare-split sorts (--phase-delay) is a column of its own
+    const double phase_delay = config.phase_delay;
+    if (phase_delay > 0)
+        std::cout << "Sim time: messages and local work, no fixed phase slot; Slot wait: what the " << phase_delay
+                  << "-unit phase slot (--phase-delay) adds to it" << std::endl;
+    std::cout << std::left << std::setw(16) << "Algorithm" << std::right << std::setw(8) << "Sorted" << std::setw(14)
+              << "Sim time" << std::setw(12) << "Slot wait" << std::setw(12) << "Messages" << std::setw(14) << "Bytes"
+              << std::setw(12) << "Events" << std::setw(10) << "Max load" << std::setw(12) << "Wall ms" << std::endl;
+
+    // an input file is read again for every run, random input is drawn once and kept
+    std::vector<std::vector<Key>> input;
+    std::uint64_t input_digest = 0;
+    bool drawn = false;
+    auto load = [&]() {
+        if (!config.input_file.empty())
+            simulator.loadDataFile(config.input_file);
+        else if (!drawn)
+        {
+            // the first algorithm that runs draws the input, the others get a copy
+            simulator.initializeData();
+            for (const auto &processor : simulator.getProcessors())
+                input.emplace_back(processor.getData().begin(), processor.getData().end());
+            drawn = true;
+        }
+        else
+            simulator.loadData(input);
+        input_digest = simulator.dataDigest();
+    };
+    for (SortAlgorithmType type : {SortAlgorithmType::ODD_EVEN, SortAlgorithmType::BITONIC, SortAlgorithmType::SAMPLE,
+                                   SortAlgorithmType::HYPERQUICK})
+    {
+        config.sort_algorithm = type;
+        config.phase_delay = 0;
+        std::cout << std::left << std::setw(16) << sortAlgorithmTitle(type) << std::right;
+        try
+        {
+            simulator.init(num_processes, elements_per_processor, config);
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cout << "  n/a: " << e.what() << std::endl;
+            continue;
+        }
+
+        // compare-split sorts run once more with the slot, the difference is its cost
+        std::string slot_wait = "-";
+        std::chrono::high_resolution_clock::time_point start_time, end_time;
+        try
+        {
+            if (simulator.getSortAlgorithm().comparesSplits() && phase_delay > 0)
+            {
+                SimConfig slotted = config;
+                slotted.phase_delay = phase_delay;
+                simulator.init(num_processes, elements_per_processor, slotted);
+                load();
+                simulator.run();
+                SimTick with_slot = toTicks(simulator.getCurrentTime());
+                simulator.init(num_processes, elements_per_processor, config);
+                load();
+                start_time = std::chrono::high_resolution_clock::now();
+                simulator.run();
+                end_time = std::chrono::high_resolution_clock::now();
+                std::ostringstream wait;
+                wait << ticksToUnits(with_slot - toTicks(simulator.getCurrentTime()));
+                slot_wait = wait.str();
+            }
+            else
+            {
+                load();
+                start_time = std::chrono::high_resolution_clock::now();
+                simulator.run();
+                end_time = std::chrono::high_resolution_clock::now();
+            }
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cout << std::endl;
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+
+        // sample sort and hyperquicksort leave ranks with different amounts of data
+        std::size_t max_load = 0;
+        for (const auto &processor : simulator.getProcessors())
+            max_load = std::max(max_load, processor.getData().size());
+        const EngineStats &engine = simulator.getEngineStats();
+        std::cout << std::setw(8) << (simulator.sortedAcrossRanks() && simulator.dataDigest() == input_digest ? "yes" : "NO") << std::setw(14)
+                  << simulator.getCurrentTime() << std::setw(12) << slot_wait << std::setw(12) << engine.traffic.messages << std::setw(14)
+                  << engine.traffic.bytes << std::setw(12) << engine.events_processed << std::setw(10) << max_load
+                  << std::setw(12) << std::fixed << std::setprecision(2)
+                  << std::chrono::duration<double, std::milli>(end_time - start_time).count() << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    return 0;
 }
 
+// UTIL FUNCTIONS
 void printProcessorState(const EventSimulator &simulator)
 {
     const auto &processors = simulator.getProcessors();
     for (const auto &processor : processors)
     {
-        std::cout << "Processor " << processor->getRank() << ": ";
-        const auto &data = processor->getData();
-        for (int val : data)
+        std::cout << "Processor " << processor.getRank() << ": ";
+        const auto &data = processor.getData();
+        for (Key val : data)
         {
             std::cout << val << " ";
         }
@@ -126,14 +491,225 @@ void printProcessorState(const EventSimulator &simulator)
     }
 }
 
-std::vector<int> getSortedData(const EventSimulator &simulator)
+// the ranks' data one after another, streamed rank by rank
+void printSortedData(const EventSimulator &simulator)
 {
-    std::vector<int> result;
-    const auto &processors = simulator.getProcessors();
-    for (const auto &processor : processors)
+    std::cout << "Sorted data: ";
+    for (const auto &processor : simulator.getProcessors())
+    {
+        for (Key val : processor.getData())
+        {
+            std::cout << std::setw(4) << val << " ";
+        }
+    }
+    std::cout << std::endl;
+}
+
+void printMemoryFootprint(const EventSimulator &simulator)
+{
+    const ProcessorStore &store = simulator.getProcessorStore();
+    std::size_t views = simulator.getProcessors().capacity() * sizeof(Processor);
+    std::cout << "Processor memory: " << std::fixed << std::setprecision(2)
+              << store.arenaBytes() / 1048576.0 << " MiB arena (2 planes x " << store.ranks() << " ranks x "
+              << store.strideBytes() << " bytes" << (store.hugePages() ? ", huge pages" : "") << "), "
+              << views / 1024.0 << " KiB processor views, "
+              << (store.arenaBytes() + views) / 1048576.0 << " MiB total" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+// --engine=threads: the discrete-event prediction of every phase next to its
+// wall-clock time on real threads, and the SimTime constants the timings imply
+void printThreadComparison(const EventSimulator &simulator)
+{
+    const ThreadRunStats &threads = simulator.getThreadStats();
+    const std::vector<SimulatedPhase> &simulated = simulator.getSimulatedPhases();
+    std::cout << "Real threads: " << threads.workers << " workers for " << simulator.getNumProcesses() << " ranks, "
+              << threads.messages << " messages, " << std::fixed << std::setprecision(3) << threads.wall * 1e3
+              << " ms wall (" << threads.local_sort * 1e3 << " ms local sorts), " << threads.full_mailboxes
+              << " sends retried on a full mailbox" << std::endl;
+
+    // a simulated phase lasts from the end of the one before (the start of the
+    // first) to the end of its last compare-split; a measured one is the mean
+    // of its ranks' own steps, which leaves their local sorts out
+    struct Row
+    {
+        std::size_t phase;
+        double simulated_end, simulated, measured_end, measured, exchange, merge; // units, us
+    };
+    std::vector<Row> rows;
+    for (std::size_t i = 0; i < threads.phases.size(); ++i)
     {
-        const auto &data = processor->getData();
-        result.insert(result.end(), data.begin(), data.end());
+        const MeasuredPhase &measured = threads.phases[i];
+        if (measured.ranks == 0)
+            continue;
+        double simulated_end = ticksToUnits(simulated[i].finish);
+        double simulated_begin = rows.empty() ? ticksToUnits(simulated[i].start) : rows.back().simulated_end;
+        rows.push_back({i, simulated_end, simulated_end - simulated_begin, measured.finish * 1e6,
+                        measured.step * 1e6 / measured.ranks, measured.exchange * 1e6 / measured.ranks,
+                        measured.merge * 1e6 / measured.ranks});
     }
-    return result;
-}
\ No newline at end of file
+    if (rows.empty())
+        return;
+
+    // at most 16 rows, evenly spread
+    std::size_t stride = (rows.size() + 15) / 16;
+    std::cout << std::setw(7) << "Phase" << std::setw(12) << "Sim end" << std::setw(11) << "Sim phase"
+              << std::setw(13) << "Wall end us" << std::setw(13) << "Wall phase" << std::setw(10) << "us/unit"
+              << std::setw(13) << "Exchange us" << std::setw(10) << "Merge us"
+              << "   (wall phase, exchange, merge: mean per rank)"
+              << std::endl;
+    for (std::size_t r = 0; r < rows.size(); r += stride)
+    {
+        const Row &row = rows[r];
+        std::cout << std::setw(7) << row.phase << std::setprecision(1) << std::setw(12) << row.simulated_end
+                  << std::setw(11) << row.simulated << std::setw(13) << row.measured_end << std::setw(13)
+                  << row.measured << std::setprecision(3) << std::setw(10)
+                  << (row.simulated > 0 ? row.measured / row.simulated : 0.0) << std::setprecision(1) << std::setw(13)
+                  << row.exchange << std::setw(10) << row.merge << std::endl;
+    }
+    if (stride > 1)
+        std::cout << "(every " << stride << ". of " << rows.size() << " phases)" << std::endl;
+
+    double simulated_phase = 0.0, measured_phase = 0.0, exchange = 0.0, merge = 0.0;
+    for (const Row &row : rows)
+    {
+        simulated_phase += row.simulated / rows.size();
+        measured_phase += row.measured / rows.size();
+        exchange += row.exchange / rows.size();
+        merge += row.merge / rows.size();
+    }
+    double message = ticksToUnits(simulator.getMPI().network().latency(simulator.getProcessors()[0].getData().size()));
+    std::cout << std::setprecision(2) << "Mean phase: simulated " << simulated_phase << " units, measured "
+              << measured_phase << " us";
+    if (simulated_phase > 0)
+        std::cout << " (1 unit = " << std::setprecision(3) << measured_phase / simulated_phase << " us)";
+    std::cout << std::endl;
+    std::cout << std::setprecision(2) << "Per rank and phase: message " << message << " units simulated, exchange "
+              << exchange << " us measured (waiting included); compare-split "
+              << ticksToUnits(SimTime::COMPARE_SPLIT_TIME) << " units simulated, " << merge << " us measured"
+              << std::endl;
+    // scaled so the message cost stays what the network model makes it
+    if (exchange > 0)
+        std::cout << "Calibrated to the message cost: COMPARE_SPLIT_TIME = " << merge * message / exchange
+                  << " units (now " << ticksToUnits(SimTime::COMPARE_SPLIT_TIME) << "), PHASE_DELAY = "
+                  << measured_phase * message / exchange << " units (now " << simulator.getConfig().phase_delay
+                  << ", --phase-delay)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+// --timeline: where the ranks' simulated time went, the least used phases and
+// what the critical path consists of
+void printTimeline(const Timeline &timeline)
+{
+    SimTick span = timeline.finishTime() - timeline.startTime();
+    double capacity = static_cast<double>(span) * timeline.ranks() / 100.0;
+    if (capacity <= 0)
+        return;
+    std::cout << std::fixed << std::setprecision(1) << "Rank time (" << timeline.ranks() << " ranks x "
+              << ticksToUnits(span) << " units):";
+    for (Timeline::SpanKind kind : {Timeline::SpanKind::SEND, Timeline::SpanKind::RECV_WAIT,
+                                    Timeline::SpanKind::COMPARE_SPLIT, Timeline::SpanKind::ALLREDUCE,
+                                    Timeline::SpanKind::IDLE})
+    {
+        if (timeline.total(kind) > 0 || kind != Timeline::SpanKind::ALLREDUCE)
+            std::cout << " " << Timeline::spanKindName(kind) << " " << timeline.total(kind) / capacity << "%";
+    }
+    std::cout << std::endl;
+
+    // busy share of all ranks over each phase's span; the worst phases first
+    std::vector<std::pair<double, std::size_t>> use;
+    double mean = 0.0;
+    for (std::size_t i = 0; i < timeline.phases().size(); ++i)
+    {
+        const Timeline::PhaseUse &phase = timeline.phases()[i];
+        if (phase.span() <= 0)
+            continue;
+        use.push_back({phase.busy / (static_cast<double>(phase.span()) * timeline.ranks() / 100.0), i});
+        mean += use.back().first;
+    }
+    if (!use.empty())
+    {
+        std::sort(use.begin(), use.end());
+        std::cout << "Phase utilization: mean " << mean / use.size() << "%, lowest";
+        for (std::size_t i = 0; i < std::min<std::size_t>(use.size(), 3); ++i)
+            std::cout << (i == 0 ? " " : ", ") << use[i].first << "% (phase " << use[i].second << ")";
+        std::cout << ", highest " << use.back().first << "% (phase " << use.back().second << ")" << std::endl;
+    }
+
+    const Timeline::CriticalPath &path = timeline.criticalPath();
+    std::cout << "Critical path: " << ticksToUnits(path.length) << " units over " << path.events << " events, "
+              << path.rank_changes << " messages between ranks;";
+    for (int kind = 0; kind < Timeline::PATH_KINDS; ++kind)
+    {
+        if (path.by_kind[kind] > 0)
+            std::cout << " " << Timeline::pathKindName(static_cast<Timeline::PathKind>(kind)) << " "
+                      << (path.length > 0 ? path.by_kind[kind] * 100.0 / path.length : 0.0) << "%";
+    }
+    std::cout << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+#if defined(SIM_INSTRUMENT)
+// cmake -DSIM_INSTRUMENT=ON: handler and kernel latencies, copies and buffers
+// by event type, and the event queue's depth over the run
+void printInstrumentation(const Instrumentation &instrumentation)
+{
+    double per_ns = instrumentation.cyclesPerNanosecond();
+    auto ns = [per_ns](double cycles) { return cycles / per_ns; };
+    auto row = [&](const std::string &name, std::uint64_t calls, const LatencyHistogram &latency) {
+        std::cout << std::setw(15) << name << std::setw(11) << calls;
+        if (latency.count() == 0) // fewer calls than the sampling period
+        {
+            std::cout << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-"
+                      << std::setw(11) << "-";
+            return;
+        }
+        std::cout << std::setw(10) << ns(latency.mean()) << std::setw(10) << ns(latency.percentile(50))
+                  << std::setw(10) << ns(latency.percentile(90)) << std::setw(10) << ns(latency.percentile(99))
+                  << std::setw(11) << ns(latency.max());
+    };
+
+    std::cout << std::fixed << std::setprecision(1) << "Instrumentation (" << instrumentation.events()
+              << " events, " << per_ns << " cycles per ns, latency of 1 in "
+              << Instrumentation::SAMPLE_PERIOD << " calls timed):" << std::endl;
+    std::cout << std::setw(15) << "Handler" << std::setw(11) << "Calls" << std::setw(10) << "Mean ns"
+              << std::setw(10) << "p50 ns" << std::setw(10) << "p90 ns" << std::setw(10) << "p99 ns" << std::setw(11)
+              << "Max ns" << std::setw(15) << "Bytes copied" << std::setw(10) << "Buffers" << std::setw(8) << "Slabs"
+              << std::setw(12) << "Buf/event" << std::endl;
+    for (int type = 0; type <= EVENT_TYPE_COUNT; ++type)
+    {
+        const Instrumentation::TypeStats &stats = instrumentation.typeStats(type);
+        if (stats.events == 0 && stats.buffers == 0)
+            continue;
+        row(type < EVENT_TYPE_COUNT ? eventTypeName(static_cast<EventType>(type)) : "(no event)", stats.events,
+            stats.latency);
+        std::cout << std::setw(15) << stats.bytes_copied << std::setw(10) << stats.buffers << std::setw(8)
+                  << stats.slabs << std::setw(12)
+                  << (stats.events > 0 ? static_cast<double>(stats.buffers) / stats.events : 0.0) << std::endl;
+    }
+    for (Instrumentation::Kernel kernel : {Instrumentation::Kernel::LOCAL_SORT, Instrumentation::Kernel::MERGE})
+    {
+        if (instrumentation.kernelCalls(kernel) == 0)
+            continue;
+        row(Instrumentation::kernelName(kernel), instrumentation.kernelCalls(kernel), instrumentation.kernel(kernel));
+        std::cout << std::endl;
+    }
+
+    // at most 8 of the samples, evenly spread
+    const std::vector<Instrumentation::DepthSample> &samples = instrumentation.depthSamples();
+    std::cout << "Queue depth: mean " << instrumentation.meanDepth() << ", max " << instrumentation.maxDepth();
+    if (!samples.empty())
+    {
+        std::cout << "; at time";
+        std::size_t stride = (samples.size() + 7) / 8;
+        for (std::size_t i = 0; i < samples.size(); i += stride)
+            std::cout << " " << ticksToUnits(samples[i].time) << ": " << samples[i].depth;
+    }
+    std::cout << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+#endif
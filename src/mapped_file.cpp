@@ -0,0 +1,41 @@
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+MappedFile::MappedFile(const std::string &path) : path_(path)
+{
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        throw std::runtime_error("Cannot open " + path);
+    struct stat status;
+    if (fstat(fd_, &status) != 0)
+    {
+        close(fd_);
+        throw std::runtime_error("Cannot read the size of " + path);
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+    if (size_ == 0)
+        return;
+    void *memory = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (memory == MAP_FAILED)
+    {
+        close(fd_);
+        throw std::runtime_error("Cannot map " + path);
+    }
+    data_ = static_cast<const char *>(memory);
+#ifdef MADV_SEQUENTIAL
+    madvise(memory, size_, MADV_SEQUENTIAL); // read ahead, drop pages behind
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        munmap(const_cast<char *>(data_), size_);
+    close(fd_);
+}
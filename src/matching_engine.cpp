@@ -0,0 +1,590 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "matching_engine.hpp"
+#include "snapshot.hpp"
+
+MatchingEngine::Stats &MatchingEngine::Stats::operator+=(const Stats &other)
+{
+    receives += other.receives;
+    arrivals += other.arrivals;
+    unexpected += other.unexpected;
+    probes += other.probes;
+    max_posted = std::max(max_posted, other.max_posted);
+    max_unexpected = std::max(max_unexpected, other.max_unexpected);
+    return *this;
+}
+
+// ------------------------------------------------------------- intrusive fifos
+
+template <class T>
+void MatchingEngine::pushBack(std::vector<T> &slots, Fifo &fifo, int index, int link)
+{
+    Link &entry = slots[index].links[link];
+    entry.prev = fifo.tail;
+    entry.next = -1;
+    if (fifo.tail >= 0)
+        slots[fifo.tail].links[link].next = index;
+    else
+        fifo.head = index;
+    fifo.tail = index;
+    ++fifo.size;
+}
+
+template <class T>
+void MatchingEngine::unlink(std::vector<T> &slots, Fifo &fifo, int index, int link)
+{
+    Link &entry = slots[index].links[link];
+    if (entry.prev >= 0)
+        slots[entry.prev].links[link].next = entry.next;
+    else
+        fifo.head = entry.next;
+    if (entry.next >= 0)
+        slots[entry.next].links[link].prev = entry.prev;
+    else
+        fifo.tail = entry.prev;
+    entry = Link();
+    --fifo.size;
+}
+
+template <class T>
+void MatchingEngine::unlinkBucket(std::vector<T> &slots, Buckets &buckets, std::uint64_t key, int index, int link)
+{
+    Fifo *bucket = buckets.find(key);
+    unlink(slots, *bucket, index, link);
+    if (bucket->size == 0)
+        buckets.erase(key); // tags are often used once: keep only the buckets of queued entries
+}
+
+// ------------------------------------------------------------------- buckets
+
+std::size_t MatchingEngine::Buckets::position(std::uint64_t key) const
+{
+    std::size_t mask = entries_.size() - 1;
+    std::size_t i = home(key);
+    while (entries_[i].used && entries_[i].key != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+MatchingEngine::Fifo *MatchingEngine::Buckets::find(std::uint64_t key)
+{
+    if (size_ == 0)
+        return nullptr;
+    Entry &entry = entries_[position(key)];
+    return entry.used ? &entry.fifo : nullptr;
+}
+
+MatchingEngine::Fifo &MatchingEngine::Buckets::operator[](std::uint64_t key)
+{
+    if (2 * (size_ + 1) > entries_.size())
+        grow();
+    Entry &entry = entries_[position(key)];
+    if (!entry.used)
+    {
+        entry.used = true;
+        entry.key = key;
+        entry.fifo = Fifo();
+        ++size_;
+    }
+    return entry.fifo;
+}
+
+void MatchingEngine::Buckets::erase(std::uint64_t key)
+{
+    std::size_t mask = entries_.size() - 1;
+    std::size_t hole = position(key);
+    entries_[hole].used = false;
+    --size_;
+    // backward shift: move later entries of the probe run into the hole unless
+    // that would put them before their home position
+    for (std::size_t i = (hole + 1) & mask; entries_[i].used; i = (i + 1) & mask)
+    {
+        std::size_t from_home = (i - home(entries_[i].key)) & mask;
+        if (from_home >= ((i - hole) & mask))
+        {
+            entries_[hole] = entries_[i];
+            entries_[i].used = false;
+            hole = i;
+        }
+    }
+}
+
+void MatchingEngine::Buckets::grow()
+{
+    std::vector<Entry> old = std::move(entries_);
+    entries_.assign(old.empty() ? 8 : 2 * old.size(), Entry());
+    shift_ = 64;
+    for (std::size_t n = entries_.size(); n > 1; n >>= 1)
+        --shift_;
+    for (const Entry &entry : old)
+    {
+        if (entry.used)
+            entries_[position(entry.key)] = entry;
+    }
+}
+
+void MatchingEngine::Buckets::save(SnapshotWriter &out) const
+{
+    out.putVector(entries_);
+    out.put<std::uint64_t>(size_);
+    out.put<std::int32_t>(shift_);
+}
+
+void MatchingEngine::Buckets::load(SnapshotReader &in)
+{
+    in.getVector(entries_);
+    size_ = in.get<std::uint64_t>();
+    shift_ = in.get<std::int32_t>();
+}
+
+// ------------------------------------------------------------------ requests
+
+MatchingEngine::Slot &MatchingEngine::slot(Request request)
+{
+    if (request < 0 || static_cast<std::size_t>(request) >= slots_.size() || !slots_[request].used)
+        throw std::runtime_error("Invalid request handle " + std::to_string(request));
+    return slots_[request];
+}
+
+Request MatchingEngine::newSlot()
+{
+    Request request = free_slot_;
+    if (request >= 0)
+        free_slot_ = slots_[request].links[POSTED].next;
+    else
+    {
+        request = static_cast<Request>(slots_.size());
+        slots_.emplace_back();
+    }
+    // a freed slot holds no message, everything else starts over
+    Slot &fresh = slots_[request];
+    fresh.links[POSTED] = Link();
+    fresh.used = true;
+    fresh.receive = false;
+    fresh.complete = false;
+    fresh.source = ANY_SOURCE;
+    fresh.tag = ANY_TAG;
+    fresh.order = 0;
+    fresh.ready = 0;
+    fresh.group = -1;
+    return request;
+}
+
+void MatchingEngine::freeSlot(Request request)
+{
+    Slot &freed = slots_[request]; // its message, if any, is gone already
+    freed.used = false;
+    freed.links[POSTED].next = free_slot_;
+    free_slot_ = request;
+}
+
+Request MatchingEngine::irecv(int source, int tag)
+{
+    ++stats_.receives;
+    Request request = newSlot();
+    Slot &receive = slots_[request];
+    receive.receive = true;
+    receive.source = source;
+    receive.tag = tag;
+
+    // a message that came in before its receive
+    int message = findUnexpected(source, tag);
+    if (message >= 0)
+    {
+        Message &found = messages_[message];
+        receive.complete = true;
+        receive.source = found.source;
+        receive.tag = found.tag;
+        receive.ready = found.time;
+        receive.data = std::move(found.data);
+        removeUnexpected(message);
+        return request;
+    }
+
+    receive.order = next_order_++;
+    pushBack(slots_, posted_, request, POSTED);
+    if (posted_indexed_)
+        pushBack(slots_, posted_by_key_[key(source, tag)], request, BUCKET);
+    else if (mode_ == MatchingMode::HASHED && posted_.size > SHORT_QUEUE)
+        indexPosted();
+    if (source == ANY_SOURCE || tag == ANY_TAG)
+        ++wildcards_posted_;
+    stats_.max_posted = std::max(stats_.max_posted, posted_.size);
+    return request;
+}
+
+Request MatchingEngine::isend(SimTick done)
+{
+    Request request = newSlot();
+    slots_[request].complete = true; // eager: the message is a copy, only its departure is pending
+    slots_[request].ready = done;
+    return request;
+}
+
+std::optional<Event> MatchingEngine::arrive(int source, int tag, Payload data, SimTick time)
+{
+    ++stats_.arrivals;
+    int index = findPosted(source, tag);
+    if (index >= 0)
+    {
+        Slot &receive = slots_[index];
+        unlink(slots_, posted_, index, POSTED);
+        if (posted_indexed_)
+        {
+            unlinkBucket(slots_, posted_by_key_, key(receive.source, receive.tag), index, BUCKET);
+            posted_indexed_ = posted_.size > 0; // the buckets are empty (and gone) with the queue
+        }
+        if (receive.source == ANY_SOURCE || receive.tag == ANY_TAG)
+            --wildcards_posted_;
+        receive.source = source;
+        receive.tag = tag;
+        receive.data = std::move(data);
+        return complete(receive, time);
+    }
+
+    // nobody asked for it yet
+    ++stats_.unexpected;
+    int message;
+    if (!free_messages_.empty())
+    {
+        message = free_messages_.back();
+        free_messages_.pop_back();
+    }
+    else
+    {
+        message = static_cast<int>(messages_.size());
+        messages_.emplace_back();
+    }
+    Message &queued = messages_[message];
+    queued.source = source;
+    queued.tag = tag;
+    queued.time = time;
+    queued.data = std::move(data);
+    pushBack(messages_, unexpected_, message, ALL);
+    if (unexpected_indexed_)
+        indexMessage(message);
+    else if (mode_ == MatchingMode::HASHED && unexpected_.size > SHORT_QUEUE)
+    {
+        for (int index = unexpected_.head; index >= 0; index = messages_[index].links[ALL].next)
+            indexMessage(index);
+        unexpected_indexed_ = true;
+    }
+    stats_.max_unexpected = std::max(stats_.max_unexpected, unexpected_.size);
+    return std::nullopt;
+}
+
+void MatchingEngine::indexPosted()
+{
+    for (int index = posted_.head; index >= 0; index = slots_[index].links[POSTED].next)
+        pushBack(slots_, posted_by_key_[key(slots_[index].source, slots_[index].tag)], index, BUCKET);
+    posted_indexed_ = true;
+}
+
+void MatchingEngine::indexMessage(int index)
+{
+    const Message &message = messages_[index];
+    pushBack(messages_, unexpected_by_key_[key(message.source, message.tag)], index, EXACT);
+    pushBack(messages_, unexpected_by_key_[key(message.source, ANY_TAG)], index, BY_SOURCE);
+    pushBack(messages_, unexpected_by_key_[key(ANY_SOURCE, message.tag)], index, BY_TAG);
+}
+
+int MatchingEngine::findPosted(int source, int tag)
+{
+    if (!posted_indexed_)
+    {
+        for (int index = posted_.head; index >= 0; index = slots_[index].links[POSTED].next)
+        {
+            ++stats_.probes;
+            if (matches(slots_[index].source, slots_[index].tag, source, tag))
+                return index;
+        }
+        return -1;
+    }
+
+    // the receive posted first among the heads of the buckets that can match
+    int best = -1;
+    auto candidate = [&](int receive_source, int receive_tag) {
+        ++stats_.probes;
+        Fifo *bucket = posted_by_key_.find(key(receive_source, receive_tag));
+        if (!bucket)
+            return;
+        int head = bucket->head;
+        if (best < 0 || slots_[head].order < slots_[best].order)
+            best = head;
+    };
+    candidate(source, tag);
+    if (wildcards_posted_ > 0)
+    {
+        candidate(source, ANY_TAG);
+        candidate(ANY_SOURCE, tag);
+        candidate(ANY_SOURCE, ANY_TAG);
+    }
+    return best;
+}
+
+int MatchingEngine::findUnexpected(int source, int tag)
+{
+    if (!unexpected_indexed_)
+    {
+        for (int index = unexpected_.head; index >= 0; index = messages_[index].links[ALL].next)
+        {
+            ++stats_.probes;
+            if (matches(source, tag, messages_[index].source, messages_[index].tag))
+                return index;
+        }
+        return -1;
+    }
+
+    // every fifo is in arrival order: the head of the one the pattern selects is the oldest match
+    ++stats_.probes;
+    if (source == ANY_SOURCE && tag == ANY_TAG)
+        return unexpected_.head;
+    Fifo *bucket = unexpected_by_key_.find(key(source, tag));
+    return bucket ? bucket->head : -1;
+}
+
+void MatchingEngine::removeUnexpected(int index)
+{
+    Message &message = messages_[index];
+    unlink(messages_, unexpected_, index, ALL);
+    if (unexpected_indexed_)
+    {
+        unlinkBucket(messages_, unexpected_by_key_, key(message.source, message.tag), index, EXACT);
+        unlinkBucket(messages_, unexpected_by_key_, key(message.source, ANY_TAG), index, BY_SOURCE);
+        unlinkBucket(messages_, unexpected_by_key_, key(ANY_SOURCE, message.tag), index, BY_TAG);
+        unexpected_indexed_ = unexpected_.size > 0;
+    }
+    message = Message();
+    free_messages_.push_back(index);
+}
+
+std::optional<Event> MatchingEngine::complete(Slot &request, SimTick time)
+{
+    request.complete = true;
+    request.ready = time;
+    if (request.group < 0)
+        return std::nullopt;
+
+    int index = request.group;
+    request.group = -1;
+    WaitGroup &group = groups_[index];
+    group.last = std::max(group.last, time);
+    if (--group.pending > 0)
+        return std::nullopt;
+    Event resumed = retime(group);
+    groups_[index] = WaitGroup();
+    free_groups_.push_back(index);
+    return resumed;
+}
+
+Event MatchingEngine::retime(const WaitGroup &group)
+{
+    const Event &resume = *group.resume;
+    return Event(std::max(resume.getTime(), group.last + group.delay), resume.getType(), resume.getSourceRank(),
+                 resume.getDestRank(), resume.getData(), resume.getTag());
+}
+
+// --------------------------------------------------------------- test / wait
+
+bool MatchingEngine::test(Request &request, SimTick now, Payload *data, int *source, int *tag)
+{
+    if (request == REQUEST_NULL)
+        return true;
+    Slot &done = slot(request);
+    if (!done.complete || done.ready > now)
+        return false;
+    if (data)
+        *data = std::move(done.data);
+    else if (done.receive)
+        done.data = Payload();
+    if (source)
+        *source = done.source;
+    if (tag)
+        *tag = done.tag;
+    freeSlot(request);
+    request = REQUEST_NULL;
+    return true;
+}
+
+bool MatchingEngine::testAll(Request *requests, std::size_t count, SimTick now, Payload *data)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (requests[i] == REQUEST_NULL)
+            continue;
+        const Slot &done = slot(requests[i]);
+        if (!done.complete || done.ready > now)
+            return false;
+    }
+    for (std::size_t i = 0; i < count; ++i)
+        test(requests[i], now, data ? &data[i] : nullptr);
+    return true;
+}
+
+std::optional<Event> MatchingEngine::wait(Request request, const Event &resume, SimTick delay)
+{
+    return waitAll(&request, 1, resume, delay);
+}
+
+std::optional<Event> MatchingEngine::waitAll(const Request *requests, std::size_t count, const Event &resume,
+                                             SimTick delay)
+{
+    WaitGroup group;
+    group.last = resume.getTime() - delay; // no earlier than the event's own time
+    group.delay = delay;
+    group.resume = resume;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Request request = requests[i];
+        if (request == REQUEST_NULL)
+            continue;
+        Slot &waited = slot(request);
+        if (waited.group >= 0)
+            throw std::runtime_error("Request " + std::to_string(request) + " is already waited for");
+        if (waited.complete)
+            group.last = std::max(group.last, waited.ready);
+        else
+            ++group.pending;
+    }
+    if (group.pending == 0)
+        return retime(group);
+
+    int index;
+    if (!free_groups_.empty())
+    {
+        index = free_groups_.back();
+        free_groups_.pop_back();
+    }
+    else
+    {
+        index = static_cast<int>(groups_.size());
+        groups_.emplace_back();
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (requests[i] != REQUEST_NULL && !slots_[requests[i]].complete)
+            slots_[requests[i]].group = index;
+    }
+    groups_[index] = std::move(group);
+    return std::nullopt;
+}
+
+std::size_t MatchingEngine::bytes() const
+{
+    return slots_.capacity() * sizeof(Slot) + messages_.capacity() * sizeof(Message) +
+           groups_.capacity() * sizeof(WaitGroup) +
+           (free_messages_.capacity() + free_groups_.capacity()) * sizeof(int) + posted_by_key_.bytes() +
+           unexpected_by_key_.bytes();
+}
+
+// ---------------------------------------------------------------- checkpoints
+
+void MatchingEngine::save(SnapshotWriter &out) const
+{
+    out.put(mode_);
+    out.put<std::int32_t>(free_slot_);
+    out.put<std::uint64_t>(slots_.size());
+    for (const Slot &slot : slots_)
+    {
+        out.put(slot.used);
+        out.put(slot.receive);
+        out.put(slot.complete);
+        out.put<std::int32_t>(slot.source);
+        out.put<std::int32_t>(slot.tag);
+        out.put(slot.order);
+        out.put(slot.ready);
+        out.put<std::int32_t>(slot.group);
+        out.putPayload(slot.data);
+        for (const Link &link : slot.links)
+            out.put(link);
+    }
+    out.put(posted_);
+    out.put(unexpected_);
+    out.put<std::uint64_t>(wildcards_posted_);
+    out.put(posted_indexed_);
+    out.put(unexpected_indexed_);
+    out.put(next_order_);
+    out.put(stats_);
+    posted_by_key_.save(out);
+    unexpected_by_key_.save(out);
+
+    out.put<std::uint64_t>(messages_.size());
+    for (const Message &message : messages_)
+    {
+        out.put<std::int32_t>(message.source);
+        out.put<std::int32_t>(message.tag);
+        out.put(message.time);
+        out.putPayload(message.data);
+        for (const Link &link : message.links)
+            out.put(link);
+    }
+    out.putVector(free_messages_);
+
+    out.put<std::uint64_t>(groups_.size());
+    for (const WaitGroup &group : groups_)
+    {
+        out.put<std::int32_t>(group.pending);
+        out.put(group.last);
+        out.put(group.delay);
+        out.put(group.resume.has_value());
+        if (group.resume)
+            out.putEvent(*group.resume);
+    }
+    out.putVector(free_groups_);
+}
+
+void MatchingEngine::load(SnapshotReader &in)
+{
+    mode_ = in.get<MatchingMode>();
+    free_slot_ = in.get<std::int32_t>();
+    slots_.resize(in.get<std::uint64_t>());
+    for (Slot &slot : slots_)
+    {
+        slot.used = in.get<bool>();
+        slot.receive = in.get<bool>();
+        slot.complete = in.get<bool>();
+        slot.source = in.get<std::int32_t>();
+        slot.tag = in.get<std::int32_t>();
+        slot.order = in.get<std::uint64_t>();
+        slot.ready = in.get<SimTick>();
+        slot.group = in.get<std::int32_t>();
+        slot.data = in.getPayload();
+        for (Link &link : slot.links)
+            link = in.get<Link>();
+    }
+    posted_ = in.get<Fifo>();
+    unexpected_ = in.get<Fifo>();
+    wildcards_posted_ = in.get<std::uint64_t>();
+    posted_indexed_ = in.get<bool>();
+    unexpected_indexed_ = in.get<bool>();
+    next_order_ = in.get<std::uint64_t>();
+    stats_ = in.get<Stats>();
+    posted_by_key_.load(in);
+    unexpected_by_key_.load(in);
+
+    messages_.resize(in.get<std::uint64_t>());
+    for (Message &message : messages_)
+    {
+        message.source = in.get<std::int32_t>();
+        message.tag = in.get<std::int32_t>();
+        message.time = in.get<SimTick>();
+        message.data = in.getPayload();
+        for (Link &link : message.links)
+            link = in.get<Link>();
+    }
+    in.getVector(free_messages_);
+
+    groups_.resize(in.get<std::uint64_t>());
+    for (WaitGroup &group : groups_)
+    {
+        group.pending = in.get<std::int32_t>();
+        group.last = in.get<SimTick>();
+        group.delay = in.get<SimTick>();
+        group.resume.reset();
+        if (in.get<bool>())
+            group.resume = in.getEvent();
+    }
+    in.getVector(free_groups_);
+}
@@ -1,12 +1,13 @@
 #include "my_mpi.hpp"
 
 
-void MyMPI::init(int num_processes)
+void MyMPI::init(int num_processes, const NetworkConfig &network)
 {
     num_processes_ = num_processes;
+    network_ = makeNetworkModel(network, num_processes);
 }
 
-Event MyMPI::send(int source, int dest, const std::vector<int> &data, int tag, double current_time)
+Event MyMPI::send(int source, int dest, Payload data, int tag, SimTick current_time)
 {
 
     if (
@@ -20,12 +21,12 @@ Event MyMPI::send(int source, int dest, const std::vector<int> &data, int tag, d
     {
 
         // Calculate message transfer time (simulated network delay)
-        double transfer_time = SimTime::SEND_TIME;
-        double arrival_time = current_time + transfer_time;
+        SimTick transfer_time = SimTime::SEND_TIME;
+        SimTick arrival_time = current_time + transfer_time;
 
         // Schedule the SEND event (using an Event object) instead of a lambda
 
-        return Event(arrival_time, EventType::SEND, source, dest, data, tag);
+        return Event(arrival_time, EventType::SEND, source, dest, std::move(data), tag);
     }
 
     else
@@ -34,7 +35,7 @@ Event MyMPI::send(int source, int dest, const std::vector<int> &data, int tag, d
     }
 }
 
-Event MyMPI::receive(int rank, int source, const std::vector<int> &data, int tag, double current_time)
+Event MyMPI::receive(int rank, int source, Payload data, int tag, SimTick departure)
 
 {
     if (
@@ -46,10 +47,10 @@ Event MyMPI::receive(int rank, int source, const std::vector<int> &data, int tag
     if (source == RANDOM_INIT_PROCESSOR_RANK || !(source < 0 || source >= num_processes_))
     {
         // Calculate simulated network delay
-        double arrival_time = current_time + SimTime::RECV_TIME;
+        SimTick arrival_time = departure + calculateTransferTime(source, rank, data.size(), departure);
 
         // Schedule the RECV event
-            return Event(arrival_time, EventType::RECV, source, rank, data, tag);
+            return Event(arrival_time, EventType::RECV, source, rank, std::move(data), tag);
     }
     // Validate source and destination ranks
     else
@@ -57,3 +58,57 @@ Event MyMPI::receive(int rank, int source, const std::vector<int> &data, int tag
         throw std::runtime_error("4 Invalid process rank");
     }
 }
+
+SimTick MyMPI::allreduceTime() const
+{
+    // recursive doubling: ceil(log2 P) pairwise exchanges of a one-int flag
+    int steps = 0;
+    while ((1 << steps) < num_processes_)
+        ++steps;
+    return steps * network_->latency(1);
+}
+
+Event MyMPI::allreduce(int tag, SimTick current_time)
+{
+    return Event(current_time + allreduceTime(), EventType::ALLREDUCE, 0, 0, Payload(), tag);
+}
+
+Collectives::Schedule MyMPI::bcast(int root, Collectives::Algorithm algorithm, int group_size, int group_stride) const
+{
+    return Collectives::Schedule(Collectives::Op::BCAST, algorithm, num_processes_, root, Collectives::ReduceOp::SUM,
+                                 group_size, group_stride);
+}
+
+Collectives::Schedule MyMPI::scatter(int root, Collectives::Algorithm algorithm, int group_size, int group_stride) const
+{
+    return Collectives::Schedule(Collectives::Op::SCATTER, algorithm, num_processes_, root, Collectives::ReduceOp::SUM,
+                                 group_size, group_stride);
+}
+
+Collectives::Schedule MyMPI::gather(int root, Collectives::Algorithm algorithm, int group_size, int group_stride) const
+{
+    return Collectives::Schedule(Collectives::Op::GATHER, algorithm, num_processes_, root, Collectives::ReduceOp::SUM,
+                                 group_size, group_stride);
+}
+
+Collectives::Schedule MyMPI::allreduce(Collectives::ReduceOp reduce, Collectives::Algorithm algorithm,
+                                       int group_size, int group_stride) const
+{
+    return Collectives::Schedule(Collectives::Op::ALLREDUCE, algorithm, num_processes_, 0, reduce, group_size,
+                                 group_stride);
+}
+
+Collectives::Schedule MyMPI::alltoall(Collectives::Algorithm algorithm, int group_size, int group_stride) const
+{
+    return Collectives::Schedule(Collectives::Op::ALLTOALL, algorithm, num_processes_, 0, Collectives::ReduceOp::SUM,
+                                 group_size, group_stride);
+}
+
+Event MyMPI::collectiveMessage(int source, int dest, Payload data, std::size_t elements, int round, SimTick departure)
+{
+    if (source < 0 || source >= num_processes_ || dest < 0 || dest >= num_processes_)
+    {
+        throw std::runtime_error("Invalid process rank in collective");
+    }
+    return Event(departure + calculateTransferTime(source, dest, elements, departure), EventType::COLLECTIVE, source, dest, std::move(data), round);
+}
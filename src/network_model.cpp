@@ -0,0 +1,372 @@
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "network_model.hpp"
+#include "snapshot.hpp"
+
+namespace
+{
+    SimTick bytesToTicks(std::size_t bytes, double ticks_per_byte)
+    {
+        return static_cast<SimTick>(std::llround(static_cast<double>(bytes) * ticks_per_byte));
+    }
+
+    // the bytes after the first, the (k - 1) of LogGP
+    SimTick laterBytesToTicks(std::size_t bytes, double ticks_per_byte)
+    {
+        if (bytes == 0)
+            return 0;
+        return static_cast<SimTick>(std::llround(static_cast<double>(bytes - 1) * ticks_per_byte));
+    }
+
+    // appended to describe() when elements stand for records larger than their key
+    std::string recordString(std::size_t element_bytes)
+    {
+        return element_bytes == sizeof(Key) ? "" : ", " + std::to_string(element_bytes) + "-byte records";
+    }
+
+    // largest divisor of n not above its k-th root
+    int rootDivisor(int n, int k)
+    {
+        int best = 1;
+        for (int d = 1; std::pow(d, k) <= n; ++d)
+        {
+            if (n % d == 0)
+                best = d;
+        }
+        return best;
+    }
+
+    std::string shapeString(const std::vector<int> &shape)
+    {
+        std::string result;
+        for (std::size_t i = 0; i < shape.size(); ++i)
+            result += (i == 0 ? "" : "x") + std::to_string(shape[i]);
+        return result;
+    }
+}
+
+std::unique_ptr<NetworkModel> makeNetworkModel(const NetworkConfig &config, int num_ranks)
+{
+    switch (config.model)
+    {
+    case NetworkModelType::FLAT:
+        return std::make_unique<FlatNetwork>();
+    case NetworkModelType::HOCKNEY:
+        break;
+    case NetworkModelType::LOGGP:
+        return std::make_unique<LogGPNetwork>(config);
+    case NetworkModelType::LINKS:
+        return std::make_unique<LinkNetwork>(config, num_ranks);
+    }
+    return std::make_unique<HockneyNetwork>(config);
+}
+
+const char *networkModelName(NetworkModelType type)
+{
+    switch (type)
+    {
+    case NetworkModelType::FLAT:
+        return "flat";
+    case NetworkModelType::HOCKNEY:
+        return "hockney";
+    case NetworkModelType::LOGGP:
+        return "loggp";
+    case NetworkModelType::LINKS:
+        return "links";
+    }
+    return "unknown";
+}
+
+const char *topologyName(TopologyType type)
+{
+    switch (type)
+    {
+    case TopologyType::RING:
+        return "ring";
+    case TopologyType::TORUS_2D:
+        return "torus2d";
+    case TopologyType::TORUS_3D:
+        return "torus3d";
+    case TopologyType::FAT_TREE:
+        return "fattree";
+    case TopologyType::DRAGONFLY:
+        return "dragonfly";
+    }
+    return "unknown";
+}
+
+std::string FlatNetwork::describe() const
+{
+    std::ostringstream out;
+    out << "flat (" << ticksToUnits(latency(0)) << " units per message)";
+    return out.str();
+}
+
+HockneyNetwork::HockneyNetwork(const NetworkConfig &config)
+    : alpha_(toTicks(config.latency)), ticks_per_byte_(TICKS_PER_UNIT / config.bandwidth),
+      element_bytes_(config.elementBytes())
+{
+}
+
+SimTick HockneyNetwork::wireTime(std::size_t elements) const
+{
+    return bytesToTicks(elements * element_bytes_, ticks_per_byte_);
+}
+
+std::string HockneyNetwork::describe() const
+{
+    std::ostringstream out;
+    out << "hockney (alpha " << ticksToUnits(alpha_) << " units, " << TICKS_PER_UNIT / ticks_per_byte_
+        << " bytes/unit" << recordString(element_bytes_) << ")";
+    return out.str();
+}
+
+LogGPNetwork::LogGPNetwork(const NetworkConfig &config)
+    : latency_(toTicks(config.latency)), overhead_(toTicks(config.overhead)), gap_(toTicks(config.gap)),
+      ticks_per_byte_(TICKS_PER_UNIT / config.bandwidth), element_bytes_(config.elementBytes())
+{
+}
+
+SimTick LogGPNetwork::latency(std::size_t elements) const
+{
+    // the first byte takes L, every further one G; o on either end
+    return latency_ + 2 * overhead_ + laterBytesToTicks(elements * element_bytes_, ticks_per_byte_);
+}
+
+SimTick LogGPNetwork::wireTime(std::size_t elements) const
+{
+    // consecutive messages start g + (k - 1) G apart
+    return gap_ + laterBytesToTicks(elements * element_bytes_, ticks_per_byte_);
+}
+
+std::string LogGPNetwork::describe() const
+{
+    std::ostringstream out;
+    out << "loggp (L " << ticksToUnits(latency_) << ", o " << ticksToUnits(overhead_) << ", g " << ticksToUnits(gap_)
+        << " units, " << TICKS_PER_UNIT / ticks_per_byte_ << " bytes/unit" << recordString(element_bytes_) << ")";
+    return out.str();
+}
+
+LinkNetwork::LinkNetwork(const NetworkConfig &config, int num_ranks)
+    : topology_(config.topology), num_ranks_(num_ranks), shape_(config.shape), latency_(toTicks(config.latency)),
+      hop_latency_(toTicks(config.hop_latency)), ticks_per_byte_(TICKS_PER_UNIT / config.bandwidth),
+      element_bytes_(config.elementBytes())
+{
+    const int p = num_ranks;
+    std::size_t dims = 0;
+    switch (topology_)
+    {
+    case TopologyType::RING:
+        dims = 1;
+        if (shape_.empty())
+            shape_ = {p};
+        break;
+    case TopologyType::TORUS_2D:
+        dims = 2;
+        if (shape_.empty())
+            shape_ = {p / rootDivisor(p, 2), rootDivisor(p, 2)};
+        break;
+    case TopologyType::TORUS_3D:
+        dims = 3;
+        if (shape_.empty())
+        {
+            int c = rootDivisor(p, 3);
+            shape_ = {p / c / rootDivisor(p / c, 2), rootDivisor(p / c, 2), c};
+        }
+        break;
+    case TopologyType::FAT_TREE:
+        dims = 1;
+        if (shape_.empty())
+            shape_ = {static_cast<int>(std::ceil(std::sqrt(static_cast<double>(p))))};
+        break;
+    case TopologyType::DRAGONFLY:
+        dims = 2;
+        if (shape_.empty())
+            shape_ = {2, 4};
+        break;
+    }
+
+    std::string name = topologyName(topology_);
+    if (shape_.size() != dims)
+        throw std::runtime_error(name + " needs a shape of " + std::to_string(dims) + " number(s)");
+    long long product = 1;
+    for (int extent : shape_)
+    {
+        if (extent <= 0)
+            throw std::runtime_error(name + " shape " + shapeString(shape_) + " has a non-positive extent");
+        product *= extent;
+    }
+    // direct networks: one router per rank
+    bool direct = topology_ == TopologyType::RING || topology_ == TopologyType::TORUS_2D ||
+                  topology_ == TopologyType::TORUS_3D;
+    if (direct && product != p)
+        throw std::runtime_error(name + " shape " + shapeString(shape_) + " has " + std::to_string(product) +
+                                 " nodes, not " + std::to_string(p));
+
+    neighbor_hops_ = p > 1 ? static_cast<int>(route(0, 1).size()) - 1 : 0;
+}
+
+std::vector<int> LinkNetwork::route(int source, int dest) const
+{
+    std::vector<int> path{source};
+    if (source == dest)
+        return path;
+    switch (topology_)
+    {
+    case TopologyType::RING:
+    case TopologyType::TORUS_2D:
+    case TopologyType::TORUS_3D:
+        torusRoute(path, source, dest);
+        break;
+    case TopologyType::FAT_TREE:
+        fatTreeRoute(path, source, dest);
+        break;
+    case TopologyType::DRAGONFLY:
+        dragonflyRoute(path, source, dest);
+        break;
+    }
+    return path;
+}
+
+void LinkNetwork::torusRoute(std::vector<int> &path, int source, int dest) const
+{
+    // dimension-order routing, the shorter way round in each dimension
+    int current = source;
+    int stride = 1;
+    for (int extent : shape_)
+    {
+        int from = current / stride % extent;
+        int to = dest / stride % extent;
+        int forward = (to - from + extent) % extent;
+        int step = forward <= extent - forward ? 1 : extent - 1;
+        for (int hops = std::min(forward, extent - forward); hops > 0; --hops)
+        {
+            int coordinate = current / stride % extent;
+            current += ((coordinate + step) % extent - coordinate) * stride;
+            path.push_back(current);
+        }
+        stride *= extent;
+    }
+}
+
+void LinkNetwork::fatTreeRoute(std::vector<int> &path, int source, int dest) const
+{
+    // hosts -> leaf switches -> spine switches; the spine is picked by destination (d-mod-k)
+    int hosts_per_leaf = shape_[0];
+    int leaves = (num_ranks_ + hosts_per_leaf - 1) / hosts_per_leaf;
+    int source_leaf = num_ranks_ + source / hosts_per_leaf;
+    int dest_leaf = num_ranks_ + dest / hosts_per_leaf;
+    path.push_back(source_leaf);
+    if (source_leaf != dest_leaf)
+    {
+        path.push_back(num_ranks_ + leaves + dest % hosts_per_leaf);
+        path.push_back(dest_leaf);
+    }
+    path.push_back(dest);
+}
+
+void LinkNetwork::dragonflyRoute(std::vector<int> &path, int source, int dest) const
+{
+    // minimal routing: local hop to the router holding the global link, global hop, local hop
+    int hosts_per_router = shape_[0];
+    int routers_per_group = shape_[1];
+    int source_router = source / hosts_per_router;
+    int dest_router = dest / hosts_per_router;
+    int source_group = source_router / routers_per_group;
+    int dest_group = dest_router / routers_per_group;
+
+    auto vertex = [this](int router) { return num_ranks_ + router; };
+    path.push_back(vertex(source_router));
+    if (source_group != dest_group)
+    {
+        // group g reaches group h through its router h mod a
+        int exit = source_group * routers_per_group + dest_group % routers_per_group;
+        int entry = dest_group * routers_per_group + source_group % routers_per_group;
+        if (exit != source_router)
+            path.push_back(vertex(exit));
+        path.push_back(vertex(entry));
+        if (entry != dest_router)
+            path.push_back(vertex(dest_router));
+    }
+    else if (source_router != dest_router)
+        path.push_back(vertex(dest_router));
+    path.push_back(dest);
+}
+
+SimTick LinkNetwork::transferTime(int source, int dest, std::size_t elements, SimTick departure)
+{
+    // the message holds every link of its route while it streams through (wormhole):
+    // it starts once the last of them is free
+    std::vector<int> path = route(source, dest);
+    SimTick serialization = wireTime(elements);
+    SimTick start = departure;
+    std::vector<std::uint64_t> links;
+    links.reserve(path.size());
+    for (std::size_t i = 0; i + 1 < path.size(); ++i)
+    {
+        links.push_back(static_cast<std::uint64_t>(path[i]) << 32 | static_cast<std::uint32_t>(path[i + 1]));
+        auto booked = link_free_.find(links.back());
+        if (booked != link_free_.end())
+            start = std::max(start, booked->second);
+    }
+    if (start > departure)
+    {
+        ++delayed_;
+        waited_ += start - departure;
+    }
+    for (std::uint64_t link : links)
+        link_free_[link] = start + serialization;
+    return start - departure + latency_ + hop_latency_ * static_cast<SimTick>(links.size()) + serialization;
+}
+
+SimTick LinkNetwork::latency(std::size_t elements) const
+{
+    return latency_ + hop_latency_ * neighbor_hops_ + wireTime(elements);
+}
+
+SimTick LinkNetwork::wireTime(std::size_t elements) const
+{
+    return bytesToTicks(elements * element_bytes_, ticks_per_byte_);
+}
+
+void LinkNetwork::reset()
+{
+    link_free_.clear();
+    delayed_ = 0;
+    waited_ = 0;
+}
+
+void LinkNetwork::save(SnapshotWriter &out) const
+{
+    out.put<std::uint64_t>(link_free_.size());
+    for (const auto &[link, free] : link_free_)
+    {
+        out.put(link);
+        out.put(free);
+    }
+    out.put<std::uint64_t>(delayed_);
+    out.put(waited_);
+}
+
+void LinkNetwork::load(SnapshotReader &in)
+{
+    link_free_.clear();
+    for (std::size_t links = in.get<std::uint64_t>(); links > 0; --links)
+    {
+        std::uint64_t link = in.get<std::uint64_t>();
+        link_free_[link] = in.get<SimTick>();
+    }
+    delayed_ = in.get<std::uint64_t>();
+    waited_ = in.get<SimTick>();
+}
+
+std::string LinkNetwork::describe() const
+{
+    std::ostringstream out;
+    out << "links (" << topologyName(topology_) << " " << shapeString(shape_) << ", "
+        << TICKS_PER_UNIT / ticks_per_byte_ << " bytes/unit per link, latency " << ticksToUnits(latency_) << " + "
+        << ticksToUnits(hop_latency_) << " per hop" << recordString(element_bytes_) << ")";
+    return out.str();
+}
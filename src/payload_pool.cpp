@@ -0,0 +1,209 @@
+#include <new>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include "payload_pool.hpp"
+#include "instrumentation.hpp"
+
+// Header placed in front of every buffer, padded to the pool alignment
+struct Payload::Block
+{
+    PayloadPool *pool;
+    Block *next_free;
+    std::size_t size;       // keys in use
+    std::atomic<std::uint32_t> refcount;
+    std::uint32_t size_class;
+    bool sorted;            // contents known to be ascending
+
+    static constexpr std::size_t HEADER_BYTES = 64;
+    Key *keys() { return reinterpret_cast<Key *>(reinterpret_cast<char *>(this) + HEADER_BYTES); }
+};
+
+// ------------------------------------------------------------------- Payload
+
+Payload::Payload(Block *block) : block_(block)
+{
+    static_assert(sizeof(Block) <= Block::HEADER_BYTES, "payload header too large");
+}
+
+Payload &Payload::operator=(const Payload &other)
+{
+    if (block_ != other.block_)
+    {
+        release();
+        block_ = other.block_;
+        retain();
+    }
+    return *this;
+}
+
+Payload &Payload::operator=(Payload &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        block_ = other.block_;
+        other.block_ = nullptr;
+    }
+    return *this;
+}
+
+const Key *Payload::data() const
+{
+    return block_ ? block_->keys() : nullptr;
+}
+
+Key *Payload::mutableData()
+{
+    if (block_ && block_->refcount.load(std::memory_order_acquire) != 1)
+        throw std::runtime_error("Writing to a shared payload");
+    return block_ ? block_->keys() : nullptr;
+}
+
+std::size_t Payload::size() const
+{
+    return block_ ? block_->size : 0;
+}
+
+bool Payload::isSorted() const
+{
+    return block_ && block_->sorted;
+}
+
+void Payload::setSorted(bool sorted)
+{
+    if (block_ && block_->refcount.load(std::memory_order_acquire) != 1)
+        throw std::runtime_error("Writing to a shared payload");
+    if (block_)
+        block_->sorted = sorted;
+}
+
+bool Payload::unique() const
+{
+    return block_ && block_->refcount.load(std::memory_order_acquire) == 1;
+}
+
+Payload Payload::clone() const
+{
+    if (!block_)
+        return Payload();
+    Payload copy = block_->pool->copyOf(block_->keys(), block_->size);
+    copy.block_->sorted = block_->sorted;
+    return copy;
+}
+
+void Payload::retain()
+{
+    if (block_)
+        block_->refcount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Payload::release()
+{
+    if (block_ && block_->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        block_->pool->recycle(block_);
+    block_ = nullptr;
+}
+
+// --------------------------------------------------------------- PayloadPool
+
+PayloadPool::~PayloadPool()
+{
+    for (void *slab : slabs_)
+        ::operator delete(slab, std::align_val_t(ALIGNMENT));
+}
+
+std::size_t PayloadPool::sizeClass(std::size_t count)
+{
+    std::size_t size_class = 0;
+    while ((MIN_CLASS_ELEMENTS << size_class) < count)
+        ++size_class;
+    return size_class;
+}
+
+std::size_t PayloadPool::blockBytes(std::size_t size_class)
+{
+    return Payload::Block::HEADER_BYTES + (MIN_CLASS_ELEMENTS << size_class) * sizeof(Key);
+}
+
+void PayloadPool::grow(std::size_t size_class)
+{
+    std::size_t block_bytes = blockBytes(size_class);
+    std::size_t blocks = block_bytes >= SLAB_BYTES ? 1 : SLAB_BYTES / block_bytes;
+
+    char *slab = static_cast<char *>(::operator new(blocks * block_bytes, std::align_val_t(ALIGNMENT)));
+    slabs_.push_back(slab);
+    stats_.bytes_allocated += blocks * block_bytes;
+
+    for (std::size_t i = 0; i < blocks; ++i)
+    {
+        auto *block = new (slab + i * block_bytes) Payload::Block();
+        block->pool = this;
+        block->size_class = static_cast<std::uint32_t>(size_class);
+        block->next_free = free_lists_[size_class];
+        free_lists_[size_class] = block;
+    }
+}
+
+Payload PayloadPool::acquire(std::size_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t size_class = sizeClass(count);
+    if (size_class >= free_lists_.size())
+        free_lists_.resize(size_class + 1, nullptr);
+
+    ++stats_.acquires;
+    bool new_slab = free_lists_[size_class] == nullptr;
+    if (new_slab)
+        grow(size_class);
+    else
+        ++stats_.reuses;
+    if (Instrumentation *sink = Instrumentation::active())
+        sink->buffer(new_slab);
+
+    Payload::Block *block = free_lists_[size_class];
+    free_lists_[size_class] = block->next_free;
+    block->next_free = nullptr;
+    block->refcount.store(1, std::memory_order_relaxed);
+    block->size = count;
+    block->sorted = false;
+
+    stats_.bytes_in_use += blockBytes(size_class);
+    if (stats_.bytes_in_use > stats_.peak_bytes_in_use)
+        stats_.peak_bytes_in_use = stats_.bytes_in_use;
+    return Payload(block);
+}
+
+Payload PayloadPool::copyOf(const Key *data, std::size_t count)
+{
+    Payload payload = acquire(count);
+    if (count > 0)
+        std::memcpy(payload.block_->keys(), data, count * sizeof(Key));
+    if (Instrumentation *sink = Instrumentation::active())
+        sink->copied(count * sizeof(Key));
+    return payload;
+}
+
+void PayloadPool::recycle(Payload::Block *block)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.bytes_in_use -= blockBytes(block->size_class);
+    block->next_free = free_lists_[block->size_class];
+    free_lists_[block->size_class] = block;
+}
+
+PoolStats PayloadPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PayloadPool::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t in_use = stats_.bytes_in_use;
+    stats_ = PoolStats();
+    stats_.bytes_in_use = in_use;
+    stats_.peak_bytes_in_use = in_use;
+}
@@ -1,19 +1,52 @@
+#include <stdexcept>
+
 #include "processor.hpp"
+#include "instrumentation.hpp"
+#include "sort_kernels.hpp"
+#include "snapshot.hpp"
 
 class EventSimulator;
 
-void Processor::setNeighbors()
+void Processor::setData(const std::vector<Key> &data, bool sorted)
+{
+    setData(data.data(), data.size(), sorted);
+}
+
+void Processor::setData(const Key *data, std::size_t count, bool sorted)
 {
-    if (rank_ % 2 == 0)
+    if (count != elements_)
     {
-        odd_neighbor = rank_ + 1;
-        even_neighbor = rank_ - 1;
+        setData(std::vector<Key>(data, data + count), sorted);
+        return;
     }
-    else
+    current_ = 0;
+    std::copy(data, data + count, local()); // Create a copy of the input data
+    adoptSliceData();
+    sorted_ = sorted;
+}
+
+void Processor::adoptSliceData()
+{
+    current_ = 0;
+    in_slice_ = true;
+    resized_ = std::vector<Key>();
+    sorted_ = false;
+    changed_ = false;
+    received_data_ = Payload();
+}
+
+void Processor::setData(std::vector<Key> &&data, bool sorted)
+{
+    if (data.size() == elements_)
     {
-        odd_neighbor = rank_ - 1;
-        even_neighbor = rank_ + 1;
+        setData(data.data(), data.size(), sorted);
+        return;
     }
+    resized_ = std::move(data);
+    in_slice_ = false;
+    sorted_ = sorted;
+    changed_ = false;
+    received_data_ = Payload();
 }
 
 // Get new array into its cache
@@ -21,116 +54,165 @@ void Processor::receiveMessage()
 {
     std::cout << "\n[Processor " << rank_ << "] Performing \"Receive\""
               << "\n  Local data: ";
-    for (int val : local_data_)
+    for (Key val : getData())
     {
         std::cout << val << " ";
     }
     std::cout << "\n  Received data: ";
-    for (int val : received_data_)
+    for (Key val : received_data_)
     {
         std::cout << val << " ";
     }
 }
-// Perform a local sort of the processor's data
+// Sort local data unless it already is: only the initial data is unsorted,
+// compare-split keeps it sorted
+void Processor::sortLocalData()
+{
+    if (sorted_)
+        return;
+    if (verbose_)
+        std::cout << "\n[Processor " << rank_ << "] Performing local sort on local cache" << std::endl;
+    Instrumentation::KernelTimer timer(Instrumentation::Kernel::LOCAL_SORT);
+    if (in_slice_)
+        SortKernels::sort(kernels_, local(), spare(), elements_);
+    else
+    {
+        std::vector<Key> scratch(resized_.size());
+        SortKernels::sort(kernels_, resized_.data(), scratch.data(), resized_.size());
+    }
+    sorted_ = true;
+}
+
+// Perform a local sort of the processor's data, skipping caches known to be sorted
 void Processor::localSort()
 {
-    std::cout << "\n[Processor " << rank_ << "] Performing local sort on local caches";
-    //           << "\n  Before: ";
-    // for (int val : local_data_)
-    // {
-    //     std::cout << val << " ";
-    // }
-    std::sort(local_data_.begin(), local_data_.end());
-
-    // std::cout << "\n  After:  ";
-    // for (int val : local_data_)
-    // {
-    //     std::cout << val << " ";
-    // }
-    std::cout << std::endl;
-
-    std::cout << "\n[Processor " << rank_ << "] Performing local sort on received cache";
-    //           << "\n  Before: ";
-    // for (int val : received_data_)
-    // {
-    //     std::cout << val << " ";
-    // }
-    std::sort(received_data_.begin(), received_data_.end());
-    // std::cout << "\n  After:  ";
-    // for (int val : received_data_)
-    // {
-    //     std::cout << val << " ";
-    // }
-    std::cout << std::endl;
+    sortLocalData();
+
+    // senders mark their (sorted) data, so this only runs for unsorted messages
+    if (received_data_.empty() || received_data_.isSorted())
+        return;
+    if (verbose_)
+        std::cout << "\n[Processor " << rank_ << "] Performing local sort on received cache" << std::endl;
+    if (!received_data_.unique())
+        received_data_ = received_data_.clone(); // never sort a buffer someone else still sees
+    Instrumentation::KernelTimer timer(Instrumentation::Kernel::LOCAL_SORT);
+    Key *received = received_data_.mutableData();
+    if (received_data_.size() <= elements_)
+        SortKernels::sort(kernels_, received, spare(), received_data_.size());
+    else
+        std::sort(received, received + received_data_.size()); // larger than our scratch slice
+    received_data_.setSorted(true);
 }
 
 // Handle merge event from event simulator
-void Processor::handleMerge(bool isOddPhase)
+bool Processor::handleMerge(bool keepLow, bool speculative)
 {
-    std::vector<int> res_arr;
+    // nothing received: Time Warp rolls this event back once the message comes in
+    if (!in_slice_ || received_data_.size() != elements_)
+    {
+        if (speculative)
+            return false;
+        throw std::runtime_error("Processor " + std::to_string(rank_) + ": compare-split needs " +
+                                 std::to_string(elements_) + " local and received keys, has " +
+                                 std::to_string(in_slice_ ? elements_ : resized_.size()) + " and " +
+                                 std::to_string(received_data_.size()));
+    }
+
+    // which half to keep is the sort algorithm's decision (SortAlgorithm::keepsLow)
 
-    // double index pointer
-    int i = 0, j = 0;
-    int cache_size = local_data_.size();
+    const std::size_t cache_size = elements_;
+    const Key *local = this->local();
+    const Key *received = received_data_.data();
 
-    while (i < cache_size && j < cache_size)
+    if (cache_size > 0)
     {
-        if (local_data_[i] <= received_data_[j])
+        // already split: our half is untouched
+        if (keepLow ? local[cache_size - 1] <= received[0] : received[cache_size - 1] <= local[0])
         {
-            res_arr.push_back(local_data_[i++]);
+            received_data_ = Payload();
+            return false;
         }
-        else
+        // split the other way round: our half is exactly the neighbor's array
+        if (keepLow ? received[cache_size - 1] <= local[0] : local[cache_size - 1] <= received[0])
         {
-            res_arr.push_back(received_data_[j++]);
+            std::copy(received, received + cache_size, this->local());
+            received_data_ = Payload();
+            changed_ = true;
+            return true;
         }
     }
 
-    // for remaining elements
-        // Copy remaining elements from local_data_
-    while (i < cache_size)
-    {
-        res_arr.push_back(local_data_[i++]);
-    }
+    // merge only the half we keep into the spare slice, then swap planes
+    Instrumentation::KernelTimer timer(Instrumentation::Kernel::MERGE);
+    Key *out = spare();
 
-    // Copy remaining elements from received_data_
-    while (j < cache_size)
-    {
-        res_arr.push_back(received_data_[j++]);
-    }
+    // keeping the LOWER part: merge from the front
+    if (keepLow)
+        SortKernels::mergeLow(kernels_, local, received, out, cache_size);
+    // keeping the HIGHER part: merge from the back
+    else
+        SortKernels::mergeHigh(kernels_, local, received, out, cache_size);
+
+    current_ ^= 1;
+
+    // message buffer goes back to the pool
+    received_data_ = Payload();
+    changed_ = true;
+    return true;
+}
 
-    // DEBUG
-    // printVector(res_arr, "Workspace");
 
-    // DECISION OF KEEPING WHICH HALF
-    /* in EVEN phase, EVEN ranks' neighbor is rank-1 ----> EVEN ranks keeps HIGHER half  */
-    /* in EVEN phase, ODD ranks' neighbor is rank+1 ----> ODD ranks keeps LOWER half  */
+Processor::SavedState Processor::saveState(bool with_local) const
+{
+    SavedState state;
+    state.has_local = with_local;
+    if (with_local)
+        state.local_data.assign(local(), local() + elements_);
+    state.received_data = received_data_;
+    state.sorted = sorted_;
+    state.mailbox = mailbox_;
+    state.phase_requests = phase_requests_;
+    return state;
+}
+
+void Processor::restoreState(SavedState state)
+{
+    if (state.has_local)
+        std::copy(state.local_data.begin(), state.local_data.end(), local());
+    received_data_ = std::move(state.received_data);
+    sorted_ = state.sorted;
+    mailbox_ = std::move(state.mailbox);
+    phase_requests_ = state.phase_requests;
+}
 
-    /* in ODD phase, EVEN ranks' neighbor is rank+1 ----> EVEN ranks keeps LOWER half  */
-    /* in ODD phase, ODD ranks' neighbor is rank-1 ----> ODD ranks keeps HIGHER half  */
-    bool isEvenRank = this->getRank() % 2 == 0;
+void Processor::save(SnapshotWriter &out) const
+{
+    DataView data = getData();
+    out.put<std::uint64_t>(data.size());
+    out.putKeys(data.data(), data.size());
+    out.put(sorted_);
+    out.put(changed_);
+    out.putPayload(received_data_);
+    out.put(phase_requests_);
+    mailbox_.save(out);
+}
 
-    // odd phase, even rank AND even phase odd rank keeps LOWER part of the sorted array
-    if (isOddPhase == isEvenRank)
+void Processor::load(SnapshotReader &in)
+{
+    std::size_t count = in.get<std::uint64_t>();
+    const Key *data = in.getKeys(count);
+    current_ = 0;
+    in_slice_ = count == elements_;
+    if (in_slice_)
     {
-        for (int i = 0; i < cache_size; i++)
-        {
-            local_data_[i] = res_arr[i];
-        }
+        std::copy(data, data + count, local());
+        resized_ = std::vector<Key>();
     }
-    // Even phase, even rank AND odd phase odd rank keeps HIGHER part of the sorted array
     else
-    {
-        for (int i = 0; i < cache_size; i++)
-        {
-            local_data_[i] = res_arr[i+cache_size];
-        }
-    }
-
-    // std::cout << "\n[Processor " << rank_ << "] After performing compare-split:"
-    //           << std::endl;
-    // for (int val : local_data_)
-    // {
-    //     std::cout << val << " ";
-    // }
+        resized_.assign(data, data + count);
+    sorted_ = in.get<bool>();
+    changed_ = in.get<bool>();
+    received_data_ = in.getPayload();
+    phase_requests_ = in.get<std::array<Request, 2>>();
+    mailbox_.load(in);
 }
-
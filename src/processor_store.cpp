@@ -0,0 +1,80 @@
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "processor_store.hpp"
+
+void ProcessorStore::init(int num_ranks, std::size_t elements_per_rank)
+{
+    constexpr std::size_t keys_per_line = ALIGNMENT / sizeof(Key);
+    std::size_t stride = (elements_per_rank + keys_per_line - 1) / keys_per_line * keys_per_line;
+    std::size_t bytes = 2 * static_cast<std::size_t>(num_ranks) * stride * sizeof(Key);
+
+    // an input file mapped over plane 0 is dropped, anything else is reused
+    if (input_mapped_ || bytes > capacity_)
+        release();
+    num_ranks_ = num_ranks;
+    elements_ = elements_per_rank;
+    stride_ = stride;
+    bytes_ = bytes;
+    if (bytes_ == 0 || arena_)
+        return;
+    capacity_ = bytes_;
+
+#ifdef __linux__
+    if (bytes_ >= HUGE_PAGE_BYTES)
+    {
+        void *memory = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::runtime_error("Cannot map " + std::to_string(bytes_) + " bytes for processor data");
+        arena_ = static_cast<Key *>(memory);
+        mapped_ = true;
+#ifdef MADV_HUGEPAGE
+        huge_pages_ = madvise(memory, bytes_, MADV_HUGEPAGE) == 0;
+#endif
+        return;
+    }
+#endif
+    arena_ = static_cast<Key *>(::operator new(bytes_, std::align_val_t(ALIGNMENT)));
+}
+
+bool ProcessorStore::mapInput(int fd)
+{
+#ifdef __linux__
+    if (!mapped_ || stride_ != elements_)
+        return false;
+    // the last page may reach into plane 1: merge scratch, its contents do not matter
+    std::size_t plane_bytes = static_cast<std::size_t>(num_ranks_) * stride_ * sizeof(Key);
+    void *memory = mmap(arena_, plane_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Cannot map the input over the processor data");
+    input_mapped_ = true;
+    return true;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+void ProcessorStore::release()
+{
+    if (arena_)
+    {
+#ifdef __linux__
+        if (mapped_)
+            munmap(arena_, capacity_);
+        else
+#endif
+            ::operator delete(arena_, std::align_val_t(ALIGNMENT));
+    }
+    arena_ = nullptr;
+    bytes_ = 0;
+    capacity_ = 0;
+    mapped_ = false;
+    huge_pages_ = false;
+    input_mapped_ = false;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "sort_algorithm.hpp"
+#include "event_simulator.hpp"
+#include "processor.hpp"
+
+void SampleSort::start(EventSimulator &simulator, SimTick time)
+{
+    scheduleStep(simulator, time + SimTime::LOCAL_SORT_TIME, LOCAL_SORT);
+}
+
+void SampleSort::step(EventSimulator &simulator, const Event &event)
+{
+    MyMPI &mpi = simulator.getMPI();
+    const SimTick now = event.getTime();
+    const int p = num_processes_;
+
+    switch (event.getTag())
+    {
+    case LOCAL_SORT:
+        // every rank sorts its data and sends P - 1 regular samples to rank 0
+        for (int rank = 0; rank < p; ++rank)
+        {
+            Processor *processor = simulator.findProcessor(rank);
+            processor->sortLocalData();
+            DataView data = processor->getData();
+            std::vector<Key> samples;
+            for (int i = 1; i < p && !data.empty(); ++i)
+                samples.push_back(data[i * data.size() / p]);
+            processor->collectiveBuffer() = {std::move(samples)};
+        }
+        simulator.startCollective(mpi.gather(0), now, [this, &simulator](SimTick done)
+                                  { scheduleStep(simulator, done + SimTime::LOCAL_SORT_TIME, SPLITTERS); });
+        break;
+
+    case SPLITTERS:
+    {
+        // rank 0 sorts the P (P - 1) samples and picks every P-th as a splitter
+        Processor *root = simulator.findProcessor(0);
+        std::vector<Key> samples;
+        for (const auto &block : root->collectiveBuffer())
+            samples.insert(samples.end(), block.begin(), block.end());
+        std::sort(samples.begin(), samples.end());
+        std::vector<Key> splitters;
+        for (int i = 1; i < p && !samples.empty(); ++i)
+            splitters.push_back(samples[i * samples.size() / p]);
+
+        for (int rank = 0; rank < p; ++rank)
+            simulator.findProcessor(rank)->collectiveBuffer().clear();
+        root->collectiveBuffer() = {std::move(splitters)};
+        simulator.startCollective(mpi.bcast(0), now, [this, &simulator](SimTick done)
+                                  { scheduleStep(simulator, done, PARTITION); });
+        break;
+    }
+
+    case PARTITION:
+        // block j of a rank holds its keys in (splitter j - 1, splitter j], bound for rank j
+        for (int rank = 0; rank < p; ++rank)
+        {
+            Processor *processor = simulator.findProcessor(rank);
+            const std::vector<Key> splitters = processor->collectiveBuffer().empty()
+                                                   ? std::vector<Key>()
+                                                   : processor->collectiveBuffer()[0];
+            DataView data = processor->getData();
+            std::vector<std::vector<Key>> blocks(p);
+            const Key *first = data.begin();
+            for (int j = 0; j < p; ++j)
+            {
+                const Key *last = static_cast<std::size_t>(j) < splitters.size()
+                                      ? std::upper_bound(first, data.end(), splitters[j])
+                                      : data.end();
+                blocks[j].assign(first, last);
+                first = last;
+            }
+            processor->collectiveBuffer() = std::move(blocks);
+        }
+        simulator.startCollective(mpi.alltoall(), now, [this, &simulator](SimTick done)
+                                  { scheduleStep(simulator, done + SimTime::COMPARE_SPLIT_TIME, MERGE); });
+        break;
+
+    case MERGE:
+        // the P sorted runs a rank received make up its part of the result
+        for (int rank = 0; rank < p; ++rank)
+        {
+            Processor *processor = simulator.findProcessor(rank);
+            processor->setData(mergeRuns(processor->collectiveBuffer()), true);
+            processor->collectiveBuffer().clear();
+        }
+        break;
+    }
+}
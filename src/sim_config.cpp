@@ -0,0 +1,464 @@
+#include <stdexcept>
+#include <cerrno>
+#include <cstdlib>
+
+#include "sim_config.hpp"
+
+namespace
+{
+    // split "--name=value" into its name and value parts
+    bool splitOption(const std::string &arg, std::string &name, std::string &value)
+    {
+        if (arg.compare(0, 2, "--") != 0)
+            return false;
+        std::size_t eq = arg.find('=');
+        name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        return true;
+    }
+
+    int parseCount(const std::string &name, const std::string &value, long min_value)
+    {
+        char *end = nullptr;
+        long parsed = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || parsed < min_value || parsed > (1L << 30))
+            throw std::invalid_argument("--" + name + " needs an integer >= " + std::to_string(min_value));
+        return static_cast<int>(parsed);
+    }
+
+    double parseNumber(const std::string &name, const std::string &value, bool positive)
+    {
+        char *end = nullptr;
+        double parsed = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || parsed < 0 || (positive && parsed == 0))
+            throw std::invalid_argument("--" + name + " needs a " + (positive ? "positive" : "non-negative") +
+                                        " number");
+        return parsed;
+    }
+
+    // "AxBxC" -> {A, B, C}
+    std::vector<int> parseShape(const std::string &name, const std::string &value)
+    {
+        std::vector<int> shape;
+        std::size_t start = 0;
+        while (true)
+        {
+            std::size_t x = value.find('x', start);
+            shape.push_back(parseCount(name, value.substr(start, x == std::string::npos ? x : x - start), 1));
+            if (x == std::string::npos)
+                return shape;
+            start = x + 1;
+        }
+    }
+}
+
+bool parseSimOption(const std::string &arg, SimConfig &config)
+{
+    std::string name, value;
+    if (!splitOption(arg, name, value))
+        return false;
+
+    if (name == "queue")
+    {
+        if (value == "calendar")
+            config.queue_type = QueueType::CALENDAR;
+        else if (value == "heap")
+            config.queue_type = QueueType::BINARY_HEAP;
+        else
+            throw std::invalid_argument("--queue must be 'calendar' or 'heap'");
+        return true;
+    }
+
+    if (name == "events")
+    {
+        if (value == "lazy")
+            config.event_generation = EventGeneration::LAZY;
+        else if (value == "eager")
+            config.event_generation = EventGeneration::EAGER;
+        else
+            throw std::invalid_argument("--events must be 'lazy' or 'eager'");
+        return true;
+    }
+
+    if (name == "engine")
+    {
+        if (value == "sequential")
+            config.engine = EngineType::SEQUENTIAL;
+        else if (value == "conservative")
+            config.engine = EngineType::CONSERVATIVE;
+        else if (value == "timewarp")
+            config.engine = EngineType::TIME_WARP;
+        else if (value == "threads")
+            config.engine = EngineType::THREADS;
+        else
+            throw std::invalid_argument("--engine must be 'sequential', 'conservative', 'timewarp' or 'threads'");
+        return true;
+    }
+
+    if (name == "threads")
+    {
+        config.threads = parseCount(name, value, 0);
+        return true;
+    }
+
+    if (name == "tw-window")
+    {
+        config.time_warp_window = parseNumber(name, value, false);
+        return true;
+    }
+
+    if (name == "network")
+    {
+        for (NetworkModelType model : {NetworkModelType::FLAT, NetworkModelType::HOCKNEY, NetworkModelType::LOGGP,
+                                       NetworkModelType::LINKS})
+        {
+            if (value == networkModelName(model))
+            {
+                config.network.model = model;
+                return true;
+            }
+        }
+        throw std::invalid_argument("--network must be 'flat', 'hockney', 'loggp' or 'links'");
+    }
+
+    if (name == "topology")
+    {
+        // NAME or NAME:SHAPE, implies the link model
+        std::size_t colon = value.find(':');
+        std::string topology = value.substr(0, colon);
+        for (TopologyType type : {TopologyType::RING, TopologyType::TORUS_2D, TopologyType::TORUS_3D,
+                                  TopologyType::FAT_TREE, TopologyType::DRAGONFLY})
+        {
+            if (topology == topologyName(type))
+            {
+                config.network.model = NetworkModelType::LINKS;
+                config.network.topology = type;
+                config.network.shape.clear();
+                if (colon != std::string::npos)
+                    config.network.shape = parseShape(name, value.substr(colon + 1));
+                return true;
+            }
+        }
+        throw std::invalid_argument("--topology must be 'ring', 'torus2d', 'torus3d', 'fattree' or 'dragonfly', "
+                                    "optionally followed by :SHAPE");
+    }
+
+    if (name == "latency")
+    {
+        config.network.latency = parseNumber(name, value, false);
+        return true;
+    }
+
+    if (name == "bandwidth")
+    {
+        config.network.bandwidth = parseNumber(name, value, true);
+        return true;
+    }
+
+    if (name == "overhead")
+    {
+        config.network.overhead = parseNumber(name, value, false);
+        return true;
+    }
+
+    if (name == "gap")
+    {
+        config.network.gap = parseNumber(name, value, false);
+        return true;
+    }
+
+    if (name == "hop-latency")
+    {
+        config.network.hop_latency = parseNumber(name, value, false);
+        return true;
+    }
+
+    if (name == "record-bytes")
+    {
+        int bytes = parseCount(name, value, static_cast<long>(sizeof(Key)));
+        config.network.record_bytes = static_cast<std::size_t>(bytes);
+        return true;
+    }
+
+    if (name == "kernels")
+    {
+        if (value == "auto")
+            config.kernels = SortKernels::Isa::AUTO;
+        else if (value == "scalar")
+            config.kernels = SortKernels::Isa::SCALAR;
+        else if (value == "sse4.1")
+            config.kernels = SortKernels::Isa::SSE41;
+        else if (value == "avx2")
+            config.kernels = SortKernels::Isa::AVX2;
+        else if (value == "avx512")
+            config.kernels = SortKernels::Isa::AVX512;
+        else
+            throw std::invalid_argument("--kernels must be 'auto', 'scalar', 'sse4.1', 'avx2' or 'avx512'");
+        return true;
+    }
+
+    if (name == "early-stop")
+    {
+        config.early_termination = true;
+        return true;
+    }
+
+    if (name == "trace")
+    {
+        if (value.empty())
+            throw std::invalid_argument("--trace needs a file name or 'none'");
+        config.trace_file = value == "none" ? "" : value;
+        return true;
+    }
+
+    if (name == "timeline")
+    {
+        if (value.empty())
+            throw std::invalid_argument("--timeline needs a file name");
+        config.timeline_file = value;
+        return true;
+    }
+
+    if (name == "dist")
+    {
+        WorkloadConfig workload = parseWorkload(value);
+        config.workload.distribution = workload.distribution;
+        config.workload.parameter = workload.parameter;
+        return true;
+    }
+
+    if (name == "seed")
+    {
+        char *end = nullptr;
+        errno = 0;
+        unsigned long long seed = std::strtoull(value.c_str(), &end, 10);
+        if (value.empty() || value[0] == '-' || *end != '\0' || errno == ERANGE)
+            throw std::invalid_argument("--seed needs an integer in [0, 2^64)");
+        config.workload.seed = seed;
+        config.workload.seeded = true;
+        return true;
+    }
+
+    if (name == "input" || name == "output")
+    {
+        if (value.empty())
+            throw std::invalid_argument("--" + name + " needs a file name");
+        (name == "input" ? config.input_file : config.output_file) = value;
+        return true;
+    }
+
+    if (name == "checkpoint")
+    {
+        if (value.empty())
+            throw std::invalid_argument("--checkpoint needs a file name");
+        config.checkpoint_file = value;
+        return true;
+    }
+
+    if (name == "phase-delay")
+    {
+        config.phase_delay = parseNumber(name, value, false);
+        return true;
+    }
+
+    if (name == "checkpoint-every")
+    {
+        config.checkpoint_interval = parseNumber(name, value, true);
+        return true;
+    }
+
+    if (name == "resume")
+    {
+        if (value.empty())
+            throw std::invalid_argument("--resume needs a checkpoint file");
+        config.resume_file = value;
+        return true;
+    }
+
+    if (name == "sort")
+    {
+        for (SortAlgorithmType type : {SortAlgorithmType::ODD_EVEN, SortAlgorithmType::BITONIC,
+                                       SortAlgorithmType::SAMPLE, SortAlgorithmType::HYPERQUICK})
+        {
+            if (value == sortAlgorithmName(type))
+            {
+                config.sort_algorithm = type;
+                return true;
+            }
+        }
+        throw std::invalid_argument("--sort must be 'odd-even', 'bitonic', 'sample' or 'hyperquick'");
+    }
+
+    if (name == "matching")
+    {
+        if (value == "hashed")
+            config.matching = MatchingMode::HASHED;
+        else if (value == "linear")
+            config.matching = MatchingMode::LINEAR;
+        else
+            throw std::invalid_argument("--matching must be 'hashed' or 'linear'");
+        return true;
+    }
+
+    if (name == "compare")
+    {
+        config.compare_sorts = true;
+        return true;
+    }
+
+    if (name == "batch")
+    {
+        if (value.empty())
+            throw std::invalid_argument("--batch needs a file name");
+        config.batch_file = value;
+        return true;
+    }
+
+    if (name == "jobs")
+    {
+        config.jobs = parseCount(name, value, 0);
+        return true;
+    }
+
+    if (name == "collective")
+    {
+        using Collectives::Op;
+        static const struct { const char *name; Op op; bool varying; } ops[] = {
+            {"bcast", Op::BCAST, false},         {"scatter", Op::SCATTER, false}, {"scatterv", Op::SCATTER, true},
+            {"gather", Op::GATHER, false},       {"gatherv", Op::GATHER, true},   {"allreduce", Op::ALLREDUCE, false},
+            {"alltoall", Op::ALLTOALL, false},   {"alltoallv", Op::ALLTOALL, true},
+        };
+        for (const auto &entry : ops)
+        {
+            if (value == entry.name)
+            {
+                config.run_collective = true;
+                config.collective = entry.op;
+                config.collective_varying = entry.varying;
+                return true;
+            }
+        }
+        throw std::invalid_argument("--collective must be 'bcast', 'scatter', 'scatterv', 'gather', 'gatherv', "
+                                    "'allreduce', 'alltoall' or 'alltoallv'");
+    }
+
+    if (name == "coll-algo")
+    {
+        using Collectives::Algorithm;
+        for (Algorithm algorithm : {Algorithm::AUTO, Algorithm::LINEAR, Algorithm::BINOMIAL,
+                                    Algorithm::RECURSIVE_DOUBLING, Algorithm::RING, Algorithm::BRUCK})
+        {
+            if (value == Collectives::algorithmName(algorithm))
+            {
+                config.collective_algorithm = algorithm;
+                return true;
+            }
+        }
+        throw std::invalid_argument("--coll-algo must be 'auto', 'linear', 'binomial', 'recursive-doubling', "
+                                    "'ring' or 'bruck'");
+    }
+
+    if (name == "reduce")
+    {
+        using Collectives::ReduceOp;
+        for (ReduceOp reduce : {ReduceOp::SUM, ReduceOp::MIN, ReduceOp::MAX})
+        {
+            if (value == Collectives::reduceOpName(reduce))
+            {
+                config.collective_reduce = reduce;
+                return true;
+            }
+        }
+        throw std::invalid_argument("--reduce must be 'sum', 'min' or 'max'");
+    }
+
+    if (name == "root")
+    {
+        config.collective_root = parseCount(name, value, 0);
+        return true;
+    }
+
+    if (name == "quiet")
+    {
+        config.verbose = false;
+        return true;
+    }
+
+    return false;
+}
+
+std::string simOptionsUsage()
+{
+    return "  --queue=calendar|heap   pending event set implementation (default: calendar)\n"
+           "  --events=lazy|eager     schedule phases as they are reached or all at start (default: lazy)\n"
+           "  --engine=sequential|conservative|timewarp|threads\n"
+           "                          event loop: conservative = parallel time windows,\n"
+           "                          timewarp = optimistic parallel with rollback, threads = sequential\n"
+           "                          prediction, then the compare-split sort on real threads, timings\n"
+           "                          per phase next to each other (default: sequential)\n"
+           "  --threads=N             worker threads of parallel engines and real threads; fewer than\n"
+           "                          ranks serve several ranks each (default: 0 = all cores)\n"
+           "  --tw-window=T           timewarp: run no event later than GVT + T (default: 100, 0 = unbounded)\n"
+           "  --network=flat|hockney|loggp|links\n"
+           "                          message cost model: flat = 2 units per message, hockney =\n"
+           "                          latency + bytes / bandwidth, loggp = L + 2o + (bytes - 1) G,\n"
+           "                          links = routed over --topology with link contention (default: hockney)\n"
+           "  --topology=ring|torus2d|torus3d|fattree|dragonfly[:SHAPE]\n"
+           "                          link model topology; SHAPE: torus AxB[xC], fattree hosts per leaf,\n"
+           "                          dragonfly HOSTSxROUTERS per group (default: derived from P)\n"
+           "  --latency=T             hockney alpha, loggp L, links per-message latency (default: 2)\n"
+           "  --bandwidth=B           bytes per time unit, of every link for links (default: 4000)\n"
+           "  --overhead=O --gap=G    loggp o and g (default: 0.5 and 0.5)\n"
+           "  --hop-latency=H         links: latency per link traversed (default: 0.05)\n"
+           "  --record-bytes=R        every key stands for an R-byte record: messages cost and count\n"
+           "                          R bytes per element (default: the key's size)\n"
+           "  --phase-delay=T         fixed slot between the starts of consecutive compare-split phases;\n"
+           "                          0 = a phase starts as soon as its message and the previous\n"
+           "                          compare-split allow (default: 50)\n"
+           "  --early-stop            allreduce after every even/odd phase pair, stop when nothing\n"
+           "                          changed (sequential and conservative engines)\n"
+           "  --kernels=auto|scalar|sse4.1|avx2|avx512\n"
+           "                          sort / merge kernels; scalar = std::sort and scalar merge (default: auto)\n"
+           "  --trace=FILE|none       binary event trace, convert with trace2txt (default: event_trace.bin)\n"
+           "  --timeline=FILE         per-rank send / recv-wait / compare-split / idle spans and the\n"
+           "                          critical path as Chrome trace JSON for Perfetto, with a report\n"
+           "                          (compare-split sorts; sequential and threads engines)\n"
+           "  --dist=uniform|full|zipf[:S]|duplicates[:D]|sorted|reversed|nearly-sorted[:K]|runs[:L]\n"
+           "                          generated input: uniform in the key type's default range or over\n"
+           "                          all its values, Zipf with exponent S (1), D distinct values (16),\n"
+           "                          sorted or reversed across ranks, sorted with K pairs swapped\n"
+           "                          (1% of P x N), ascending runs of L keys per rank (N)\n"
+           "                          (default: uniform)\n"
+           "  --seed=S                seed of the generated input; the same seed, P, N and --dist give\n"
+           "                          the same keys (default: a new seed every run, printed)\n"
+           "  --input=FILE            sort the first P x N native keys of binary FILE, rank 0 first,\n"
+           "                          instead of random data (mapped; zero-copy from 1 MiB with N\n"
+           "                          keys filling whole 64-byte lines)\n"
+           "  --output=FILE           write the sorted data to FILE, rank by rank, as native keys\n"
+           "  --checkpoint=FILE       save the whole simulation state to FILE every --checkpoint-every\n"
+           "                          simulated time units (sequential engine, compare-split sorts)\n"
+           "  --checkpoint-every=T    simulated time between checkpoints (default: 10000)\n"
+           "  --resume=FILE           continue the run saved in checkpoint FILE; give the same P, N\n"
+           "                          and options as the run that wrote it\n"
+           "  --sort=odd-even|bitonic|sample|hyperquick\n"
+           "                          parallel sort; bitonic and hyperquick need a power-of-two P,\n"
+           "                          sample and hyperquick the sequential engine (default: odd-even)\n"
+           "  --matching=hashed|linear\n"
+           "                          receive / unexpected message queues: hashed by (source, tag)\n"
+           "                          or searched front to back (default: hashed)\n"
+           "  --compare               run every sort on the same input and print simulated time,\n"
+           "                          messages and bytes of each (no trace)\n"
+           "  --batch=FILE            run the simulations of FILE, one per line: P N [options], on top of\n"
+           "                          the command line's options; quiet, no trace unless a line asks\n"
+           "  --jobs=N                --batch: simulations run at once (default: 0 = all cores)\n"
+           "  --collective=bcast|scatter|scatterv|gather|gatherv|allreduce|alltoall|alltoallv\n"
+           "                          run one collective over each rank's data instead of the sort\n"
+           "                          (v variants: blocks of random sizes; sequential engine)\n"
+           "  --coll-algo=auto|linear|binomial|recursive-doubling|ring|bruck\n"
+           "                          collective algorithm (default: auto = binomial, allreduce:\n"
+           "                          recursive-doubling, alltoall: bruck)\n"
+           "  --reduce=sum|min|max    allreduce operation (default: sum)\n"
+           "  --root=R                root of bcast / scatter / gather (default: 0)\n"
+           "  --quiet                 no per-event / per-element output (implied for per-event\n"
+           "                          output by parallel engines)\n";
+}
@@ -0,0 +1,186 @@
+#include <cstdio>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "snapshot.hpp"
+
+namespace
+{
+    constexpr std::size_t DATA_ALIGNMENT = 64;
+}
+
+// ------------------------------------------------------------ SnapshotWriter
+
+void SnapshotWriter::putString(const std::string &value)
+{
+    put<std::uint64_t>(value.size());
+    state_.insert(state_.end(), value.begin(), value.end());
+}
+
+void SnapshotWriter::putKeys(const Key *data, std::size_t count)
+{
+    if (count == 0)
+        return;
+    data_.push_back({data, count});
+    data_keys_ += count;
+}
+
+void SnapshotWriter::putPayload(const Payload &payload)
+{
+    // -1: no buffer; a new index: the buffer follows; else the buffer of an earlier payload
+    if (payload.data() == nullptr)
+    {
+        put<std::int64_t>(-1);
+        return;
+    }
+    auto [entry, added] = payloads_.emplace(payload.data(), static_cast<std::int64_t>(payloads_.size()));
+    put<std::int64_t>(entry->second);
+    if (!added)
+        return;
+    put<std::uint64_t>(payload.size());
+    put<bool>(payload.isSorted());
+    putKeys(payload.data(), payload.size());
+}
+
+void SnapshotWriter::putEvent(const Event &event)
+{
+    put<SimTick>(event.getTime());
+    put<std::uint64_t>(event.getSequence());
+    put<std::int32_t>(static_cast<std::int32_t>(event.getType()));
+    put<std::int32_t>(event.getSourceRank());
+    put<std::int32_t>(event.getDestRank());
+    put<std::int32_t>(event.getTag());
+    putPayload(event.getData());
+}
+
+void SnapshotWriter::write(const std::string &path, int num_processes, int elements_per_processor) const
+{
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.ticks_per_unit = TICKS_PER_UNIT;
+    header.num_processes = num_processes;
+    header.elements_per_processor = elements_per_processor;
+    header.state_bytes = state_.size();
+    header.data_offset = (sizeof(header) + state_.size() + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+    header.data_keys = data_keys_;
+    header.key_bytes = sizeof(Key);
+    std::size_t bytes = header.data_offset + data_keys_ * sizeof(Key);
+
+    // the arrays are copied once, from the simulation into the page cache
+    const std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create checkpoint file " + temporary);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Cannot size checkpoint file " + temporary + " to " + std::to_string(bytes) + " bytes");
+    }
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Cannot map checkpoint file " + temporary);
+
+    char *file = static_cast<char *>(memory);
+    std::memcpy(file, &header, sizeof(header));
+    if (!state_.empty())
+        std::memcpy(file + sizeof(header), state_.data(), state_.size());
+    Key *data = reinterpret_cast<Key *>(file + header.data_offset);
+    for (const Keys &keys : data_)
+    {
+        std::memcpy(data, keys.data, keys.count * sizeof(Key));
+        data += keys.count;
+    }
+    bool synced = msync(memory, bytes, MS_SYNC) == 0;
+    munmap(memory, bytes);
+    if (!synced)
+        throw std::runtime_error("Error writing checkpoint file " + temporary);
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Cannot rename " + temporary + " to " + path);
+}
+
+// ------------------------------------------------------------ SnapshotReader
+
+SnapshotReader::SnapshotReader(const std::string &path, PayloadPool &pool) : file_(path), pool_(pool)
+{
+    if (file_.size() < sizeof(SnapshotHeader) ||
+        std::memcmp(header().magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        throw std::runtime_error(path + " is not a checkpoint file");
+
+    const SnapshotHeader &head = header();
+    if (head.version != SNAPSHOT_VERSION || head.header_size != sizeof(SnapshotHeader))
+        throw std::runtime_error("Checkpoint file " + path + " is of version " + std::to_string(head.version) +
+                                 ", this build reads version " + std::to_string(SNAPSHOT_VERSION));
+    if (head.ticks_per_unit != TICKS_PER_UNIT)
+        throw std::runtime_error("Checkpoint file " + path + " was written with " +
+                                 std::to_string(head.ticks_per_unit) + " ticks per time unit, not " +
+                                 std::to_string(TICKS_PER_UNIT));
+    if (head.key_bytes != sizeof(Key))
+        throw std::runtime_error("Checkpoint file " + path + " holds " + std::to_string(head.key_bytes) +
+                                 "-byte keys, this build sorts " + KEY_TYPE_NAME);
+    if (head.data_offset < sizeof(SnapshotHeader) + head.state_bytes ||
+        head.data_offset + head.data_keys * sizeof(Key) != file_.size())
+        throw std::runtime_error("Checkpoint file " + path + " is truncated");
+}
+
+const char *SnapshotReader::take(std::size_t bytes)
+{
+    if (bytes > header().state_bytes - state_pos_)
+        throw std::runtime_error("Checkpoint file " + file_.path() + " ends in the middle of its state");
+    const char *at = file_.data() + sizeof(SnapshotHeader) + state_pos_;
+    state_pos_ += bytes;
+    return at;
+}
+
+std::string SnapshotReader::getString()
+{
+    std::size_t size = get<std::uint64_t>();
+    return std::string(take(size), size);
+}
+
+const Key *SnapshotReader::getKeys(std::size_t count)
+{
+    if (count > header().data_keys - data_pos_)
+        throw std::runtime_error("Checkpoint file " + file_.path() + " ends in the middle of its data");
+    const Key *at = reinterpret_cast<const Key *>(file_.data() + header().data_offset) + data_pos_;
+    data_pos_ += count;
+    return at;
+}
+
+Payload SnapshotReader::getPayload()
+{
+    std::int64_t index = get<std::int64_t>();
+    if (index < 0)
+        return Payload();
+    if (static_cast<std::size_t>(index) < payloads_.size())
+        return payloads_[index];
+    if (static_cast<std::size_t>(index) != payloads_.size())
+        throw std::runtime_error("Checkpoint file " + file_.path() + " refers to a payload it does not hold");
+
+    std::size_t size = get<std::uint64_t>();
+    bool sorted = get<bool>();
+    Payload payload = pool_.copyOf(getKeys(size), size);
+    payload.setSorted(sorted);
+    payloads_.push_back(payload);
+    return payload;
+}
+
+Event SnapshotReader::getEvent()
+{
+    SimTick time = get<SimTick>();
+    std::uint64_t sequence = get<std::uint64_t>();
+    std::int32_t type = get<std::int32_t>();
+    std::int32_t source = get<std::int32_t>();
+    std::int32_t dest = get<std::int32_t>();
+    std::int32_t tag = get<std::int32_t>();
+    if (type < 0 || type >= EVENT_TYPE_COUNT)
+        throw std::runtime_error("Checkpoint file " + file_.path() + " holds an event of unknown type " + std::to_string(type));
+    Event event(time, static_cast<EventType>(type), source, dest, getPayload(), tag);
+    event.setSequence(sequence);
+    return event;
+}
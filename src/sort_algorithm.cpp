@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "sort_algorithm.hpp"
+#include "event_simulator.hpp"
+
+int SortAlgorithm::partner(int rank, int phase) const
+{
+    (void)rank;
+    (void)phase;
+    return -1;
+}
+
+void SortAlgorithm::start(EventSimulator &simulator, SimTick time)
+{
+    (void)simulator;
+    (void)time;
+    throw std::runtime_error(std::string(sortAlgorithmTitle(type())) + " is scheduled as compare-split phases");
+}
+
+void SortAlgorithm::step(EventSimulator &simulator, const Event &event)
+{
+    (void)simulator;
+    (void)event;
+    throw std::runtime_error(std::string(sortAlgorithmTitle(type())) + " has no sort steps");
+}
+
+void SortAlgorithm::scheduleStep(EventSimulator &simulator, SimTick time, int step) const
+{
+    simulator.scheduleEvent(Event(time, EventType::SORT_STEP, 0, 0, Payload(), step));
+}
+
+std::vector<Key> SortAlgorithm::mergeRuns(std::vector<std::vector<Key>> &runs)
+{
+    // pairwise, like the levels of a merge sort: log(runs) passes over the data
+    while (runs.size() > 1)
+    {
+        std::vector<std::vector<Key>> merged((runs.size() + 1) / 2);
+        for (std::size_t i = 0; i + 1 < runs.size(); i += 2)
+        {
+            merged[i / 2].resize(runs[i].size() + runs[i + 1].size());
+            std::merge(runs[i].begin(), runs[i].end(), runs[i + 1].begin(), runs[i + 1].end(), merged[i / 2].begin());
+        }
+        if (runs.size() % 2 != 0)
+            merged.back() = std::move(runs.back());
+        runs = std::move(merged);
+    }
+    return runs.empty() ? std::vector<Key>() : std::move(runs[0]);
+}
+
+std::unique_ptr<SortAlgorithm> makeSortAlgorithm(SortAlgorithmType type, int num_processes)
+{
+    switch (type)
+    {
+    case SortAlgorithmType::ODD_EVEN:
+        break;
+    case SortAlgorithmType::BITONIC:
+        return std::make_unique<BitonicSort>(num_processes);
+    case SortAlgorithmType::SAMPLE:
+        return std::make_unique<SampleSort>(num_processes);
+    case SortAlgorithmType::HYPERQUICK:
+        return std::make_unique<HyperQuickSort>(num_processes);
+    }
+    return std::make_unique<OddEvenSort>(num_processes);
+}
+
+const char *sortAlgorithmName(SortAlgorithmType type)
+{
+    switch (type)
+    {
+    case SortAlgorithmType::ODD_EVEN:
+        return "odd-even";
+    case SortAlgorithmType::BITONIC:
+        return "bitonic";
+    case SortAlgorithmType::SAMPLE:
+        return "sample";
+    case SortAlgorithmType::HYPERQUICK:
+        return "hyperquick";
+    }
+    return "unknown";
+}
+
+const char *sortAlgorithmTitle(SortAlgorithmType type)
+{
+    switch (type)
+    {
+    case SortAlgorithmType::ODD_EVEN:
+        return "Odd-Even Sort";
+    case SortAlgorithmType::BITONIC:
+        return "Bitonic Sort";
+    case SortAlgorithmType::SAMPLE:
+        return "Sample Sort";
+    case SortAlgorithmType::HYPERQUICK:
+        return "Hyperquicksort";
+    }
+    return "Unknown Sort";
+}
+
+int OddEvenSort::partner(int rank, int phase) const
+{
+    // odd phases pair (0,1), (2,3), ...; even phases pair (1,2), (3,4), ...
+    bool pairs_up = (phase % 2 != 0) == (rank % 2 == 0);
+    int neighbor = pairs_up ? rank + 1 : rank - 1;
+    return neighbor >= 0 && neighbor < num_processes_ ? neighbor : -1;
+}
+
+BitonicSort::BitonicSort(int num_processes) : SortAlgorithm(num_processes)
+{
+    int dimensions = 0;
+    while ((1 << dimensions) < num_processes)
+        ++dimensions;
+    if ((1 << dimensions) != num_processes)
+        throw std::runtime_error("Bitonic sort needs a power-of-two number of processors");
+
+    // stage s merges bitonic sequences of 2^(s + 1) ranks, partners 2^s, ..., 1 apart
+    for (int stage = 0; stage < dimensions; ++stage)
+    {
+        for (int bit = stage; bit >= 0; --bit)
+        {
+            stage_.push_back(stage);
+            bit_.push_back(bit);
+        }
+    }
+}
+
+bool BitonicSort::keepsLow(int rank, int phase) const
+{
+    // sequences alternate between ascending and descending; the last stage is all ascending
+    bool ascending = ((rank >> (stage_[phase] + 1)) & 1) == 0;
+    return (rank < partner(rank, phase)) == ascending;
+}
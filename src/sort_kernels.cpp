@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "sort_kernels.hpp"
+#include "simd_merge.hpp"
+
+namespace
+{
+    using SortKernels::Isa;
+
+    // below this std::sort beats the four counting passes of the radix sort
+    constexpr std::size_t RADIX_SORT_MIN = 512;
+
+    // Unsigned bit pattern of a key that orders like the key itself
+    template <class T>
+    struct RadixKey;
+
+    template <>
+    struct RadixKey<int>
+    {
+        using Bits = uint32_t;
+        static Bits of(int value) { return static_cast<Bits>(value) ^ 0x80000000u; }
+    };
+
+    template <>
+    struct RadixKey<std::int64_t>
+    {
+        using Bits = uint64_t;
+        static Bits of(std::int64_t value) { return static_cast<Bits>(value) ^ 0x8000000000000000ull; }
+    };
+
+    template <>
+    struct RadixKey<float>
+    {
+        // negative floats have every bit flipped, positive ones only the sign
+        // (-0.0 sorts just below 0.0, NaNs at the ends)
+        using Bits = uint32_t;
+        static Bits of(float value)
+        {
+            Bits bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+        }
+    };
+
+    // LSD radix sort, one pass per 8-bit digit of the key's bit pattern;
+    // digits shared by every element are skipped
+    template <class T>
+    void radixSort(T *data, T *scratch, std::size_t n)
+    {
+        using Key = RadixKey<T>;
+        constexpr int DIGITS = sizeof(typename Key::Bits);
+        std::size_t counts[DIGITS][256] = {};
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            typename Key::Bits key = Key::of(data[i]);
+            for (int d = 0; d < DIGITS; ++d)
+                ++counts[d][(key >> (8 * d)) & 0xFF];
+        }
+
+        T *src = data, *dst = scratch;
+        typename Key::Bits first = Key::of(data[0]);
+        for (int d = 0; d < DIGITS; ++d)
+        {
+            const int shift = 8 * d;
+            if (counts[d][(first >> shift) & 0xFF] == n)
+                continue;
+
+            std::size_t offset[256];
+            std::size_t sum = 0;
+            for (int digit = 0; digit < 256; ++digit)
+            {
+                offset[digit] = sum;
+                sum += counts[d][digit];
+            }
+            for (std::size_t i = 0; i < n; ++i)
+                dst[offset[(Key::of(src[i]) >> shift) & 0xFF]++] = src[i];
+            std::swap(src, dst);
+        }
+        if (src != data)
+            std::memcpy(data, src, n * sizeof(T));
+    }
+
+    template <class T>
+    void sortKeys(Isa isa, T *data, T *scratch, std::size_t n)
+    {
+        // the radix sort is plain C++; it comes with the vector kernels so that
+        // "scalar" stays the original std::sort for comparison
+        if (isa == Isa::SCALAR || n < RADIX_SORT_MIN)
+            std::sort(data, data + n);
+        else
+            radixSort(data, scratch, n);
+    }
+
+    template <class T>
+    void scalarMergeLow(const T *a, const T *b, T *out, std::size_t n)
+    {
+        std::size_t i = 0, j = 0;
+        for (std::size_t k = 0; k < n; ++k)
+            out[k] = (a[i] <= b[j]) ? a[i++] : b[j++];
+    }
+
+    template <class T>
+    void scalarMergeHigh(const T *a, const T *b, T *out, std::size_t n)
+    {
+        std::size_t i = n, j = n;
+        for (std::size_t k = n; k-- > 0;)
+            out[k] = (a[i - 1] > b[j - 1]) ? a[--i] : b[--j];
+    }
+
+    void merge(Isa isa, const int *a, const int *b, int *out, std::size_t n, bool high)
+    {
+        switch (isa)
+        {
+#ifdef SORT_KERNELS_X86
+        case Isa::AVX512:
+            SortKernels::detail::mergeAvx512(a, b, out, n, high);
+            return;
+        case Isa::AVX2:
+            SortKernels::detail::mergeAvx2(a, b, out, n, high);
+            return;
+        case Isa::SSE41:
+            SortKernels::detail::mergeSse41(a, b, out, n, high);
+            return;
+#endif
+        default:
+            if (high)
+                scalarMergeHigh(a, b, out, n);
+            else
+                scalarMergeLow(a, b, out, n);
+        }
+    }
+}
+
+SortKernels::Isa SortKernels::detectIsa()
+{
+#ifdef SORT_KERNELS_X86
+    if (__builtin_cpu_supports("avx512f"))
+        return Isa::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return Isa::AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return Isa::SSE41;
+#endif
+    return Isa::SCALAR;
+}
+
+bool SortKernels::isSupported(Isa isa)
+{
+    // instruction sets are ordered, each one implies those before it
+    return isa == Isa::AUTO || static_cast<int>(isa) <= static_cast<int>(detectIsa());
+}
+
+const char *SortKernels::isaName(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::AUTO:
+        return "auto";
+    case Isa::SCALAR:
+        return "scalar";
+    case Isa::SSE41:
+        return "sse4.1";
+    case Isa::AVX2:
+        return "avx2";
+    case Isa::AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+SortKernels::Isa SortKernels::resolve(Isa isa)
+{
+    if (!isSupported(isa))
+        throw std::runtime_error(std::string("Sort kernels '") + isaName(isa) + "' are not supported on this machine");
+    return isa == Isa::AUTO ? detectIsa() : isa;
+}
+
+void SortKernels::sort(Isa isa, int *data, int *scratch, std::size_t n)
+{
+    sortKeys(isa, data, scratch, n);
+}
+
+void SortKernels::sort(Isa isa, std::int64_t *data, std::int64_t *scratch, std::size_t n)
+{
+    sortKeys(isa, data, scratch, n);
+}
+
+void SortKernels::sort(Isa isa, float *data, float *scratch, std::size_t n)
+{
+    sortKeys(isa, data, scratch, n);
+}
+
+void SortKernels::mergeLow(Isa isa, const int *a, const int *b, int *out, std::size_t n)
+{
+    merge(isa == Isa::AUTO ? detectIsa() : isa, a, b, out, n, false);
+}
+
+void SortKernels::mergeHigh(Isa isa, const int *a, const int *b, int *out, std::size_t n)
+{
+    merge(isa == Isa::AUTO ? detectIsa() : isa, a, b, out, n, true);
+}
+
+// no vector merges for wider or floating keys yet
+void SortKernels::mergeLow(Isa, const std::int64_t *a, const std::int64_t *b, std::int64_t *out, std::size_t n)
+{
+    scalarMergeLow(a, b, out, n);
+}
+
+void SortKernels::mergeHigh(Isa, const std::int64_t *a, const std::int64_t *b, std::int64_t *out, std::size_t n)
+{
+    scalarMergeHigh(a, b, out, n);
+}
+
+void SortKernels::mergeLow(Isa, const float *a, const float *b, float *out, std::size_t n)
+{
+    scalarMergeLow(a, b, out, n);
+}
+
+void SortKernels::mergeHigh(Isa, const float *a, const float *b, float *out, std::size_t n)
+{
+    scalarMergeHigh(a, b, out, n);
+}
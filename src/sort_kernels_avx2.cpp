@@ -0,0 +1,45 @@
+// Compiled with -mavx2; only called after a CPUID check
+#include <immintrin.h>
+
+#include "simd_merge.hpp"
+
+namespace
+{
+    struct Avx2
+    {
+        using Reg = __m256i;
+        static constexpr std::size_t WIDTH = 8;
+
+        static Reg load(const int *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+        static void store(int *p, Reg r) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), r); }
+        static Reg reverse(Reg r) { return _mm256_permutevar8x32_epi32(r, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+        static Reg invert(Reg r) { return _mm256_xor_si256(r, _mm256_set1_epi32(-1)); }
+
+        // sort a bitonic register: compare-exchange at distance 4, 2, then 1
+        static Reg bitonic(Reg v)
+        {
+            Reg t = _mm256_permute2x128_si256(v, v, 1);
+            v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xF0);
+            t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+            v = _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xCC);
+            t = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm256_blend_epi32(_mm256_min_epi32(v, t), _mm256_max_epi32(v, t), 0xAA);
+        }
+
+        static void network(Reg &a, Reg &b)
+        {
+            Reg r = reverse(b);
+            Reg lo = _mm256_min_epi32(a, r), hi = _mm256_max_epi32(a, r);
+            a = bitonic(lo);
+            b = bitonic(hi);
+        }
+    };
+}
+
+void SortKernels::detail::mergeAvx2(const int *a, const int *b, int *out, std::size_t n, bool high)
+{
+    if (high)
+        mergeRuns<Avx2, true>(a, b, out, n);
+    else
+        mergeRuns<Avx2, false>(a, b, out, n);
+}
@@ -0,0 +1,50 @@
+// Compiled with -mavx512f; only called after a CPUID check
+#include <immintrin.h>
+
+#include "simd_merge.hpp"
+
+namespace
+{
+    struct Avx512
+    {
+        using Reg = __m512i;
+        static constexpr std::size_t WIDTH = 16;
+
+        static Reg load(const int *p) { return _mm512_loadu_si512(p); }
+        static void store(int *p, Reg r) { _mm512_storeu_si512(p, r); }
+        static Reg reverse(Reg r)
+        {
+            return _mm512_permutexvar_epi32(_mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), r);
+        }
+        static Reg invert(Reg r) { return _mm512_xor_si512(r, _mm512_set1_epi32(-1)); }
+
+        // sort a bitonic register: compare-exchange at distance 8, 4, 2, then 1
+        static Reg bitonic(Reg v)
+        {
+            Reg t = _mm512_shuffle_i32x4(v, v, _MM_SHUFFLE(1, 0, 3, 2));
+            v = _mm512_mask_blend_epi32(0xFF00, _mm512_min_epi32(v, t), _mm512_max_epi32(v, t));
+            t = _mm512_shuffle_i32x4(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm512_mask_blend_epi32(0xF0F0, _mm512_min_epi32(v, t), _mm512_max_epi32(v, t));
+            t = _mm512_shuffle_epi32(v, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm512_mask_blend_epi32(0xCCCC, _mm512_min_epi32(v, t), _mm512_max_epi32(v, t));
+            t = _mm512_shuffle_epi32(v, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm512_mask_blend_epi32(0xAAAA, _mm512_min_epi32(v, t), _mm512_max_epi32(v, t));
+        }
+
+        static void network(Reg &a, Reg &b)
+        {
+            Reg r = reverse(b);
+            Reg lo = _mm512_min_epi32(a, r), hi = _mm512_max_epi32(a, r);
+            a = bitonic(lo);
+            b = bitonic(hi);
+        }
+    };
+}
+
+void SortKernels::detail::mergeAvx512(const int *a, const int *b, int *out, std::size_t n, bool high)
+{
+    if (high)
+        mergeRuns<Avx512, true>(a, b, out, n);
+    else
+        mergeRuns<Avx512, false>(a, b, out, n);
+}
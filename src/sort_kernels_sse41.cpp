@@ -0,0 +1,43 @@
+// Compiled with -msse4.1; only called after a CPUID check
+#include <smmintrin.h>
+
+#include "simd_merge.hpp"
+
+namespace
+{
+    struct Sse41
+    {
+        using Reg = __m128i;
+        static constexpr std::size_t WIDTH = 4;
+
+        static Reg load(const int *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+        static void store(int *p, Reg r) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), r); }
+        static Reg reverse(Reg r) { return _mm_shuffle_epi32(r, _MM_SHUFFLE(0, 1, 2, 3)); }
+        static Reg invert(Reg r) { return _mm_xor_si128(r, _mm_set1_epi32(-1)); }
+
+        // sort a bitonic register: compare-exchange at distance 2, then 1
+        static Reg bitonic(Reg v)
+        {
+            Reg t = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+            v = _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xF0);
+            t = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+            return _mm_blend_epi16(_mm_min_epi32(v, t), _mm_max_epi32(v, t), 0xCC);
+        }
+
+        static void network(Reg &a, Reg &b)
+        {
+            Reg r = reverse(b);
+            Reg lo = _mm_min_epi32(a, r), hi = _mm_max_epi32(a, r);
+            a = bitonic(lo);
+            b = bitonic(hi);
+        }
+    };
+}
+
+void SortKernels::detail::mergeSse41(const int *a, const int *b, int *out, std::size_t n, bool high)
+{
+    if (high)
+        mergeRuns<Sse41, true>(a, b, out, n);
+    else
+        mergeRuns<Sse41, false>(a, b, out, n);
+}
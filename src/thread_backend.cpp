@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "thread_backend.hpp"
+#include "barrier.hpp"
+#include "sort_kernels.hpp"
+
+namespace
+{
+    long long steadyNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+}
+
+ThreadBackend::ThreadBackend(const SortAlgorithm &algorithm, int num_ranks, int threads, SortKernels::Isa kernels)
+    : num_ranks_(num_ranks), kernels_(SortKernels::resolve(kernels)), phases_(algorithm.phases()), ranks_(num_ranks)
+{
+    if (threads <= 0)
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    workers_ = std::max(1, std::min(threads, num_ranks));
+
+    // one mailbox per directed pair of partners, numbered as they come up
+    std::unordered_map<long long, int> mailbox_of;
+    auto mailbox = [&](int source, int dest) {
+        return mailbox_of.emplace(static_cast<long long>(source) * num_ranks + dest, static_cast<int>(mailbox_of.size()))
+            .first->second;
+    };
+    for (int rank = 0; rank < num_ranks; ++rank)
+    {
+        Rank &r = ranks_[rank];
+        for (int phase = 0; phase < phases_; ++phase)
+        {
+            int partner = algorithm.partner(rank, phase);
+            if (partner < 0)
+                continue;
+            r.steps.push_back(
+                {phase, partner, algorithm.keepsLow(rank, phase), mailbox(partner, rank), mailbox(rank, partner)});
+        }
+        r.times.resize(r.steps.size());
+    }
+    mailboxes_ = std::make_unique<Mailbox[]>(mailbox_of.size());
+}
+
+double ThreadBackend::now() const
+{
+    return (steadyNanoseconds() - start_) * 1e-9;
+}
+
+ThreadRunStats ThreadBackend::run(std::vector<std::vector<Key>> &data)
+{
+    if (static_cast<int>(data.size()) != num_ranks_)
+        throw std::runtime_error("Data for " + std::to_string(data.size()) + " ranks, not " +
+                                 std::to_string(num_ranks_));
+    for (const auto &part : data)
+        if (part.size() != data[0].size())
+            throw std::runtime_error("The real-threads backend needs the same element count on every rank");
+    for (int rank = 0; rank < num_ranks_; ++rank)
+    {
+        Rank &r = ranks_[rank];
+        r.data = std::move(data[rank]);
+        r.spare.resize(r.data.size());
+        r.outgoing.reserve(r.data.size());
+        r.next = 0;
+        r.sent = false;
+        r.full_mailboxes = 0;
+    }
+
+    // the clock starts once every worker is up
+    Barrier go(workers_ + 1);
+    std::vector<std::thread> threads;
+    for (int worker = 0; worker < workers_; ++worker)
+        threads.emplace_back([this, worker, &go] {
+            go.wait();
+            workerLoop(worker);
+        });
+    start_ = steadyNanoseconds();
+    go.wait();
+    for (auto &thread : threads)
+        thread.join();
+
+    ThreadRunStats stats;
+    stats.workers = workers_;
+    stats.phases.resize(phases_);
+    for (int rank = 0; rank < num_ranks_; ++rank)
+    {
+        Rank &r = ranks_[rank];
+        stats.local_sort = std::max(stats.local_sort, r.sorted);
+        stats.wall = std::max(stats.wall, r.times.empty() ? r.sorted : r.times.back().done);
+        stats.messages += r.steps.size();
+        stats.full_mailboxes += r.full_mailboxes;
+        for (std::size_t i = 0; i < r.steps.size(); ++i)
+        {
+            const StepTimes &times = r.times[i];
+            MeasuredPhase &phase = stats.phases[r.steps[i].phase];
+            phase.start = phase.ranks == 0 ? times.sent : std::min(phase.start, times.sent);
+            phase.finish = std::max(phase.finish, times.done);
+            phase.exchange += times.received - times.sent;
+            phase.merge += times.done - times.received;
+            phase.step += times.done - (i == 0 ? std::max(r.sorted, ranks_[r.steps[0].partner].sorted) : r.times[i - 1].done);
+            ++phase.ranks;
+        }
+        data[rank] = std::move(r.data);
+    }
+    return stats;
+}
+
+void ThreadBackend::workerLoop(int worker)
+{
+    // a contiguous block of ranks, like the partitions of the parallel engines
+    int first = static_cast<int>(static_cast<long long>(worker) * num_ranks_ / workers_);
+    int last = static_cast<int>(static_cast<long long>(worker + 1) * num_ranks_ / workers_);
+
+    for (int rank = first; rank < last; ++rank)
+    {
+        Rank &r = ranks_[rank];
+        SortKernels::sort(kernels_, r.data.data(), r.spare.data(), r.data.size());
+        r.outgoing.assign(r.data.begin(), r.data.end());
+        r.sorted = now();
+    }
+
+    for (;;)
+    {
+        bool busy = false, progress = false;
+        for (int rank = first; rank < last; ++rank)
+        {
+            Rank &r = ranks_[rank];
+            if (r.next == r.steps.size())
+                continue;
+            busy = true;
+            progress = advance(r) || progress;
+        }
+        if (!busy)
+            return;
+        if (!progress)
+            std::this_thread::yield();
+    }
+}
+
+bool ThreadBackend::advance(Rank &r)
+{
+    bool progress = false;
+    while (r.next < r.steps.size())
+    {
+        const Step &step = r.steps[r.next];
+        StepTimes &times = r.times[r.next];
+        if (!r.sent)
+        {
+            if (!mailboxes_[step.out].tryPush(r.outgoing))
+            {
+                ++r.full_mailboxes;
+                return progress;
+            }
+            r.sent = true;
+            times.sent = now();
+            progress = true;
+        }
+        if (!mailboxes_[step.in].tryPop(r.incoming))
+            return progress;
+        times.received = now();
+
+        if (step.keep_low)
+            SortKernels::mergeLow(kernels_, r.data.data(), r.incoming.data(), r.spare.data(), r.data.size());
+        else
+            SortKernels::mergeHigh(kernels_, r.data.data(), r.incoming.data(), r.spare.data(), r.data.size());
+        r.data.swap(r.spare);
+        times.done = now();
+
+        // the partner's buffer carries our next message
+        r.outgoing.swap(r.incoming);
+        r.sent = false;
+        if (++r.next < r.steps.size())
+            r.outgoing.assign(r.data.begin(), r.data.end());
+    }
+    return progress;
+}
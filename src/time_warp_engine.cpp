@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "time_warp_engine.hpp"
+#include "event_simulator.hpp"
+#include "trace_writer.hpp"
+
+namespace
+{
+    // partition served by the calling thread, -1 on the coordinating thread
+    thread_local int current_partition = -1;
+
+    int workerCount(int threads, int num_ranks)
+    {
+        if (threads <= 0)
+            threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        return std::max(1, std::min(threads, num_ranks));
+    }
+}
+
+TimeWarpEngine::TimeWarpEngine(EventSimulator &simulator, int threads, SimTick window)
+    : sim_(simulator),
+      workers_(workerCount(threads, simulator.getNumProcesses())),
+      num_ranks_(simulator.getNumProcesses()),
+      window_(window),
+      barrier_(workers_)
+{
+    for (int i = 0; i < workers_; ++i)
+        partitions_.push_back(std::make_unique<Partition>());
+}
+
+TimeWarpEngine::~TimeWarpEngine() = default;
+
+void TimeWarpEngine::schedule(Event event)
+{
+    int owner = EventSimulator::ownerRank(event);
+    int self = current_partition;
+
+    if (self == -1)
+    {
+        // coordinator, before the workers start
+        event.setSequence(makeSequence(global_sequence_++, workers_));
+        if (owner == EventSimulator::GLOBAL_EVENT)
+            global_pending_.emplace(keyOf(event), std::move(event));
+        else
+            insertPending(*partitions_[partitionOf(owner)], std::move(event));
+        return;
+    }
+    if (owner == EventSimulator::GLOBAL_EVENT)
+        throw std::runtime_error("Time Warp engine cannot run global events once workers started");
+
+    Partition &partition = *partitions_[self];
+    if (partition.current)
+    {
+        const Event &parent = partition.current->event;
+        if (event.getTime() < parent.getTime())
+            throw std::runtime_error("Event scheduled in the past of its parent");
+        // children order after their parent even at the same time
+        partition.next_sequence = std::max(partition.next_sequence, parent.getSequence() / (workers_ + 1) + 1);
+    }
+    event.setSequence(makeSequence(partition.next_sequence++, self));
+
+    int target = partitionOf(owner);
+    EventKey key = keyOf(event);
+    if (partition.current)
+        partition.current->sent.push_back(Sent{key, target});
+
+    if (target == self)
+    {
+        insertPending(partition, std::move(event));
+        return;
+    }
+    post(target, Incoming{key, std::move(event)});
+    ++partition.remote;
+}
+
+void TimeWarpEngine::insertPending(Partition &partition, Event event)
+{
+    EventKey key = keyOf(event);
+    partition.pending.emplace(key, std::move(event));
+    partition.pending_high_water = std::max(partition.pending_high_water, partition.pending.size());
+}
+
+void TimeWarpEngine::post(int target, Incoming message)
+{
+    Partition &partition = *partitions_[target];
+    std::lock_guard<std::mutex> lock(partition.inbox_mutex);
+    partition.inbox.push_back(std::move(message));
+    sent_during_gvt_.store(true, std::memory_order_relaxed);
+}
+
+void TimeWarpEngine::run(TraceWriter *trace)
+{
+    tracing_ = trace != nullptr;
+    trace_ = trace;
+
+    EngineStats &stats = sim_.stats_;
+    SimTick last_time = sim_.current_time_;
+
+    // take over what was scheduled before run(), then run the global events
+    // (START_SORT) alone: workers cannot roll those back
+    while (!sim_.event_queue_->empty())
+        schedule(sim_.event_queue_->pop());
+    while (!global_pending_.empty())
+    {
+        Event event = std::move(global_pending_.begin()->second);
+        global_pending_.erase(global_pending_.begin());
+        for (const auto &partition : partitions_)
+        {
+            if (!partition->pending.empty() && partition->pending.begin()->first < keyOf(event))
+                throw std::runtime_error("Time Warp engine cannot run global events once workers started");
+        }
+        last_time = std::max(last_time, event.getTime());
+        sim_.dispatchEvent(event);
+        ++stats.events_processed;
+        ++stats.events_executed;
+        stats.traffic.add(event, sim_.elementBytes());
+        if (trace)
+            trace->record(event);
+    }
+
+    gvt_.store(last_time);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers_; ++i)
+        threads.emplace_back(&TimeWarpEngine::workerLoop, this, i);
+    for (auto &thread : threads)
+        thread.join();
+
+    for (auto &partition : partitions_)
+    {
+        if (partition->error)
+            std::rethrow_exception(partition->error);
+    }
+
+    for (auto &partition : partitions_)
+    {
+        last_time = std::max(last_time, partition->last_committed);
+        stats.events_processed += partition->committed;
+        stats.events_executed += partition->executed;
+        stats.rollbacks += partition->rollbacks;
+        stats.rolled_back_events += partition->rolled_back;
+        stats.anti_messages += partition->anti_messages;
+        stats.remote_events += partition->remote;
+        stats.traffic += partition->traffic;
+        stats.queue_high_water += partition->pending_high_water;
+        stats.peak_saved_state_bytes += partition->peak_saved_bytes;
+    }
+    stats.gvt_rounds = gvt_rounds_;
+    sim_.current_time_ = last_time;
+}
+
+void TimeWarpEngine::workerLoop(int index)
+{
+    current_partition = index;
+    Partition &partition = *partitions_[index];
+    int idle_polls = 0;
+
+    for (;;)
+    {
+        if (gvt_requested_.load(std::memory_order_acquire) || failed_.load(std::memory_order_acquire))
+        {
+            if (gvtRound(index))
+                return;
+            idle_polls = 0;
+            continue;
+        }
+
+        bool received = false;
+        bool worked = false;
+        try
+        {
+            received = drainInbox(index);
+            if (!partition.pending.empty() &&
+                (window_ == 0 || partition.pending.begin()->first.first < gvt_.load(std::memory_order_relaxed) + window_))
+            {
+                processNext(partition);
+                worked = true;
+            }
+        }
+        catch (...)
+        {
+            partition.error = std::current_exception();
+            failed_.store(true, std::memory_order_release);
+        }
+
+        if (worked || received)
+        {
+            idle_polls = 0;
+            if (partition.since_gvt >= GVT_INTERVAL)
+                gvt_requested_.store(true, std::memory_order_release);
+        }
+        else if (++idle_polls >= IDLE_POLLS)
+        {
+            // nothing to do here: find out whether anyone still has work
+            gvt_requested_.store(true, std::memory_order_release);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TimeWarpEngine::processNext(Partition &partition)
+{
+    auto first = partition.pending.begin();
+    Event event = std::move(first->second);
+    partition.pending.erase(first);
+
+    Processor *processor = sim_.findProcessor(EventSimulator::ownerRank(event));
+    Processor::SavedState saved = processor->saveState(EventSimulator::rewritesLocalData(event));
+    partition.saved_bytes += saved.bytes();
+    partition.peak_saved_bytes = std::max(partition.peak_saved_bytes, partition.saved_bytes);
+
+    partition.processed.push_back(Processed{std::move(event), std::move(saved), {}});
+    Processed &record = partition.processed.back();
+
+    partition.current = &record;
+    try
+    {
+        sim_.dispatchEvent(record.event);
+    }
+    catch (...)
+    {
+        partition.current = nullptr;
+        throw;
+    }
+    partition.current = nullptr;
+    ++partition.executed;
+    ++partition.since_gvt;
+}
+
+bool TimeWarpEngine::drainInbox(int index)
+{
+    Partition &partition = *partitions_[index];
+    std::vector<Incoming> messages;
+    {
+        std::lock_guard<std::mutex> lock(partition.inbox_mutex);
+        messages.swap(partition.inbox);
+    }
+
+    for (auto &message : messages)
+    {
+        bool in_past = !partition.processed.empty() && message.key < keyOf(partition.processed.back().event);
+        if (message.event)
+        {
+            // straggler: undo everything after it first
+            if (in_past)
+                rollback(index, message.key);
+            insertPending(partition, std::move(*message.event));
+            continue;
+        }
+
+        // anti-message: annihilate the pending positive, undoing it first if it already ran
+        if (partition.pending.find(message.key) == partition.pending.end())
+            rollback(index, message.key);
+        if (partition.pending.erase(message.key) == 0)
+            throw std::runtime_error("Anti-message without a matching event");
+    }
+    return !messages.empty();
+}
+
+void TimeWarpEngine::rollback(int index, const EventKey &key)
+{
+    Partition &partition = *partitions_[index];
+    bool rolled = false;
+
+    while (!partition.processed.empty() && !(keyOf(partition.processed.back().event) < key))
+    {
+        Processed record = std::move(partition.processed.back());
+        partition.processed.pop_back();
+
+        // cancel what the event sent, newest first; local children were
+        // processed later, so they are already back in the pending set
+        for (auto it = record.sent.rbegin(); it != record.sent.rend(); ++it)
+        {
+            if (it->partition == index)
+            {
+                partition.pending.erase(it->key);
+            }
+            else
+            {
+                post(it->partition, Incoming{it->key, std::nullopt});
+                ++partition.anti_messages;
+            }
+        }
+
+        partition.saved_bytes -= record.saved.bytes();
+        sim_.findProcessor(EventSimulator::ownerRank(record.event))->restoreState(std::move(record.saved));
+        insertPending(partition, std::move(record.event));
+        ++partition.rolled_back;
+        rolled = true;
+    }
+
+    if (rolled)
+        ++partition.rollbacks;
+}
+
+bool TimeWarpEngine::gvtRound(int index)
+{
+    Partition &partition = *partitions_[index];
+
+    // everybody stops; drain until no rollback posts another anti-message
+    barrier_.wait();
+    for (;;)
+    {
+        try
+        {
+            drainInbox(index);
+        }
+        catch (...)
+        {
+            partition.error = std::current_exception();
+            failed_.store(true, std::memory_order_release);
+        }
+        barrier_.wait();
+        if (index == 0)
+            repeat_drain_ = sent_during_gvt_.exchange(false);
+        barrier_.wait();
+        if (!repeat_drain_)
+            break;
+    }
+
+    // no message is in flight: GVT is the earliest pending time
+    partition.local_min = partition.pending.empty() ? NO_EVENT : partition.pending.begin()->first.first;
+    barrier_.wait();
+
+    SimTick gvt = NO_EVENT;
+    for (const auto &other : partitions_)
+        gvt = std::min(gvt, other->local_min);
+    fossilCollect(partition, gvt);
+    partition.since_gvt = 0;
+
+    bool done = gvt == NO_EVENT || failed_.load(std::memory_order_acquire);
+    barrier_.wait();
+
+    if (index == 0)
+    {
+        // the others only touch their traces in the next round, after this barrier
+        gvt_requested_.store(false, std::memory_order_release);
+        if (gvt != NO_EVENT)
+            gvt_.store(gvt, std::memory_order_relaxed);
+        ++gvt_rounds_;
+        if (trace_)
+        {
+            for (auto &other : partitions_)
+            {
+                trace_->append(other->trace);
+                other->trace.clear();
+            }
+        }
+    }
+    barrier_.wait();
+    return done;
+}
+
+void TimeWarpEngine::fossilCollect(Partition &partition, SimTick gvt)
+{
+    while (!partition.processed.empty() && partition.processed.front().event.getTime() < gvt)
+    {
+        Processed &record = partition.processed.front();
+        if (tracing_)
+            partition.trace.push_back(TraceWriter::makeRecord(record.event));
+        partition.last_committed = std::max(partition.last_committed, record.event.getTime());
+        partition.saved_bytes -= record.saved.bytes();
+        ++partition.committed;
+        partition.traffic.add(record.event, sim_.elementBytes());
+        partition.processed.pop_front();
+    }
+}
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+#include "timeline.hpp"
+
+const char *Timeline::spanKindName(SpanKind kind)
+{
+    switch (kind)
+    {
+    case SpanKind::SEND:
+        return "send";
+    case SpanKind::RECV_WAIT:
+        return "recv-wait";
+    case SpanKind::COMPARE_SPLIT:
+        return "compare-split";
+    case SpanKind::ALLREDUCE:
+        return "allreduce";
+    case SpanKind::IDLE:
+        return "idle";
+    }
+    return "unknown";
+}
+
+const char *Timeline::pathKindName(PathKind kind)
+{
+    switch (kind)
+    {
+    case PathKind::PHASE_SLOT:
+        return "phase slot";
+    case PathKind::NETWORK:
+        return "network";
+    case PathKind::COMPARE_SPLIT:
+        return "compare-split";
+    case PathKind::ALLREDUCE:
+        return "allreduce";
+    }
+    return "unknown";
+}
+
+Timeline::Timeline(const std::string &path, int num_processes, SimTick start)
+    : path_(path), file_(path, std::ios::trunc), start_(start), spans_(num_processes),
+      last_split_(num_processes, -1)
+{
+    if (!file_.is_open())
+        throw std::runtime_error("Cannot open timeline file " + path);
+    start_node_ = addNode(start, NodeKind::START, -1, -1, -1);
+    barrier_node_ = start_node_;
+}
+
+int Timeline::addNode(SimTick time, NodeKind kind, int rank, int phase, int pred)
+{
+    nodes_.push_back({time, kind, rank, phase, pred});
+    return static_cast<int>(nodes_.size()) - 1;
+}
+
+int Timeline::later(int a, int b) const
+{
+    if (a < 0)
+        return b;
+    if (b < 0)
+        return a;
+    return nodes_[b].time > nodes_[a].time ? b : a;
+}
+
+Timeline::PhaseUse &Timeline::phaseUse(int phase)
+{
+    if (static_cast<std::size_t>(phase) >= phases_.size())
+        phases_.resize(phase + 1);
+    return phases_[phase];
+}
+
+void Timeline::addSpan(int rank, SimTick start, SimTick end, SpanKind kind, int phase, int peer)
+{
+    if (end <= start)
+        return;
+    spans_[rank].push_back({start, end, kind, phase, peer});
+    totals_[static_cast<int>(kind)] += end - start;
+    if (phase < 0)
+        return;
+    if (kind == SpanKind::RECV_WAIT)
+        phaseUse(phase).wait += end - start;
+    else
+        phaseUse(phase).busy += end - start;
+}
+
+void Timeline::start(SimTick time)
+{
+    start_ = time;
+    nodes_[start_node_].time = time;
+}
+
+void Timeline::send(int rank, int partner, int phase, SimTick time, SimTick wire_end)
+{
+    int node = addNode(time, NodeKind::SEND, rank, phase, later(last_split_[rank], barrier_node_));
+    own_sends_[key(rank, phase)] = {node, time, wire_end};
+    messages_[key(rank, phase)] = node;
+    addSpan(rank, time, wire_end, SpanKind::SEND, phase, partner);
+
+    PhaseUse &use = phaseUse(phase);
+    use.start = use.start < 0 ? time : std::min(use.start, time);
+    ++use.ranks;
+}
+
+void Timeline::arrive(int rank, int source, int phase, SimTick time)
+{
+    int pred = -1;
+    auto message = messages_.find(key(source, phase));
+    if (message != messages_.end()) // sent before a resumed run began otherwise
+    {
+        pred = message->second;
+        messages_.erase(message);
+    }
+    arrivals_[key(rank, phase)] = addNode(time, NodeKind::ARRIVAL, rank, phase, pred);
+}
+
+void Timeline::compareSplit(int rank, int partner, int phase, SimTick time)
+{
+    PendingSend own{-1, start_, start_};
+    auto sent = own_sends_.find(key(rank, phase));
+    if (sent != own_sends_.end())
+    {
+        own = sent->second;
+        own_sends_.erase(sent);
+    }
+    int arrival = -1;
+    auto arrived = arrivals_.find(key(rank, phase));
+    if (arrived != arrivals_.end())
+    {
+        arrival = arrived->second;
+        arrivals_.erase(arrived);
+    }
+
+    // after the send the rank waits for the partner's data, then merges it for
+    // COMPARE_SPLIT_TIME (less if the data came later than that)
+    SimTick data = arrival < 0 ? own.wire_end : std::max(own.wire_end, nodes_[arrival].time);
+    SimTick merge = std::min(time, std::max(time - SimTime::COMPARE_SPLIT_TIME, data));
+    addSpan(rank, own.wire_end, std::min(data, merge), SpanKind::RECV_WAIT, phase, partner);
+    addSpan(rank, merge, time, SpanKind::COMPARE_SPLIT, phase, partner);
+
+    int node = addNode(time, NodeKind::SPLIT, rank, phase, later(arrival, own.node));
+    last_split_[rank] = node;
+    latest_split_ = later(latest_split_, node);
+    PhaseUse &use = phaseUse(phase);
+    use.finish = std::max(use.finish, time);
+}
+
+void Timeline::allreduce(SimTick time, SimTick duration)
+{
+    barrier_node_ = addNode(time, NodeKind::ALLREDUCE, -1, -1, later(latest_split_, barrier_node_));
+    for (int rank = 0; rank < ranks(); ++rank)
+        addSpan(rank, time - duration, time, SpanKind::ALLREDUCE, -1, -1);
+}
+
+std::size_t Timeline::spanCount() const
+{
+    std::size_t count = 0;
+    for (const auto &spans : spans_)
+        count += spans.size();
+    return count;
+}
+
+void Timeline::finish(SimTick time)
+{
+    finish_ = std::max(time, start_);
+
+    // what no span covers between the start and the end is idle
+    for (int rank = 0; rank < ranks(); ++rank)
+    {
+        std::vector<Span> &spans = spans_[rank];
+        std::stable_sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) { return a.start < b.start; });
+        std::vector<Span> filled;
+        filled.reserve(spans.size() * 2 + 1);
+        SimTick cursor = start_;
+        for (const Span &span : spans)
+        {
+            if (span.start > cursor)
+            {
+                filled.push_back({cursor, span.start, SpanKind::IDLE, -1, -1});
+                totals_[static_cast<int>(SpanKind::IDLE)] += span.start - cursor;
+            }
+            filled.push_back(span);
+            cursor = std::max(cursor, span.end);
+        }
+        if (cursor < finish_)
+        {
+            filled.push_back({cursor, finish_, SpanKind::IDLE, -1, -1});
+            totals_[static_cast<int>(SpanKind::IDLE)] += finish_ - cursor;
+        }
+        spans = std::move(filled);
+    }
+
+    // back from the last compare-split (or allreduce) to the start
+    path_found_ = CriticalPath();
+    for (int node = later(latest_split_, barrier_node_); node >= 0; node = nodes_[node].pred)
+    {
+        ++path_found_.events;
+        const Node &to = nodes_[node];
+        if (to.pred < 0)
+            break;
+        const Node &from = nodes_[to.pred];
+        PathKind kind = PathKind::PHASE_SLOT;
+        if (to.kind == NodeKind::ARRIVAL)
+        {
+            kind = PathKind::NETWORK;
+            ++path_found_.rank_changes;
+        }
+        else if (to.kind == NodeKind::SPLIT)
+            kind = PathKind::COMPARE_SPLIT;
+        else if (to.kind == NodeKind::ALLREDUCE)
+            kind = PathKind::ALLREDUCE;
+        path_found_.length += to.time - from.time;
+        path_found_.by_kind[static_cast<int>(kind)] += to.time - from.time;
+        if (to.time > from.time)
+            path_found_.segments.push_back({from.time, to.time, kind, to.rank, to.phase});
+    }
+    std::reverse(path_found_.segments.begin(), path_found_.segments.end());
+}
+
+namespace
+{
+    // ticks as units with three decimals (microseconds in the trace), without iostream formatting
+    void appendTime(std::string &out, SimTick ticks)
+    {
+        static_assert(TICKS_PER_UNIT == 1000, "three decimals per unit");
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), ticks / TICKS_PER_UNIT).ptr;
+        out.append(digits, end);
+        int fraction = static_cast<int>(ticks % TICKS_PER_UNIT);
+        if (fraction == 0)
+            return;
+        out += '.';
+        out += static_cast<char>('0' + fraction / 100);
+        out += static_cast<char>('0' + fraction / 10 % 10);
+        out += static_cast<char>('0' + fraction % 10);
+    }
+
+    void appendInt(std::string &out, long long value)
+    {
+        char digits[24];
+        out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+    }
+}
+
+void Timeline::write(const std::string &title)
+{
+    // ts and dur in microseconds: one simulated unit each; built in a buffer
+    // written out every few MiB
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,"
+                      "\"tid\":0,\"args\":{\"name\":\"" + title + "\"}}";
+    auto flush = [&](std::size_t limit) {
+        if (out.size() < limit)
+            return;
+        file_.write(out.data(), static_cast<std::streamsize>(out.size()));
+        out.clear();
+    };
+    auto span = [&](const char *name, const char *category, int tid, SimTick start, SimTick end) {
+        out += ",\n{\"ph\":\"X\",\"name\":\"";
+        out += name;
+        out += "\",\"cat\":\"";
+        out += category;
+        out += "\",\"pid\":0,\"tid\":";
+        appendInt(out, tid);
+        out += ",\"ts\":";
+        appendTime(out, start);
+        out += ",\"dur\":";
+        appendTime(out, end - start);
+    };
+
+    const int path_tid = ranks();
+    for (int tid = 0; tid <= path_tid; ++tid)
+    {
+        out += ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":";
+        appendInt(out, tid);
+        out += ",\"args\":{\"name\":\"";
+        if (tid == path_tid)
+            out += "critical path";
+        else
+        {
+            out += "rank ";
+            appendInt(out, tid);
+        }
+        out += "\"}},\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":0,\"tid\":";
+        appendInt(out, tid);
+        out += ",\"args\":{\"sort_index\":";
+        appendInt(out, tid == path_tid ? -1 : tid);
+        out += "}}";
+    }
+
+    for (int rank = 0; rank < ranks(); ++rank)
+    {
+        for (const Span &s : spans_[rank])
+        {
+            const char *name = spanKindName(s.kind);
+            span(name, name, rank, s.start, s.end);
+            if (s.phase >= 0)
+            {
+                out += ",\"args\":{\"phase\":";
+                appendInt(out, s.phase);
+                out += ",\"partner\":";
+                appendInt(out, s.peer);
+                out += '}';
+            }
+            out += '}';
+            flush(std::size_t(1) << 22);
+        }
+    }
+    for (const PathSegment &segment : path_found_.segments)
+    {
+        span(pathKindName(segment.kind), "critical path", path_tid, segment.start, segment.end);
+        out += ",\"args\":{\"rank\":";
+        appendInt(out, segment.rank);
+        out += ",\"phase\":";
+        appendInt(out, segment.phase);
+        out += "}}";
+        flush(std::size_t(1) << 22);
+    }
+
+    // each phase's share of all ranks' time over its span
+    for (const PhaseUse &use : phases_)
+    {
+        if (use.span() <= 0)
+            continue;
+        // percent with three decimals
+        SimTick capacity = use.span() * ranks();
+        out += ",\n{\"ph\":\"C\",\"name\":\"phase utilization %\",\"pid\":0,\"ts\":";
+        appendTime(out, use.start);
+        out += ",\"args\":{\"busy\":";
+        appendTime(out, use.busy * 100 * TICKS_PER_UNIT / capacity);
+        out += ",\"recv-wait\":";
+        appendTime(out, use.wait * 100 * TICKS_PER_UNIT / capacity);
+        out += "}}";
+        flush(std::size_t(1) << 22);
+    }
+    out += "\n]}\n";
+    flush(0);
+    file_.close();
+    if (!file_)
+        throw std::runtime_error("Error writing timeline file " + path_);
+}
@@ -0,0 +1,107 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "trace_writer.hpp"
+
+TraceWriter::TraceWriter(const std::string &path, int num_processes, int elements_per_processor)
+    : path_(path), file_(path, std::ios::binary | std::ios::trunc)
+{
+    if (!file_.is_open())
+        throw std::runtime_error("Cannot open trace file " + path);
+
+    TraceHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.ticks_per_unit = TICKS_PER_UNIT;
+    header.num_processes = num_processes;
+    header.elements_per_processor = elements_per_processor;
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    active_.reserve(BUFFER_RECORDS);
+    pending_.reserve(BUFFER_RECORDS);
+    writer_ = std::thread(&TraceWriter::writerLoop, this);
+}
+
+TraceWriter::~TraceWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::runtime_error &)
+    {
+        // destructor: the error was only reportable through close()
+    }
+}
+
+TraceRecord TraceWriter::makeRecord(const Event &event)
+{
+    TraceRecord record{};
+    record.time = event.getTime();
+    record.payload_length = static_cast<std::uint32_t>(event.getData().size());
+    record.payload_hash = payloadHash(event.getData().data(), event.getData().size());
+    record.src = event.getSourceRank();
+    record.dst = event.getDestRank();
+    record.tag = event.getTag();
+    record.type = static_cast<std::uint8_t>(event.getType());
+    return record;
+}
+
+void TraceWriter::append(const std::vector<TraceRecord> &records)
+{
+    for (const TraceRecord &record : records)
+        push(record);
+}
+
+void TraceWriter::handOver()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !pending_full_; });
+    active_.swap(pending_);
+    pending_full_ = true;
+    cv_.notify_all();
+    lock.unlock();
+    active_.clear();
+}
+
+void TraceWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        cv_.wait(lock, [this] { return pending_full_ || stop_; });
+        if (!pending_full_)
+            return; // stopping, nothing left
+
+        // the producer does not touch pending_ until pending_full_ is cleared
+        lock.unlock();
+        file_.write(reinterpret_cast<const char *>(pending_.data()), pending_.size() * sizeof(TraceRecord));
+        bool ok = static_cast<bool>(file_);
+        lock.lock();
+
+        failed_ = failed_ || !ok;
+        pending_full_ = false;
+        cv_.notify_all();
+    }
+}
+
+void TraceWriter::close()
+{
+    if (closed_)
+        return;
+    closed_ = true;
+
+    if (!active_.empty())
+        handOver();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+
+    file_.close();
+    if (failed_ || file_.fail())
+        throw std::runtime_error("Error writing trace file " + path_);
+}
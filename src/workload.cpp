@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#include "workload.hpp"
+
+namespace
+{
+    __extension__ using Wide = unsigned __int128; // GCC / Clang; products of two 64-bit values
+
+    // Philox4x32 multipliers and Weyl key increments
+    constexpr std::uint32_t PHILOX_M0 = 0xD2511F53, PHILOX_M1 = 0xCD9E8D57;
+    constexpr std::uint32_t PHILOX_W0 = 0x9E3779B9, PHILOX_W1 = 0xBB67AE85;
+
+    // independent streams of the same (seed, index)
+    enum Stream : std::uint32_t { VALUES, ORDERED, SWAPS, ZIPF };
+
+    constexpr std::uint64_t ZIPF_MAX_VALUES = std::uint64_t(1) << 20;
+
+    // distinct values of [KEY_MIN, KEY_MAX], 2^64 - 1 at most
+    constexpr std::uint64_t keyValues()
+    {
+        if constexpr (std::is_floating_point_v<Key>)
+            return std::uint64_t(1) << 24;
+        else
+            return static_cast<std::uint64_t>(KEY_MAX) - static_cast<std::uint64_t>(KEY_MIN) + 1;
+    }
+
+    // r scaled to [0, range): the high word of r x range, no modulo bias worth the name
+    std::uint64_t below(std::uint64_t r, std::uint64_t range)
+    {
+        return static_cast<std::uint64_t>((static_cast<Wide>(r) * range) >> 64);
+    }
+
+    double unit(std::uint64_t r) { return static_cast<double>(r >> 11) * 0x1.0p-53; } // [0, 1)
+
+    Key uniformKey(std::uint64_t r)
+    {
+        if constexpr (std::is_floating_point_v<Key>)
+            return static_cast<Key>(KEY_MIN + unit(r) * (static_cast<double>(KEY_MAX) - KEY_MIN));
+        else
+            return static_cast<Key>(KEY_MIN + static_cast<Key>(below(r, keyValues())));
+    }
+
+    Key fullRangeKey(std::uint64_t r)
+    {
+        if constexpr (std::is_floating_point_v<Key>)
+        {
+            auto bits = static_cast<std::uint32_t>(r);
+            if (((bits >> 23) & 0xff) == 0xff) // infinities and NaNs: drop to a finite exponent
+                bits ^= std::uint32_t(1) << 30;
+            Key key;
+            std::memcpy(&key, &bits, sizeof(key));
+            return key;
+        }
+        else
+            return static_cast<Key>(r);
+    }
+
+    // the j-th of `count` values spread evenly over [KEY_MIN, KEY_MAX]
+    Key spreadKey(std::uint64_t j, std::uint64_t count)
+    {
+        if constexpr (std::is_floating_point_v<Key>)
+            return static_cast<Key>(KEY_MIN + (static_cast<double>(KEY_MAX) - KEY_MIN) * static_cast<double>(j) /
+                                                  static_cast<double>(count));
+        else
+            return static_cast<Key>(
+                KEY_MIN + static_cast<Key>(static_cast<Wide>(j) * keyValues() / count));
+    }
+
+    // Zipf rejection-inversion (Hoermann and Derflinger 1996) helpers: log1p(x) / x and expm1(x) / x
+    double helper1(double x)
+    {
+        return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+    double helper2(double x)
+    {
+        return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+    // H(x) = (x^(1 - s) - 1) / (1 - s), the integral of h(x) = x^-s; log x at s = 1
+    double hIntegral(double x, double s)
+    {
+        double log_x = std::log(x);
+        return helper2((1.0 - s) * log_x) * log_x;
+    }
+    double h(double x, double s) { return std::exp(-s * std::log(x)); }
+    double hIntegralInverse(double x, double s)
+    {
+        double t = std::max(x * (1.0 - s), -1.0);
+        return std::exp(helper1(t) * x);
+    }
+
+    // the parameter of NAME:PARAMETER, a whole number in [min_value, 2^50] unless `real`
+    double parseParameter(const std::string &name, const std::string &value, double min_value, bool real)
+    {
+        char *end = nullptr;
+        double parsed = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || !(parsed >= min_value) || !std::isfinite(parsed) ||
+            (!real && (parsed != std::floor(parsed) || parsed > 0x1.0p50)))
+            throw std::invalid_argument("--dist=" + name + ":" + value + ": needs " +
+                                        (real ? "a number > 0" : "an integer >= " + std::to_string(int(min_value))));
+        if (real && parsed == 0)
+            throw std::invalid_argument("--dist=" + name + ":" + value + ": needs a number > 0");
+        return parsed;
+    }
+}
+
+Philox4x32::Block Philox4x32::operator()(Block counter) const
+{
+    std::uint32_t k0 = key_[0], k1 = key_[1];
+    for (int round = 0; round < 10; ++round)
+    {
+        std::uint64_t p0 = static_cast<std::uint64_t>(PHILOX_M0) * counter[0];
+        std::uint64_t p1 = static_cast<std::uint64_t>(PHILOX_M1) * counter[2];
+        counter = {static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ k0, static_cast<std::uint32_t>(p1),
+                   static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ k1, static_cast<std::uint32_t>(p0)};
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    return counter;
+}
+
+std::array<std::uint64_t, 2> Philox4x32::words(std::uint64_t index, std::uint32_t stream, std::uint32_t draw) const
+{
+    Block block = (*this)({static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32), stream, draw});
+    return {static_cast<std::uint64_t>(block[1]) << 32 | block[0], static_cast<std::uint64_t>(block[3]) << 32 | block[2]};
+}
+
+const char *inputDistributionName(InputDistribution distribution)
+{
+    switch (distribution)
+    {
+    case InputDistribution::UNIFORM:
+        return "uniform";
+    case InputDistribution::FULL:
+        return "full";
+    case InputDistribution::ZIPF:
+        return "zipf";
+    case InputDistribution::DUPLICATES:
+        return "duplicates";
+    case InputDistribution::SORTED:
+        return "sorted";
+    case InputDistribution::REVERSED:
+        return "reversed";
+    case InputDistribution::NEARLY_SORTED:
+        return "nearly-sorted";
+    case InputDistribution::RUNS:
+        break;
+    }
+    return "runs";
+}
+
+WorkloadConfig parseWorkload(const std::string &spec)
+{
+    std::size_t colon = spec.find(':');
+    std::string name = spec.substr(0, colon);
+    WorkloadConfig workload;
+    for (InputDistribution distribution :
+         {InputDistribution::UNIFORM, InputDistribution::FULL, InputDistribution::ZIPF, InputDistribution::DUPLICATES,
+          InputDistribution::SORTED, InputDistribution::REVERSED, InputDistribution::NEARLY_SORTED,
+          InputDistribution::RUNS})
+    {
+        if (name != inputDistributionName(distribution))
+            continue;
+        workload.distribution = distribution;
+        if (colon == std::string::npos)
+            return workload;
+        std::string value = spec.substr(colon + 1);
+        switch (distribution)
+        {
+        case InputDistribution::ZIPF:
+            workload.parameter = parseParameter(name, value, 0, true);
+            return workload;
+        case InputDistribution::DUPLICATES:
+        case InputDistribution::RUNS:
+            workload.parameter = parseParameter(name, value, 1, false);
+            return workload;
+        case InputDistribution::NEARLY_SORTED:
+            workload.parameter = parseParameter(name, value, 0, false);
+            return workload;
+        default:
+            throw std::invalid_argument("--dist=" + name + " takes no parameter");
+        }
+    }
+    throw std::invalid_argument("--dist must be 'uniform', 'full', 'zipf[:S]', 'duplicates[:D]', 'sorted', "
+                                "'reversed', 'nearly-sorted[:K]' or 'runs[:L]'");
+}
+
+std::string workloadName(const WorkloadConfig &workload)
+{
+    std::string name = inputDistributionName(workload.distribution);
+    if (workload.parameter < 0)
+        return name;
+    if (workload.parameter == std::floor(workload.parameter))
+        return name + ":" + std::to_string(static_cast<std::uint64_t>(workload.parameter));
+    std::string value = std::to_string(workload.parameter);
+    value.erase(value.find_last_not_of('0') + 1); // 1.500000 -> 1.5
+    return name + ":" + value;
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig &workload, std::uint64_t seed, int ranks,
+                                     std::size_t elements_per_rank)
+    : distribution_(workload.distribution), random_(seed), ranks_(ranks), elements_(elements_per_rank),
+      total_(static_cast<std::uint64_t>(ranks) * elements_per_rank)
+{
+    bool given = workload.parameter >= 0;
+    switch (distribution_)
+    {
+    case InputDistribution::ZIPF:
+        exponent_ = given ? workload.parameter : 1.0;
+        zipf_values_ = std::min(keyValues(), ZIPF_MAX_VALUES);
+        h_integral_x1_ = hIntegral(1.5, exponent_) - 1.0;
+        h_integral_n_ = hIntegral(static_cast<double>(zipf_values_) + 0.5, exponent_);
+        s_ = 2.0 - hIntegralInverse(hIntegral(2.5, exponent_) - h(2.0, exponent_), exponent_);
+        break;
+    case InputDistribution::DUPLICATES:
+        count_ = given ? static_cast<std::uint64_t>(workload.parameter) : 16;
+        break;
+    case InputDistribution::RUNS:
+        count_ = given ? static_cast<std::uint64_t>(workload.parameter) : elements_;
+        break;
+    case InputDistribution::NEARLY_SORTED:
+    {
+        // K swaps in order; position -> global index of the sorted key it ends up with
+        std::uint64_t swaps = given ? static_cast<std::uint64_t>(workload.parameter) : total_ / 100;
+        std::unordered_map<std::uint64_t, std::uint64_t> source;
+        auto at = [&](std::uint64_t position) {
+            auto found = source.find(position);
+            return found == source.end() ? position : found->second;
+        };
+        for (std::uint64_t i = 0; total_ > 1 && i < swaps; ++i)
+        {
+            auto words = random_.words(i, SWAPS);
+            std::uint64_t a = below(words[0], total_), b = below(words[1], total_);
+            std::uint64_t from_a = at(a), from_b = at(b);
+            source[a] = from_b;
+            source[b] = from_a;
+        }
+        moved_.resize(ranks_);
+        for (const auto &entry : source)
+            if (entry.first != entry.second)
+                moved_[entry.first / elements_].push_back({static_cast<std::size_t>(entry.first % elements_),
+                                                           entry.second});
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+Key WorkloadGenerator::sortedKey(std::uint64_t index, std::uint64_t r) const
+{
+    // a random key between the index's even share of the range and the next
+    // index's: ascending by construction, and any index can be drawn alone
+    if constexpr (std::is_floating_point_v<Key>)
+    {
+        double span = static_cast<double>(KEY_MAX) - KEY_MIN;
+        double low = KEY_MIN + span * static_cast<double>(index) / static_cast<double>(total_);
+        double high = KEY_MIN + span * static_cast<double>(index + 1) / static_cast<double>(total_);
+        return static_cast<Key>(low + unit(r) * (high - low));
+    }
+    else
+    {
+        auto offset = [this](std::uint64_t i) {
+            return static_cast<std::uint64_t>(static_cast<Wide>(i) * keyValues() / total_);
+        };
+        std::uint64_t low = offset(index), high = offset(index + 1);
+        return static_cast<Key>(KEY_MIN + static_cast<Key>(high > low ? low + below(r, high - low) : low));
+    }
+}
+
+Key WorkloadGenerator::zipfKey(std::uint64_t index) const
+{
+    // rejection-inversion: value k of 1..n with probability proportional to k^-s,
+    // accepted after 1.1 draws on average; two draws per block of random bits
+    for (std::uint32_t draw = 0;; ++draw)
+    {
+        for (std::uint64_t r : random_.words(index, ZIPF, draw))
+        {
+            double u = h_integral_n_ + unit(r) * (h_integral_x1_ - h_integral_n_);
+            double x = hIntegralInverse(u, exponent_);
+            double k = std::clamp(std::floor(x + 0.5), 1.0, static_cast<double>(zipf_values_));
+            if (k - x <= s_ || u >= hIntegral(k + 0.5, exponent_) - h(k, exponent_))
+                return spreadKey(static_cast<std::uint64_t>(k) - 1, zipf_values_);
+        }
+    }
+}
+
+void WorkloadGenerator::generate(int rank, Key *out) const
+{
+    const std::uint64_t first = static_cast<std::uint64_t>(rank) * elements_;
+    // one block of random bits serves two consecutive elements
+    auto fillSorted = [&](bool descending) {
+        std::uint64_t block = ~std::uint64_t(0);
+        std::array<std::uint64_t, 2> words{};
+        for (std::size_t i = 0; i < elements_; ++i)
+        {
+            std::uint64_t index = descending ? total_ - 1 - (first + i) : first + i;
+            if (index >> 1 != block)
+            {
+                block = index >> 1;
+                words = random_.words(block, ORDERED);
+            }
+            out[i] = sortedKey(index, words[index & 1]);
+        }
+    };
+    auto fill = [&](auto key_of) {
+        for (std::size_t i = 0; i < elements_;)
+        {
+            std::uint64_t index = first + i;
+            auto words = random_.words(index >> 1, VALUES);
+            for (std::size_t half = index & 1; half < 2 && i < elements_; ++half, ++i)
+                out[i] = key_of(words[half]);
+        }
+    };
+
+    switch (distribution_)
+    {
+    case InputDistribution::UNIFORM:
+        fill(uniformKey);
+        break;
+    case InputDistribution::FULL:
+        fill(fullRangeKey);
+        break;
+    case InputDistribution::ZIPF:
+        for (std::size_t i = 0; i < elements_; ++i)
+            out[i] = zipfKey(first + i);
+        break;
+    case InputDistribution::DUPLICATES:
+        fill([this](std::uint64_t r) { return spreadKey(below(r, count_), count_); });
+        break;
+    case InputDistribution::SORTED:
+    case InputDistribution::NEARLY_SORTED:
+        fillSorted(false);
+        if (distribution_ == InputDistribution::NEARLY_SORTED)
+            for (const Moved &moved : moved_[rank])
+                out[moved.position] =
+                    sortedKey(moved.source, random_.words(moved.source >> 1, ORDERED)[moved.source & 1]);
+        break;
+    case InputDistribution::REVERSED:
+        fillSorted(true);
+        break;
+    case InputDistribution::RUNS:
+        fill(uniformKey);
+        for (std::size_t start = 0; start < elements_; start += count_)
+            std::sort(out + start, out + std::min<std::uint64_t>(elements_, start + count_));
+        break;
+    }
+}
@@ -0,0 +1,106 @@
+# A run resumed from a checkpoint must continue exactly as the uninterrupted
+# run: its binary trace equals the tail of the uninterrupted trace record for
+# record, in order, and it reaches the same simulation time and sorted data.
+# Writing checkpoints must not change the run either. The checkpoints are
+# spaced so the last one falls in the middle of the sort.
+# Run by ctest: cmake -DSIMULATOR=... -DTRACE2TXT=... -DPROCS=P -DELEMENTS=N
+#                     -DOPTIONS="--sort=..." -DNAME=... -DWORK_DIR=... -P checkpoint_resume.cmake
+
+foreach(var SIMULATOR TRACE2TXT PROCS ELEMENTS NAME WORK_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "checkpoint_resume.cmake needs -D${var}=...")
+    endif()
+endforeach()
+separate_arguments(options UNIX_COMMAND "${OPTIONS}")
+
+set(dir "${WORK_DIR}/${NAME}")
+file(REMOVE_RECURSE "${dir}")
+file(MAKE_DIRECTORY "${dir}")
+
+# run `run` with the extra arguments; sets ${run}_time and ${run}_output
+function(simulate run)
+    execute_process(
+        COMMAND "${SIMULATOR}" ${PROCS} ${ELEMENTS} ${options} --seed=12345 --quiet
+                "--trace=${dir}/${run}.bin" "--output=${dir}/${run}.dat" ${ARGN}
+        WORKING_DIRECTORY "${dir}"
+        RESULT_VARIABLE status
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "${NAME} ${run} run failed (${status}):\n${output}")
+    endif()
+    if(NOT output MATCHES "Is correctly sorted: Yes")
+        message(FATAL_ERROR "${NAME} ${run} run did not sort:\n${output}")
+    endif()
+    if(NOT output MATCHES "Simulation time: ([^\n]*)")
+        message(FATAL_ERROR "${NAME} ${run} run: no simulation time in the output:\n${output}")
+    endif()
+    set(${run}_time "${CMAKE_MATCH_1}" PARENT_SCOPE)
+    set(${run}_output "${output}" PARENT_SCOPE)
+endfunction()
+
+# every record of the run's trace, in order, without the CSV header
+function(read_trace run)
+    execute_process(
+        COMMAND "${TRACE2TXT}" "${dir}/${run}.bin" --csv "${dir}/${run}.csv"
+        RESULT_VARIABLE status
+        ERROR_VARIABLE error)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "trace2txt ${run}.bin failed (${status}): ${error}")
+    endif()
+    file(STRINGS "${dir}/${run}.csv" records)
+    list(REMOVE_AT records 0)
+    list(LENGTH records count)
+    set(${run}_records "${records}" PARENT_SCOPE)
+    set(${run}_count ${count} PARENT_SCOPE)
+    file(SHA256 "${dir}/${run}.dat" data)
+    set(${run}_data ${data} PARENT_SCOPE)
+endfunction()
+
+# the uninterrupted run, then the same run writing checkpoints 2/5 of its time apart
+simulate(plain)
+if(NOT plain_time MATCHES "^([0-9]+)")
+    message(FATAL_ERROR "${NAME}: cannot read simulation time ${plain_time}")
+endif()
+math(EXPR every "${CMAKE_MATCH_1} * 2 / 5 + 1")
+simulate(checkpointed "--checkpoint=${dir}/run.ckpt" --checkpoint-every=${every})
+if(NOT checkpointed_output MATCHES "Checkpoints: ([0-9]+) written" OR CMAKE_MATCH_1 EQUAL 0)
+    message(FATAL_ERROR "${NAME}: no checkpoint written every ${every} units:\n${checkpointed_output}")
+endif()
+simulate(resumed "--resume=${dir}/run.ckpt")
+
+read_trace(plain)
+read_trace(checkpointed)
+read_trace(resumed)
+
+if(NOT checkpointed_time STREQUAL plain_time OR NOT checkpointed_records STREQUAL plain_records OR
+   NOT checkpointed_data STREQUAL plain_data)
+    message(FATAL_ERROR "${NAME}: writing checkpoints changed the run (simulation time ${checkpointed_time}, "
+                        "${checkpointed_count} records; uninterrupted ${plain_time}, ${plain_count} records)")
+endif()
+if(NOT resumed_time STREQUAL plain_time)
+    message(FATAL_ERROR "${NAME}: simulation time ${resumed_time} (resumed) != ${plain_time} (uninterrupted)")
+endif()
+if(NOT resumed_data STREQUAL plain_data)
+    message(FATAL_ERROR "${NAME}: the sorted data of the resumed and uninterrupted runs differ")
+endif()
+if(resumed_count EQUAL 0 OR NOT resumed_count LESS plain_count)
+    message(FATAL_ERROR "${NAME}: the resumed run traced ${resumed_count} of ${plain_count} records, "
+                        "the checkpoint is not from the middle of the run")
+endif()
+
+# the resumed trace, record for record, against the tail of the uninterrupted one
+math(EXPR offset "${plain_count} - ${resumed_count}")
+set(index 0)
+foreach(record IN LISTS resumed_records)
+    math(EXPR position "${offset} + ${index}")
+    list(GET plain_records ${position} expected)
+    if(NOT record STREQUAL expected)
+        message(FATAL_ERROR "${NAME}: resumed record ${index} is ${record}, "
+                            "the uninterrupted run has ${expected} (record ${position})")
+    endif()
+    math(EXPR index "${index} + 1")
+endforeach()
+
+message(STATUS "${NAME}: resumed ${resumed_count} of ${plain_count} records, simulation time ${plain_time}, "
+               "same trace tail and data")
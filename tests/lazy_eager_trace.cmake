@@ -0,0 +1,80 @@
+# Lazy and eager event generation (--events) must simulate the same run: the
+# same (time, type, src, dst, tag) records at every tick of the binary trace,
+# the same simulation time and the same sorted data. Only the order of
+# same-tick events may differ, so each trace's records are compared sorted.
+# Run by ctest: cmake -DSIMULATOR=... -DTRACE2TXT=... -DPROCS=P -DELEMENTS=N
+#                     -DWORK_DIR=... -P lazy_eager_trace.cmake
+
+foreach(var SIMULATOR TRACE2TXT PROCS ELEMENTS WORK_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "lazy_eager_trace.cmake needs -D${var}=...")
+    endif()
+endforeach()
+
+set(dir "${WORK_DIR}/p${PROCS}")
+file(REMOVE_RECURSE "${dir}")
+file(MAKE_DIRECTORY "${dir}")
+
+foreach(mode lazy eager)
+    execute_process(
+        COMMAND "${SIMULATOR}" ${PROCS} ${ELEMENTS} --events=${mode} --seed=12345 --quiet
+                "--trace=${dir}/${mode}.bin" "--output=${dir}/${mode}.dat"
+        WORKING_DIRECTORY "${dir}"
+        RESULT_VARIABLE status
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "P=${PROCS} --events=${mode} failed (${status}):\n${output}")
+    endif()
+    if(NOT output MATCHES "Is correctly sorted: Yes")
+        message(FATAL_ERROR "P=${PROCS} --events=${mode} did not sort:\n${output}")
+    endif()
+    if(NOT output MATCHES "Simulation time: ([^\n]*)")
+        message(FATAL_ERROR "P=${PROCS} --events=${mode}: no simulation time in the output:\n${output}")
+    endif()
+    set(${mode}_time "${CMAKE_MATCH_1}")
+
+    execute_process(
+        COMMAND "${TRACE2TXT}" "${dir}/${mode}.bin" --csv "${dir}/${mode}.csv"
+        RESULT_VARIABLE status
+        ERROR_VARIABLE error)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "trace2txt ${mode}.bin failed (${status}): ${error}")
+    endif()
+
+    # time,type,src,dst,tag of every record, without the CSV header
+    file(STRINGS "${dir}/${mode}.csv" lines)
+    list(REMOVE_AT lines 0)
+    set(records)
+    foreach(line IN LISTS lines)
+        string(REGEX MATCH "^[^,]*,[^,]*,[^,]*,[^,]*,[^,]*" record "${line}")
+        list(APPEND records "${record}")
+    endforeach()
+    list(SORT records)
+    set(${mode}_records "${records}")
+    list(LENGTH records ${mode}_count)
+
+    file(SHA256 "${dir}/${mode}.dat" ${mode}_data)
+endforeach()
+
+if(NOT lazy_time STREQUAL eager_time)
+    message(FATAL_ERROR "P=${PROCS}: simulation time ${lazy_time} (lazy) != ${eager_time} (eager)")
+endif()
+if(NOT lazy_data STREQUAL eager_data)
+    message(FATAL_ERROR "P=${PROCS}: the sorted data of lazy and eager runs differ")
+endif()
+if(NOT lazy_count EQUAL eager_count)
+    message(FATAL_ERROR "P=${PROCS}: ${lazy_count} trace records (lazy) != ${eager_count} (eager)")
+endif()
+if(NOT lazy_records STREQUAL eager_records)
+    # the first record present in one trace and not the other
+    foreach(record IN LISTS lazy_records)
+        list(FIND eager_records "${record}" found)
+        if(found EQUAL -1)
+            message(FATAL_ERROR "P=${PROCS}: lazy record ${record} is missing from the eager trace")
+        endif()
+    endforeach()
+    message(FATAL_ERROR "P=${PROCS}: lazy and eager traces hold different records per tick")
+endif()
+
+message(STATUS "P=${PROCS}: ${lazy_count} records, simulation time ${lazy_time}, lazy == eager")
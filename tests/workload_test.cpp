@@ -0,0 +1,115 @@
+// Input generation checks, run by ctest:
+//   workload_test philox   Philox4x32-10 against the Random123 known-answer vectors
+//   workload_test threads  every --dist gives the same per-rank input for any --threads
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "event_simulator.hpp"
+#include "workload.hpp"
+
+namespace
+{
+    // Random123 kat_vectors, philox4x32_10: counter, key, expected output
+    struct KnownAnswer
+    {
+        Philox4x32::Block counter;
+        std::uint32_t key[2];
+        Philox4x32::Block output;
+    };
+
+    constexpr KnownAnswer PHILOX_KAT[] = {
+        {{0x00000000, 0x00000000, 0x00000000, 0x00000000},
+         {0x00000000, 0x00000000},
+         {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+        {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+         {0xffffffff, 0xffffffff},
+         {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+        {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+         {0xa4093822, 0x299f31d0},
+         {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+    };
+
+    std::string hex(const Philox4x32::Block &block)
+    {
+        char text[40];
+        std::snprintf(text, sizeof(text), "%08x %08x %08x %08x", block[0], block[1], block[2], block[3]);
+        return text;
+    }
+
+    int checkPhilox()
+    {
+        int failed = 0;
+        for (const KnownAnswer &answer : PHILOX_KAT)
+        {
+            Philox4x32 philox(static_cast<std::uint64_t>(answer.key[1]) << 32 | answer.key[0]);
+            Philox4x32::Block output = philox(answer.counter);
+            bool match = output == answer.output;
+            std::cout << "philox4x32_10(" << hex(answer.counter) << ") = " << hex(output)
+                      << (match ? "" : ", expected " + hex(answer.output)) << std::endl;
+            failed += !match;
+        }
+        return failed;
+    }
+
+    // every rank's generated keys with `threads` workers
+    std::vector<std::vector<Key>> generate(EventSimulator &simulator, const std::string &dist, int threads)
+    {
+        const int ranks = 16, elements = 65536; // 16 workers' worth at 64K keys each
+        SimConfig config;
+        config.verbose = false;
+        config.trace_file.clear();
+        config.workload = parseWorkload(dist);
+        config.workload.seed = 12345;
+        config.workload.seeded = true;
+        config.threads = threads;
+        simulator.init(ranks, elements, config);
+        simulator.initializeData();
+        std::vector<std::vector<Key>> input;
+        for (const auto &processor : simulator.getProcessors())
+            input.emplace_back(processor.getData().begin(), processor.getData().end());
+        return input;
+    }
+
+    int checkThreads()
+    {
+        int failed = 0;
+        EventSimulator simulator;
+        for (const char *dist : {"uniform", "full", "zipf:1.2", "duplicates:16", "sorted", "reversed",
+                                 "nearly-sorted:1000", "runs:100"})
+        {
+            std::vector<std::vector<Key>> serial = generate(simulator, dist, 1);
+            int failed_before = failed;
+            for (int threads : {2, 3, 8, 16})
+            {
+                std::vector<std::vector<Key>> parallel = generate(simulator, dist, threads);
+                for (std::size_t rank = 0; rank < serial.size(); ++rank)
+                {
+                    if (parallel[rank] != serial[rank])
+                    {
+                        std::cout << dist << ": rank " << rank << " differs with " << threads
+                                  << " threads from 1 thread" << std::endl;
+                        ++failed;
+                        break;
+                    }
+                }
+            }
+            if (failed == failed_before)
+                std::cout << dist << ": same input with 1, 2, 3, 8 and 16 threads" << std::endl;
+        }
+        return failed;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string check = argc > 1 ? argv[1] : "";
+    if (check == "philox")
+        return checkPhilox() == 0 ? 0 : 1;
+    if (check == "threads")
+        return checkThreads() == 0 ? 0 : 1;
+    std::cerr << "Usage: " << argv[0] << " philox|threads" << std::endl;
+    return 2;
+}
@@ -0,0 +1,110 @@
+// Convert a binary event trace (see lib/trace_format.hpp) to readable text
+// or CSV.
+// Usage: trace2txt <trace_file> [--csv] [output_file]   (default output: stdout)
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "event_types.hpp"
+#include "trace_format.hpp"
+
+int main(int argc, char *argv[])
+{
+    std::string input, output;
+    bool csv = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--csv")
+            csv = true;
+        else if (input.empty())
+            input = arg;
+        else
+            output = arg;
+    }
+    if (input.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " <trace_file> [--csv] [output_file]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(input, std::ios::binary);
+    if (!in.is_open())
+    {
+        std::cerr << "Error: cannot open " << input << std::endl;
+        return 1;
+    }
+    TraceHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        std::cerr << "Error: " << input << " is not an event trace" << std::endl;
+        return 1;
+    }
+    if (header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord))
+    {
+        std::cerr << "Error: unsupported trace version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!output.empty())
+    {
+        file.open(output);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: cannot open " << output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = output.empty() ? std::cout : file;
+
+    const double ticks_per_unit = static_cast<double>(header.ticks_per_unit);
+    if (csv)
+    {
+        out << "time,type,src,dst,tag,payload_length,payload_hash\n";
+    }
+    else
+    {
+        out << "=== DISCRETE EVENT SIMULATION LOG ===\n";
+        out << "Number of Processors: " << header.num_processes << "\n";
+        out << "Elements per Processor: " << header.elements_per_processor << "\n";
+        out << "Total Elements: " << (static_cast<long long>(header.num_processes) * header.elements_per_processor) << "\n";
+        out << "========================================\n\n";
+    }
+
+    std::vector<TraceRecord> records(4096);
+    std::size_t total = 0;
+    while (in)
+    {
+        in.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(TraceRecord));
+        std::size_t count = static_cast<std::size_t>(in.gcount()) / sizeof(TraceRecord);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const TraceRecord &r = records[i];
+            const char *type = eventTypeName(static_cast<EventType>(r.type));
+            double time = r.time / ticks_per_unit;
+            if (csv)
+            {
+                out << time << "," << type << "," << r.src << "," << r.dst << "," << r.tag << ","
+                    << r.payload_length << "," << std::hex << r.payload_hash << std::dec << "\n";
+            }
+            else
+            {
+                out << "Time: " << time << ", Type: " << type << ", Src: " << r.src << ", Dest: " << r.dst
+                    << ", Tag: " << r.tag << "\n";
+                out << "Data: " << r.payload_length << " elements, hash " << std::hex << std::setw(16)
+                    << std::setfill('0') << r.payload_hash << std::dec << std::setfill(' ') << "\n\n";
+            }
+        }
+        total += count;
+    }
+
+    if (!output.empty())
+        std::cerr << total << " events written to " << output << std::endl;
+    return 0;
+}